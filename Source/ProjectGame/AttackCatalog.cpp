@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AttackCatalog.h"
+
+UAttackCatalog::UAttackCatalog()
+{
+	// Default attacks: montage name, then the reactions when hitting head, chest and torso
+	AddAttack(TEXT("Attack_Duck_Punch"),			ReactType::Face_FS,	ReactType::NoReact,	ReactType::NoReact);
+	AddAttack(TEXT("Attack_Punch_L_quick"),			ReactType::Face_FS,	ReactType::NoReact,	ReactType::NoReact);
+	AddAttack(TEXT("Attack_Punch_Combo"),			ReactType::Face_FS,	ReactType::Torso_LM,	ReactType::NoReact);
+	AddAttack(TEXT("Attack_Punch_R_quick"),			ReactType::Face_FM,	ReactType::NoReact,	ReactType::NoReact);
+	AddAttack(TEXT("Attack_Kick_scissors"),			ReactType::Face_FB,	ReactType::NoReact,	ReactType::NoReact);
+	AddAttack(TEXT("Attack_Punch_L_uppercut"),		ReactType::Face_FB,	ReactType::NoReact,	ReactType::Torso_FB);
+	AddAttack(TEXT("Attack_Punch_R_uppercut"),		ReactType::Face_FB,	ReactType::NoReact,	ReactType::Torso_FB);
+	AddAttack(TEXT("Attack_Kick_backwards_round"),	ReactType::Face_RB,	ReactType::NoReact,	ReactType::NoReact);
+	AddAttack(TEXT("Attack_Kick_R_high"),			ReactType::Face_LM,	ReactType::NoReact,	ReactType::Torso_LM);
+	AddAttack(TEXT("Attack_Kick_R_roundhouse"),		ReactType::Face_LM,	ReactType::NoReact,	ReactType::NoReact);
+	AddAttack(TEXT("Attack_Kick_R_high_round"),		ReactType::Face_LB,	ReactType::NoReact,	ReactType::NoReact);
+	AddAttack(TEXT("Attack_Punch_R_swing"),			ReactType::Face_LB,	ReactType::NoReact,	ReactType::NoReact);
+	AddAttack(TEXT("Attack_Kick_R_front"),			ReactType::NoReact,	ReactType::NoReact,	ReactType::Torso_FS);
+	AddAttack(TEXT("Attack_Kick_L_front"),			ReactType::NoReact,	ReactType::NoReact,	ReactType::Torso_FS);
+	AddAttack(TEXT("Attack_Kick_R_torso"),			ReactType::NoReact,	ReactType::NoReact,	ReactType::Torso_FM);
+	AddAttack(TEXT("Attack_Punch_R_hook"),			ReactType::NoReact,	ReactType::Torso_LM,	ReactType::Torso_LS);
+	AddAttack(TEXT("Attack_Kick_air"),				ReactType::NoReact,	ReactType::Torso_LM,	ReactType::Torso_LM);
+	AddAttack(TEXT("Attack_Kick_L_roundhouse"),		ReactType::NoReact,	ReactType::Torso_LM,	ReactType::Torso_LM);
+	AddAttack(TEXT("Attack_Punch_R_hook_momentum"),	ReactType::NoReact,	ReactType::Torso_LM,	ReactType::Torso_LM);
+	AddAttack(TEXT("Attack_Kick_R_mocap"),			ReactType::NoReact,	ReactType::Torso_LM,	ReactType::Torso_LM);
+	AddAttack(TEXT("Attack_Punch_L_hook"),			ReactType::NoReact,	ReactType::Torso_RM,	ReactType::Torso_RM);
+}
+
+void UAttackCatalog::AddAttack(FName MontageName, ReactType HeadReaction, ReactType ChestReaction, ReactType TorsoReaction)
+{
+	FAttackDefinition Attack;
+	Attack.MontageName = MontageName;
+	Attack.HeadReaction = HeadReaction;
+	Attack.ChestReaction = ChestReaction;
+	Attack.TorsoReaction = TorsoReaction;
+	Attacks.Add(Attack);
+}
+
+void UAttackCatalog::Bake()
+{
+	if (bBaked) return;
+
+	ReactionTable.Init((uint8)ReactType::NoReact, Attacks.Num() * NumBodyParts);
+	MontageAttackIds.Reset();
+	NameAttackIds.Reset();
+	AttackMontages.Init(nullptr, Attacks.Num());
+
+	for (int32 id = 0; id < Attacks.Num(); id++) {
+		const FAttackDefinition& Attack = Attacks[id];
+
+		uint8* Reactions = &ReactionTable[id * NumBodyParts];
+		Reactions[(int32)EBodyPart::Head] = Attack.HeadReaction.GetValue();
+		Reactions[(int32)EBodyPart::Chest] = Attack.ChestReaction.GetValue();
+		Reactions[(int32)EBodyPart::Torso] = Attack.TorsoReaction.GetValue();
+
+		FName Name = Attack.Montage != nullptr ? Attack.Montage->GetFName() : Attack.MontageName;
+		if (NameAttackIds.Contains(Name)) {
+			UE_LOG(LogTemp, Warning, TEXT("%s: attack %s is defined more than once. Only the first definition is used"), *GetName(), *Name.ToString());
+			continue;
+		}
+		NameAttackIds.Add(Name, id);
+		if (Attack.Montage != nullptr) MontageAttackIds.Add(Attack.Montage, id);
+		AttackMontages[id] = Attack.Montage;
+	}
+
+	if (Combos.Num() > 0) ComboGraph.Build(Combos, GetName());
+	else {
+		// Accept what combos accepted before they were defined: any attack sequence after each way of starting one
+		TArray<FComboDefinition> AllCombos;
+		int32 Length = FMath::Max(MaxComboLength, 1);
+		AddAllSequences(TEXT(""), Length, AllCombos);
+		AddAllSequences(TEXT("3"), Length - 1, AllCombos);
+		AddAllSequences(TEXT("4"), Length - 1, AllCombos);
+		AddAllSequences(TEXT("0"), Length - 1, AllCombos);
+		AddAllSequences(TEXT("5"), Length - 1, AllCombos);
+		AddAllSequences(TEXT("55"), Length - 2, AllCombos);
+		AddAllSequences(TEXT("6"), Length - 1, AllCombos);
+		AddAllSequences(TEXT("66"), Length - 2, AllCombos);
+		ComboGraph.Build(AllCombos, GetName());
+	}
+
+	bBaked = true;
+}
+
+void UAttackCatalog::AddAllSequences(const FString& Prefix, int32 Length, TArray<FComboDefinition>& OutCombos)
+{
+	if (!Prefix.IsEmpty()) {
+		FComboDefinition Combo;
+		Combo.Sequence = Prefix;
+		OutCombos.Add(Combo);
+	}
+	if (Length <= 0) return;
+
+	AddAllSequences(Prefix + TEXT("1"), Length - 1, OutCombos);
+	AddAllSequences(Prefix + TEXT("2"), Length - 1, OutCombos);
+}
+
+int32 UAttackCatalog::FindAttackId(const UAnimMontage* AttackMontage)
+{
+	if (AttackMontage == nullptr) return INDEX_NONE;
+	if (!bBaked) Bake();
+
+	const TWeakObjectPtr<const UAnimMontage> Key(AttackMontage);
+	if (const int32* id = MontageAttackIds.Find(Key)) return *id;
+
+	// First time this montage is seen: resolve it by name and cache it (even if it is not an attack)
+	const int32* NameId = NameAttackIds.Find(AttackMontage->GetFName());
+	int32 id = NameId != nullptr ? *NameId : INDEX_NONE;
+	MontageAttackIds.Add(Key, id);
+	if (id != INDEX_NONE) AttackMontages[id] = const_cast<UAnimMontage*>(AttackMontage);
+	return id;
+}
+
+#if WITH_EDITOR
+void UAttackCatalog::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// Rebake on next use so edits made while playing in editor are picked up
+	bBaked = false;
+}
+#endif
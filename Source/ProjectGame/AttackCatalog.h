@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Animation/AnimMontage.h"
+#include "FightingCharacter.h"
+#include "ComboGraph.h"
+#include "AttackCatalog.generated.h"
+
+/**
+ * Describes one attack: the Animation Montage that performs it and the reaction
+ * it causes on the opponent depending on which hit area was hit.
+ * A reaction of NoReact means that hitting that area with this attack does not trigger a reaction.
+ */
+USTRUCT(BlueprintType)
+struct FAttackDefinition
+{
+	GENERATED_BODY()
+
+	/** Name of the attack Animation Montage. Used to find the attack when Montage is not set */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Attack)
+	FName MontageName;
+
+	/** Attack Animation Montage. If set, MontageName is ignored */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Attack)
+	UAnimMontage* Montage = nullptr;
+
+	/** Reaction when the attack hits the head */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Reaction)
+	TEnumAsByte<ReactType> HeadReaction = ReactType::NoReact;
+
+	/** Reaction when the attack hits the chest */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Reaction)
+	TEnumAsByte<ReactType> ChestReaction = ReactType::NoReact;
+
+	/** Reaction when the attack hits the torso (or hips) */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Reaction)
+	TEnumAsByte<ReactType> TorsoReaction = ReactType::NoReact;
+};
+
+/**
+ * Data asset that lists all the attacks a FightingCharacter can perform and the reactions they cause.
+ * New attacks can be added by creating an AttackCatalog data asset and assigning it to the character's Blueprint,
+ * without changing any code. If no data asset is assigned, the character creates its own catalog with the default attacks
+ * (filled in the constructor).
+ *
+ * The catalog is baked once (Bake()) into a flat [attack][body part] -> ReactType table,
+ * so finding the reaction to a hit is one montage -> attack id lookup and one array index.
+ *
+ * @see AFightingCharacter::ReactionStart()
+ */
+UCLASS(BlueprintType)
+class PROJECTGAME_API UAttackCatalog : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Default UObject constructor. Fills Attacks with the game's default attacks */
+	UAttackCatalog();
+
+	/** All attacks in the catalog. The index of an attack in this array is its attack id */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Attack)
+	TArray<FAttackDefinition> Attacks;
+
+	/**
+	 * All combo sequences that can be performed. Compiled into a combo state machine when the catalog is baked.
+	 * If empty, every sequence of up to MaxComboLength inputs is accepted and the animation blueprint
+	 * decides which ones play an Animation Montage.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combo)
+	TArray<FComboDefinition> Combos;
+
+	/** Maximum number of inputs of a combo sequence when Combos is empty */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combo)
+	int32 MaxComboLength = 4;
+
+	/** Builds the flat reaction table, the montage lookup and the combo state machine. Does nothing if it is already baked */
+	void Bake();
+
+	/** Returns the combo state machine. The catalog must be baked */
+	FORCEINLINE const FComboGraph& GetComboGraph() const { return ComboGraph; }
+
+	/**
+	 * Returns the attack id of the specified montage, or INDEX_NONE if the montage is not an attack of the catalog.
+	 * The first time a montage is seen it is resolved by name and cached, so next lookups don't compare names.
+	 *
+	 * @param AttackMontage		montage being played by the attacker
+	 * @return attack id
+	 */
+	int32 FindAttackId(const UAnimMontage* AttackMontage);
+
+	/**
+	 * Returns the reaction that the specified attack causes when it hits the specified body part.
+	 *
+	 * @param AttackId		id of the attack, as returned by FindAttackId()
+	 * @param BodyPart		body part that was hit
+	 * @return reaction to be played, or NoReact
+	 */
+	FORCEINLINE ReactType GetReaction(int32 AttackId, EBodyPart BodyPart) const
+	{
+		if (AttackId == INDEX_NONE || BodyPart == EBodyPart::None) return ReactType::NoReact;
+		return (ReactType)ReactionTable[AttackId * NumBodyParts + (int32)BodyPart];
+	}
+
+	/**
+	 * Returns the montage of an attack, or NULL if its montage has not been set nor seen by FindAttackId() yet.
+	 * Used to restore the attack being played when a saved fighter state is loaded.
+	 */
+	FORCEINLINE UAnimMontage* GetAttackMontage(int32 AttackId) const
+	{
+		return AttackMontages.IsValidIndex(AttackId) ? AttackMontages[AttackId] : nullptr;
+	}
+
+	/** Returns the number of attacks in the catalog */
+	FORCEINLINE int32 GetNumAttacks() const { return Attacks.Num(); }
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+protected:
+	/** Adds an attack to Attacks. Used to fill the default attacks */
+	void AddAttack(FName MontageName, ReactType HeadReaction, ReactType ChestReaction, ReactType TorsoReaction);
+
+	/**
+	 * Adds to OutCombos every sequence starting with Prefix followed by up to Length Attack 1 / Attack 2 inputs.
+	 * Used to build the combos when Combos is empty
+	 */
+	static void AddAllSequences(const FString& Prefix, int32 Length, TArray<FComboDefinition>& OutCombos);
+
+	/** Combo state machine compiled from Combos */
+	FComboGraph ComboGraph;
+
+	/** Flat table of reactions, indexed by [AttackId * NumBodyParts + BodyPart] */
+	TArray<uint8> ReactionTable;
+
+	/**
+	 * Attack id of each montage that has already been resolved. Weak keys, as the map is not visible to the garbage collector:
+	 * a montage allocated at the address of a collected one is not mistaken for it
+	 */
+	TMap<TWeakObjectPtr<const UAnimMontage>, int32> MontageAttackIds;
+
+	/** Montage of each attack id, once known */
+	UPROPERTY(Transient)
+	TArray<UAnimMontage*> AttackMontages;
+
+	/** Attack id of each attack montage name */
+	TMap<FName, int32> NameAttackIds;
+
+	/** Tracks if the catalog has been baked */
+	bool bBaked = false;
+};
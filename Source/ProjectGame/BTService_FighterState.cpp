@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTService_FighterState.h"
+#include "FightingCharacter.h"
+#include "AIController.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Bool.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Int.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Float.h"
+
+UBTService_FighterState::UBTService_FighterState()
+{
+	NodeName = TEXT("Fighter State");
+	bNotifyBecomeRelevant = true;
+	bNotifyTick = true;
+	Interval = 0.1f;
+	RandomDeviation = 0.02f;
+
+	IsCloseToTargetKey.SelectedKeyName = TEXT("IsCloseToTarget");
+	TargetIsAttackingKey.SelectedKeyName = TEXT("TargetIsAttacking");
+	IsDefeatedKey.SelectedKeyName = TEXT("IsDefeated");
+	PredictedAttackKey.SelectedKeyName = TEXT("PredictedAttack");
+	PredictedAttackConfidenceKey.SelectedKeyName = TEXT("PredictedAttackConfidence");
+	IsCloseToTargetKey.AddBoolFilter(this, GET_MEMBER_NAME_CHECKED(UBTService_FighterState, IsCloseToTargetKey));
+	TargetIsAttackingKey.AddBoolFilter(this, GET_MEMBER_NAME_CHECKED(UBTService_FighterState, TargetIsAttackingKey));
+	IsDefeatedKey.AddBoolFilter(this, GET_MEMBER_NAME_CHECKED(UBTService_FighterState, IsDefeatedKey));
+	PredictedAttackKey.AddIntFilter(this, GET_MEMBER_NAME_CHECKED(UBTService_FighterState, PredictedAttackKey));
+	PredictedAttackConfidenceKey.AddFloatFilter(this, GET_MEMBER_NAME_CHECKED(UBTService_FighterState, PredictedAttackConfidenceKey));
+}
+
+void UBTService_FighterState::InitializeFromAsset(UBehaviorTree& Asset)
+{
+	Super::InitializeFromAsset(Asset);
+
+	if (UBlackboardData* blackboard = GetBlackboardAsset()) {
+		IsCloseToTargetKey.ResolveSelectedKey(*blackboard);
+		TargetIsAttackingKey.ResolveSelectedKey(*blackboard);
+		IsDefeatedKey.ResolveSelectedKey(*blackboard);
+		PredictedAttackKey.ResolveSelectedKey(*blackboard);
+		PredictedAttackConfidenceKey.ResolveSelectedKey(*blackboard);
+	}
+}
+
+FString UBTService_FighterState::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: %s within %.0f, %s, %s"), *Super::GetStaticDescription(), *IsCloseToTargetKey.SelectedKeyName.ToString(),
+		CloseDistance, *TargetIsAttackingKey.SelectedKeyName.ToString(), *IsDefeatedKey.SelectedKeyName.ToString());
+}
+
+void UBTService_FighterState::OnBecomeRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	Super::OnBecomeRelevant(OwnerComp, NodeMemory);
+
+	// The branch below decides right away, so the keys cannot wait for the first interval
+	UpdateKeys(OwnerComp);
+}
+
+void UBTService_FighterState::TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	Super::TickNode(OwnerComp, NodeMemory, DeltaSeconds);
+
+	UpdateKeys(OwnerComp);
+}
+
+void UBTService_FighterState::UpdateKeys(UBehaviorTreeComponent& OwnerComp) const
+{
+	UBlackboardComponent* blackboard = OwnerComp.GetBlackboardComponent();
+	AAIController* controller = OwnerComp.GetAIOwner();
+	AFightingCharacter* fighter = controller != NULL ? Cast<AFightingCharacter>(controller->GetPawn()) : NULL;
+	if (blackboard == NULL || fighter == NULL) return;
+
+	AFightingCharacter* target = fighter->GetTargetEnemy();
+	bool isClose = target != NULL && FVector::DistSquared(fighter->GetActorLocation(), target->GetActorLocation()) <= CloseDistance * CloseDistance;
+	bool targetIsAttacking = target != NULL && target->IsAttacking;
+
+	// Observers of the keys are only notified when a value changes
+	blackboard->SetValue<UBlackboardKeyType_Bool>(IsCloseToTargetKey.GetSelectedKeyID(), isClose);
+	blackboard->SetValue<UBlackboardKeyType_Bool>(TargetIsAttackingKey.GetSelectedKeyID(), targetIsAttacking);
+	blackboard->SetValue<UBlackboardKeyType_Bool>(IsDefeatedKey.GetSelectedKeyID(), fighter->bDefeated);
+
+	// Blackboards without the prediction keys skip the query
+	if (PredictedAttackKey.IsSet() || PredictedAttackConfidenceKey.IsSet()) {
+		float confidence = 0.0f;
+		int32 predicted = target != NULL ? target->GetComboPredictor().PredictNext(confidence) : INDEX_NONE;
+		blackboard->SetValue<UBlackboardKeyType_Int>(PredictedAttackKey.GetSelectedKeyID(), predicted);
+		blackboard->SetValue<UBlackboardKeyType_Float>(PredictedAttackConfidenceKey.GetSelectedKeyID(), confidence);
+	}
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTService.h"
+#include "BTService_FighterState.generated.h"
+
+/**
+ * Updates the blackboard keys the fighter AI decides on: whether the controlled fighter is close to its target enemy,
+ * whether the target is attacking and whether the controlled fighter is defeated.
+ * It can also set the most likely next attack of the target, predicted from the attacks it performed so far (@see FComboPredictor).
+ * Runs at the service interval instead of every frame, and only touches the blackboard when a value changes.
+ */
+UCLASS()
+class PROJECTGAME_API UBTService_FighterState : public UBTService
+{
+	GENERATED_BODY()
+
+public:
+	UBTService_FighterState();
+
+	//~ Begin UBTNode Interface
+	virtual void InitializeFromAsset(UBehaviorTree& Asset) override;
+	virtual FString GetStaticDescription() const override;
+	//~ End UBTNode Interface
+
+	/** Distance to the target enemy under which the fighter is close to it */
+	UPROPERTY(EditAnywhere, Category = Fighter, meta = (ClampMin = "0"))
+	float CloseDistance = 150.0f;
+
+	/** Bool key set if the fighter is within CloseDistance of its target enemy */
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector IsCloseToTargetKey;
+
+	/** Bool key set if the target enemy is attacking */
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector TargetIsAttackingKey;
+
+	/** Bool key set if the fighter is defeated */
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector IsDefeatedKey;
+
+	/** Optional int key set to the combo state of the most likely next attack of the target enemy, or -1 if there is no prediction */
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector PredictedAttackKey;
+
+	/** Optional float key set to the confidence of the predicted attack, from 0 to 1 */
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector PredictedAttackConfidenceKey;
+
+protected:
+	//~ Begin UBTAuxiliaryNode Interface
+	virtual void OnBecomeRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual void TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+	//~ End UBTAuxiliaryNode Interface
+
+	/** Sets the keys from the state of the controlled fighter */
+	void UpdateKeys(UBehaviorTreeComponent& OwnerComp) const;
+};
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_ChaseTarget.h"
+#include "FightingCharacter.h"
+#include "AIController.h"
+#include "Navigation/PathFollowingComponent.h"
+
+UBTTask_ChaseTarget::UBTTask_ChaseTarget()
+{
+	NodeName = TEXT("Chase Target");
+}
+
+uint16 UBTTask_ChaseTarget::GetInstanceMemorySize() const
+{
+	return sizeof(FChaseTargetMemory);
+}
+
+EBTNodeResult::Type UBTTask_ChaseTarget::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FChaseTargetMemory* memory = (FChaseTargetMemory*)NodeMemory;
+	AAIController* controller = OwnerComp.GetAIOwner();
+	AFightingCharacter* fighter = controller != NULL ? Cast<AFightingCharacter>(controller->GetPawn()) : NULL;
+	if (fighter == NULL || fighter->GetTargetEnemy() == NULL) return EBTNodeResult::Failed;
+
+	// Path finding is the expensive part, so the current path is kept while the target stays near its goal
+	const FVector goal = fighter->GetEnemyLocation();
+	bool isFollowingPath = controller->GetMoveStatus() == EPathFollowingStatus::Moving;
+	if (!isFollowingPath || !memory->bHasGoal || FVector::DistSquared(goal, memory->Goal) > RepathDistance * RepathDistance) {
+		EPathFollowingRequestResult::Type result = controller->MoveToLocation(goal, AcceptanceRadius);
+		if (result == EPathFollowingRequestResult::Failed) {
+			memory->bHasGoal = false;
+			return EBTNodeResult::Failed;
+		}
+		memory->Goal = goal;
+		memory->bHasGoal = true;
+	}
+
+	return EBTNodeResult::Succeeded;
+}
+
+FString UBTTask_ChaseTarget::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: acceptance %.0f, repath after %.0f"), *Super::GetStaticDescription(), AcceptanceRadius, RepathDistance);
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "BTTask_ChaseTarget.generated.h"
+
+/**
+ * Moves the controlled fighter towards its target enemy and succeeds right away, leaving the path following to run.
+ * A new path is only requested once the target has moved more than RepathDistance from the last goal.
+ */
+UCLASS()
+class PROJECTGAME_API UBTTask_ChaseTarget : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_ChaseTarget();
+
+	//~ Begin UBTTaskNode Interface
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual uint16 GetInstanceMemorySize() const override;
+	//~ End UBTTaskNode Interface
+
+	//~ Begin UBTNode Interface
+	virtual FString GetStaticDescription() const override;
+	//~ End UBTNode Interface
+
+	/** Distance to the target at which the move is finished */
+	UPROPERTY(EditAnywhere, Category = Fighter, meta = (ClampMin = "0"))
+	float AcceptanceRadius = 5.0f;
+
+	/** Distance the target has to move away from the current goal before a new path is requested */
+	UPROPERTY(EditAnywhere, Category = Fighter, meta = (ClampMin = "0"))
+	float RepathDistance = 50.0f;
+
+protected:
+	/** Goal of the last move request of each behaviour tree running the task */
+	struct FChaseTargetMemory
+	{
+		FVector Goal;
+		bool bHasGoal;
+	};
+};
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_FighterAttack.h"
+#include "FightingCharacter.h"
+#include "AIController.h"
+
+/** Returns the fighter controlled by the AI running a behaviour tree */
+static AFightingCharacter* GetControlledFighter(UBehaviorTreeComponent& OwnerComp)
+{
+	AAIController* controller = OwnerComp.GetAIOwner();
+	return controller != NULL ? Cast<AFightingCharacter>(controller->GetPawn()) : NULL;
+}
+
+UBTTask_FighterAttack::UBTTask_FighterAttack()
+{
+	NodeName = TEXT("Fighter Attack");
+	bNotifyTick = true;
+}
+
+uint16 UBTTask_FighterAttack::GetInstanceMemorySize() const
+{
+	return sizeof(FFighterAttackMemory);
+}
+
+EBTNodeResult::Type UBTTask_FighterAttack::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FFighterAttackMemory* memory = (FFighterAttackMemory*)NodeMemory;
+	AFightingCharacter* fighter = GetControlledFighter(OwnerComp);
+	if (fighter == NULL) return EBTNodeResult::Failed;
+
+	memory->RemainingTime = PressDuration;
+	memory->bAttack2 = FMath::FRand() < Attack2Chance;
+	memory->bMoveMod = FMath::FRand() < MoveModChance;
+
+	if (memory->bMoveMod) fighter->MoveMod();
+	if (memory->bAttack2) fighter->Attack2();
+	else fighter->Attack1();
+
+	return EBTNodeResult::InProgress;
+}
+
+void UBTTask_FighterAttack::TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	FFighterAttackMemory* memory = (FFighterAttackMemory*)NodeMemory;
+	memory->RemainingTime -= DeltaSeconds;
+	if (memory->RemainingTime > 0.0f) return;
+
+	ReleaseKeys(OwnerComp, *memory);
+	FinishLatentTask(OwnerComp, EBTNodeResult::Succeeded);
+}
+
+EBTNodeResult::Type UBTTask_FighterAttack::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	ReleaseKeys(OwnerComp, *(FFighterAttackMemory*)NodeMemory);
+	return EBTNodeResult::Aborted;
+}
+
+void UBTTask_FighterAttack::ReleaseKeys(UBehaviorTreeComponent& OwnerComp, const FFighterAttackMemory& Memory) const
+{
+	AFightingCharacter* fighter = GetControlledFighter(OwnerComp);
+	if (fighter == NULL) return;
+
+	if (Memory.bAttack2) fighter->StopAttack2();
+	else fighter->StopAttack1();
+	if (Memory.bMoveMod) fighter->StopMoveMod();
+}
+
+FString UBTTask_FighterAttack::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: hold %.2fs, attack 2 %.2f, move mod %.2f"), *Super::GetStaticDescription(), PressDuration, Attack2Chance, MoveModChance);
+}
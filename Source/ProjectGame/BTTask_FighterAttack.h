@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "BTTask_FighterAttack.generated.h"
+
+class AFightingCharacter;
+
+/**
+ * Presses a random attack key of the controlled fighter, possibly with the move modifier, holds it for PressDuration
+ * and releases it. The task finishes when the key is released.
+ */
+UCLASS()
+class PROJECTGAME_API UBTTask_FighterAttack : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_FighterAttack();
+
+	//~ Begin UBTTaskNode Interface
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual uint16 GetInstanceMemorySize() const override;
+	//~ End UBTTaskNode Interface
+
+	//~ Begin UBTNode Interface
+	virtual FString GetStaticDescription() const override;
+	//~ End UBTNode Interface
+
+	/** Time in seconds the attack key is held */
+	UPROPERTY(EditAnywhere, Category = Fighter, meta = (ClampMin = "0"))
+	float PressDuration = 0.1f;
+
+	/** Chance of pressing Attack 2 instead of Attack 1 */
+	UPROPERTY(EditAnywhere, Category = Fighter, meta = (ClampMin = "0", ClampMax = "1"))
+	float Attack2Chance = 0.5f;
+
+	/** Chance of holding the move modifier with the attack key */
+	UPROPERTY(EditAnywhere, Category = Fighter, meta = (ClampMin = "0", ClampMax = "1"))
+	float MoveModChance = 0.25f;
+
+protected:
+	//~ Begin UBTTaskNode Interface
+	virtual void TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+	//~ End UBTTaskNode Interface
+
+	/** Keys held by each behaviour tree running the task */
+	struct FFighterAttackMemory
+	{
+		float RemainingTime;
+		bool bAttack2;
+		bool bMoveMod;
+	};
+
+	/** Releases the keys pressed by the task */
+	void ReleaseKeys(UBehaviorTreeComponent& OwnerComp, const FFighterAttackMemory& Memory) const;
+};
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_FighterStance.h"
+#include "FightingCharacter.h"
+#include "AIController.h"
+
+UBTTask_FighterStance::UBTTask_FighterStance()
+{
+	NodeName = TEXT("Fighter Stance");
+}
+
+EBTNodeResult::Type UBTTask_FighterStance::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	AAIController* controller = OwnerComp.GetAIOwner();
+	AFightingCharacter* fighter = controller != NULL ? Cast<AFightingCharacter>(controller->GetPawn()) : NULL;
+	if (fighter == NULL) return EBTNodeResult::Failed;
+
+	switch (Action) {
+	case EFighterStanceAction::Block: fighter->Block(); break;
+	case EFighterStanceAction::StopBlocking: fighter->StopBlocking(); break;
+	case EFighterStanceAction::Duck: fighter->Duck(); break;
+	case EFighterStanceAction::StopDucking: fighter->StopDucking(); break;
+	}
+	return EBTNodeResult::Succeeded;
+}
+
+FString UBTTask_FighterStance::GetStaticDescription() const
+{
+	const UEnum* actionEnum = StaticEnum<EFighterStanceAction>();
+	return FString::Printf(TEXT("%s: %s"), *Super::GetStaticDescription(), *actionEnum->GetDisplayNameTextByValue((int64)Action).ToString());
+}
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "BTTask_FighterStance.generated.h"
+
+/** Defensive actions of the fighter AI */
+UENUM(BlueprintType)
+enum class EFighterStanceAction : uint8
+{
+	Block, StopBlocking, Duck, StopDucking
+};
+
+/** Presses or releases the block or duck key of the controlled fighter, and succeeds right away */
+UCLASS()
+class PROJECTGAME_API UBTTask_FighterStance : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_FighterStance();
+
+	//~ Begin UBTTaskNode Interface
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	//~ End UBTTaskNode Interface
+
+	//~ Begin UBTNode Interface
+	virtual FString GetStaticDescription() const override;
+	//~ End UBTNode Interface
+
+	/** Key pressed or released */
+	UPROPERTY(EditAnywhere, Category = Fighter)
+	EFighterStanceAction Action = EFighterStanceAction::Block;
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_FindNextAction.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Bool.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Float.h"
+
+UBTTask_FindNextAction::UBTTask_FindNextAction()
+{
+	NodeName = TEXT("Find Next Action");
+
+	TargetIsAttackingChances.Attack = 0.2f;
+	TargetIsAttackingChances.Block = 0.5f;
+	TargetIsAttackingChances.Duck = 0.3f;
+
+	TargetIsNotAttackingChances.Attack = 0.8f;
+	TargetIsNotAttackingChances.Block = 0.1f;
+	TargetIsNotAttackingChances.Duck = 0.1f;
+
+	TargetIsAttackingKey.SelectedKeyName = TEXT("TargetIsAttacking");
+	AttackNextKey.SelectedKeyName = TEXT("AttackNext");
+	BlockNextKey.SelectedKeyName = TEXT("BlockNext");
+	DuckNextKey.SelectedKeyName = TEXT("DuckNext");
+	PredictedAttackConfidenceKey.SelectedKeyName = TEXT("PredictedAttackConfidence");
+	TargetIsAttackingKey.AddBoolFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_FindNextAction, TargetIsAttackingKey));
+	AttackNextKey.AddBoolFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_FindNextAction, AttackNextKey));
+	BlockNextKey.AddBoolFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_FindNextAction, BlockNextKey));
+	DuckNextKey.AddBoolFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_FindNextAction, DuckNextKey));
+	PredictedAttackConfidenceKey.AddFloatFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_FindNextAction, PredictedAttackConfidenceKey));
+}
+
+void UBTTask_FindNextAction::InitializeFromAsset(UBehaviorTree& Asset)
+{
+	Super::InitializeFromAsset(Asset);
+
+	if (UBlackboardData* blackboard = GetBlackboardAsset()) {
+		TargetIsAttackingKey.ResolveSelectedKey(*blackboard);
+		AttackNextKey.ResolveSelectedKey(*blackboard);
+		BlockNextKey.ResolveSelectedKey(*blackboard);
+		DuckNextKey.ResolveSelectedKey(*blackboard);
+		PredictedAttackConfidenceKey.ResolveSelectedKey(*blackboard);
+	}
+}
+
+EBTNodeResult::Type UBTTask_FindNextAction::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	UBlackboardComponent* blackboard = OwnerComp.GetBlackboardComponent();
+	if (blackboard == NULL) return EBTNodeResult::Failed;
+
+	bool targetIsAttacking = blackboard->GetValue<UBlackboardKeyType_Bool>(TargetIsAttackingKey.GetSelectedKeyID());
+	FFighterActionChances chances = targetIsAttacking ? TargetIsAttackingChances : TargetIsNotAttackingChances;
+
+	// A predictable target is treated as if it was about to attack
+	if (!targetIsAttacking && PredictedAttackConfidenceKey.IsSet()) {
+		float anticipation = AnticipationWeight * FMath::Clamp(blackboard->GetValue<UBlackboardKeyType_Float>(PredictedAttackConfidenceKey.GetSelectedKeyID()), 0.0f, 1.0f);
+		chances.Attack = FMath::Lerp(chances.Attack, TargetIsAttackingChances.Attack, anticipation);
+		chances.Block = FMath::Lerp(chances.Block, TargetIsAttackingChances.Block, anticipation);
+		chances.Duck = FMath::Lerp(chances.Duck, TargetIsAttackingChances.Duck, anticipation);
+	}
+
+	// One roll against the cumulated chances
+	float roll = FMath::FRand();
+	bool attack = roll < chances.Attack;
+	bool block = !attack && roll < chances.Attack + chances.Block;
+	bool duck = !attack && !block && roll < chances.Attack + chances.Block + chances.Duck;
+
+	blackboard->SetValue<UBlackboardKeyType_Bool>(AttackNextKey.GetSelectedKeyID(), attack);
+	blackboard->SetValue<UBlackboardKeyType_Bool>(BlockNextKey.GetSelectedKeyID(), block);
+	blackboard->SetValue<UBlackboardKeyType_Bool>(DuckNextKey.GetSelectedKeyID(), duck);
+	return EBTNodeResult::Succeeded;
+}
+
+FString UBTTask_FindNextAction::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: attack/block/duck %.2f/%.2f/%.2f, %.2f/%.2f/%.2f if %s"), *Super::GetStaticDescription(),
+		TargetIsNotAttackingChances.Attack, TargetIsNotAttackingChances.Block, TargetIsNotAttackingChances.Duck,
+		TargetIsAttackingChances.Attack, TargetIsAttackingChances.Block, TargetIsAttackingChances.Duck,
+		*TargetIsAttackingKey.SelectedKeyName.ToString());
+}
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "BTTask_FindNextAction.generated.h"
+
+/** Chances of each action the fighter AI can take next. Whatever is left up to 1 is the chance of doing nothing */
+USTRUCT(BlueprintType)
+struct FFighterActionChances
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = Fighter, meta = (ClampMin = "0", ClampMax = "1"))
+	float Attack = 0.0f;
+
+	UPROPERTY(EditAnywhere, Category = Fighter, meta = (ClampMin = "0", ClampMax = "1"))
+	float Block = 0.0f;
+
+	UPROPERTY(EditAnywhere, Category = Fighter, meta = (ClampMin = "0", ClampMax = "1"))
+	float Duck = 0.0f;
+};
+
+/**
+ * Picks the next action of the fighter AI at random, with different chances whether the target enemy is attacking or not,
+ * and sets the bool key of the picked action (the keys of the others are cleared).
+ * While the target is not attacking, the chances lean towards TargetIsAttackingChances as much as its next attack is predictable,
+ * so the fighter gets ready for attacks it can anticipate.
+ */
+UCLASS()
+class PROJECTGAME_API UBTTask_FindNextAction : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_FindNextAction();
+
+	//~ Begin UBTTaskNode Interface
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	//~ End UBTTaskNode Interface
+
+	//~ Begin UBTNode Interface
+	virtual void InitializeFromAsset(UBehaviorTree& Asset) override;
+	virtual FString GetStaticDescription() const override;
+	//~ End UBTNode Interface
+
+	/** Chances of each action while the target enemy is attacking */
+	UPROPERTY(EditAnywhere, Category = Fighter)
+	FFighterActionChances TargetIsAttackingChances;
+
+	/** Chances of each action while the target enemy is not attacking */
+	UPROPERTY(EditAnywhere, Category = Fighter)
+	FFighterActionChances TargetIsNotAttackingChances;
+
+	/** How much a certain prediction of the next attack of the target moves the chances towards TargetIsAttackingChances */
+	UPROPERTY(EditAnywhere, Category = Fighter, meta = (ClampMin = "0", ClampMax = "1"))
+	float AnticipationWeight = 0.5f;
+
+	/** Bool key telling whether the target enemy is attacking */
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector TargetIsAttackingKey;
+
+	/** Bool keys of the actions */
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector AttackNextKey;
+
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector BlockNextKey;
+
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector DuckNextKey;
+
+	/** Optional float key with the confidence of the predicted next attack of the target enemy. @see UBTService_FighterState */
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector PredictedAttackConfidenceKey;
+};
@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BoxContact.h"
+#include "Components/BoxComponent.h"
+
+FOrientedBox::FOrientedBox(const FTransform& Transform, const FVector& BoxExtent)
+{
+	Center = Transform.GetLocation();
+	const FQuat Rotation = Transform.GetRotation();
+	Axes[0] = Rotation.GetAxisX();
+	Axes[1] = Rotation.GetAxisY();
+	Axes[2] = Rotation.GetAxisZ();
+	Extent = BoxExtent * Transform.GetScale3D().GetAbs();
+}
+
+FOrientedBox FOrientedBox::FromBoxComponent(const UBoxComponent* Box)
+{
+	return FOrientedBox(Box->GetComponentTransform(), Box->GetUnscaledBoxExtent());
+}
+
+FVector FOrientedBox::GetClosestPoint(const FVector& Point) const
+{
+	const FVector ToPoint = Point - Center;
+	FVector Closest = Center;
+	for (int32 i = 0; i < 3; i++) {
+		float Distance = FMath::Clamp(FVector::DotProduct(ToPoint, Axes[i]), -Extent[i], Extent[i]);
+		Closest += Axes[i] * Distance;
+	}
+	return Closest;
+}
+
+/** Returns the projection radius of a box onto an axis */
+static FORCEINLINE float ProjectedRadius(const FOrientedBox& Box, const FVector& Axis)
+{
+	return Box.Extent.X * FMath::Abs(FVector::DotProduct(Box.Axes[0], Axis))
+		+ Box.Extent.Y * FMath::Abs(FVector::DotProduct(Box.Axes[1], Axis))
+		+ Box.Extent.Z * FMath::Abs(FVector::DotProduct(Box.Axes[2], Axis));
+}
+
+/**
+ * Returns the center of the feature (face, edge or vertex) of the box that is furthest along Direction.
+ * Box axes almost perpendicular to Direction are considered to lie on the feature.
+ */
+static FORCEINLINE FVector SupportFeatureCenter(const FOrientedBox& Box, const FVector& Direction)
+{
+	static const float PerpendicularTolerance = 0.1f;
+
+	FVector Feature = Box.Center;
+	for (int32 i = 0; i < 3; i++) {
+		float Cos = FVector::DotProduct(Box.Axes[i], Direction);
+		if (Cos > PerpendicularTolerance) Feature += Box.Axes[i] * Box.Extent[i];
+		else if (Cos < -PerpendicularTolerance) Feature -= Box.Axes[i] * Box.Extent[i];
+	}
+	return Feature;
+}
+
+bool ComputeBoxContact(const FOrientedBox& A, const FOrientedBox& B, FBoxContact& OutContact)
+{
+	// Cross products of almost parallel edges are degenerate, and their face axes already cover that case
+	static const float MinAxisSizeSquared = 1.e-6f;
+
+	const FVector ToB = B.Center - A.Center;
+
+	float MinPenetration = MAX_flt;
+	FVector MinAxis = FVector::UpVector;
+
+	auto TestAxis = [&](const FVector& Axis) -> bool {
+		float Distance = FVector::DotProduct(ToB, Axis);
+		float Penetration = ProjectedRadius(A, Axis) + ProjectedRadius(B, Axis) - FMath::Abs(Distance);
+		if (Penetration < 0.0f) return false;
+		if (Penetration < MinPenetration) {
+			MinPenetration = Penetration;
+			MinAxis = Distance < 0.0f ? -Axis : Axis;
+		}
+		return true;
+	};
+
+	for (int32 i = 0; i < 3; i++) {
+		if (!TestAxis(A.Axes[i]) || !TestAxis(B.Axes[i])) return false;
+	}
+
+	for (int32 i = 0; i < 3; i++) {
+		for (int32 j = 0; j < 3; j++) {
+			FVector Axis = FVector::CrossProduct(A.Axes[i], B.Axes[j]);
+			float SizeSquared = Axis.SizeSquared();
+			if (SizeSquared < MinAxisSizeSquared) continue;
+			if (!TestAxis(Axis * FMath::InvSqrt(SizeSquared))) return false;
+		}
+	}
+
+	// Midpoint of the two supporting features, each clamped to the other box so it stays in the overlapping region
+	FVector FeatureA = B.GetClosestPoint(SupportFeatureCenter(A, MinAxis));
+	FVector FeatureB = A.GetClosestPoint(SupportFeatureCenter(B, -MinAxis));
+
+	OutContact.ImpactPoint = (FeatureA + FeatureB) * 0.5f;
+	OutContact.Normal = MinAxis;
+	OutContact.Penetration = MinPenetration;
+	return true;
+}
+
+/**
+ * Finds the interval of time [OutEnter, OutExit] (fractions of 0..1) in which box A, moving by Displacement, overlaps static box B.
+ * Both boxes keep their orientation. Returns false if they never overlap during the movement.
+ */
+static bool LinearSweepInterval(const FOrientedBox& A, const FVector& Displacement, const FOrientedBox& B, float& OutEnter, float& OutExit)
+{
+	static const float MinAxisSizeSquared = 1.e-6f;
+
+	const FVector ToB = B.Center - A.Center;
+	float Enter = 0.0f;
+	float Exit = 1.0f;
+
+	// Along an axis, the distance between centers is Distance - Speed * t, and the boxes overlap while it is within +-Radius
+	auto TestAxis = [&](const FVector& Axis) -> bool {
+		float Distance = FVector::DotProduct(ToB, Axis);
+		float Speed = FVector::DotProduct(Displacement, Axis);
+		float Radius = ProjectedRadius(A, Axis) + ProjectedRadius(B, Axis);
+
+		if (FMath::Abs(Speed) < KINDA_SMALL_NUMBER) return FMath::Abs(Distance) <= Radius;
+
+		float T0 = (Distance - Radius) / Speed;
+		float T1 = (Distance + Radius) / Speed;
+		if (T0 > T1) Swap(T0, T1);
+		Enter = FMath::Max(Enter, T0);
+		Exit = FMath::Min(Exit, T1);
+		return Enter <= Exit;
+	};
+
+	for (int32 i = 0; i < 3; i++) {
+		if (!TestAxis(A.Axes[i]) || !TestAxis(B.Axes[i])) return false;
+	}
+
+	for (int32 i = 0; i < 3; i++) {
+		for (int32 j = 0; j < 3; j++) {
+			FVector Axis = FVector::CrossProduct(A.Axes[i], B.Axes[j]);
+			float SizeSquared = Axis.SizeSquared();
+			if (SizeSquared < MinAxisSizeSquared) continue;
+			if (!TestAxis(Axis * FMath::InvSqrt(SizeSquared))) return false;
+		}
+	}
+
+	OutEnter = Enter;
+	OutExit = Exit;
+	return true;
+}
+
+bool SweepBoxContact(const FTransform& StartTransform, const FTransform& EndTransform, const FVector& BoxExtent,
+	const FOrientedBox& Target, FSweptBoxContact& OutContact)
+{
+	static const float MaxSubstepAngle = FMath::DegreesToRadians(15.0f);
+	static const int32 MaxSubsteps = 8;
+
+	const FQuat StartRotation = StartTransform.GetRotation();
+	const FQuat EndRotation = EndTransform.GetRotation();
+	const FVector StartLocation = StartTransform.GetLocation();
+	const FVector EndLocation = EndTransform.GetLocation();
+	const FVector Scale = EndTransform.GetScale3D();
+
+	int32 NumSubsteps = FMath::Clamp(FMath::CeilToInt(StartRotation.AngularDistance(EndRotation) / MaxSubstepAngle), 1, MaxSubsteps);
+
+	for (int32 Step = 0; Step < NumSubsteps; Step++) {
+		float StepStart = (float)Step / NumSubsteps;
+		float StepEnd = (float)(Step + 1) / NumSubsteps;
+
+		// Orientation of the middle of the substep, moving in a straight line from the substep start to its end
+		FQuat Rotation = FQuat::Slerp(StartRotation, EndRotation, (StepStart + StepEnd) * 0.5f);
+		FVector Location = FMath::Lerp(StartLocation, EndLocation, StepStart);
+		FVector Displacement = (EndLocation - StartLocation) * (StepEnd - StepStart);
+		FOrientedBox Moving(FTransform(Rotation, Location, Scale), BoxExtent);
+
+		float Enter, Exit;
+		if (!LinearSweepInterval(Moving, Displacement, Target, Enter, Exit)) continue;
+
+		// The boxes overlap the most in the middle of the overlap interval, so the contact is computed there
+		FOrientedBox Overlapping = Moving;
+		Overlapping.Center += Displacement * ((Enter + Exit) * 0.5f);
+		if (!ComputeBoxContact(Overlapping, Target, OutContact.Contact)) {
+			OutContact.Contact.ImpactPoint = Target.GetClosestPoint(Overlapping.Center);
+			OutContact.Contact.Normal = (Target.Center - Overlapping.Center).GetSafeNormal();
+			OutContact.Contact.Penetration = 0.0f;
+		}
+		OutContact.Time = FMath::Lerp(StepStart, StepEnd, Enter);
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UBoxComponent;
+
+/**
+ * Oriented box in world space: a center, three unit axes and the half size of the box along each axis.
+ * Used to compute contacts between collision boxes without querying the physics scene.
+ */
+struct PROJECTGAME_API FOrientedBox
+{
+	FVector Center;
+	FVector Axes[3];
+	FVector Extent;
+
+	FOrientedBox() {}
+
+	/**
+	 * @param Transform		world transform of the box. Its scale is applied to BoxExtent
+	 * @param BoxExtent		unscaled half size of the box
+	 */
+	FOrientedBox(const FTransform& Transform, const FVector& BoxExtent);
+
+	/** Returns the current oriented box of a box component */
+	static FOrientedBox FromBoxComponent(const UBoxComponent* Box);
+
+	/** Returns the point inside the box that is closest to the specified point */
+	FVector GetClosestPoint(const FVector& Point) const;
+};
+
+/** Result of a contact between two oriented boxes */
+struct FBoxContact
+{
+	/** Point of impact, in the middle of the overlapping region */
+	FVector ImpactPoint;
+
+	/** Contact normal, pointing from the first box to the second */
+	FVector Normal;
+
+	/** Penetration depth along Normal */
+	float Penetration;
+};
+
+/**
+ * Computes the contact between two oriented boxes using the Separating Axis Theorem.
+ * The normal is the axis of least penetration among the 15 candidate axes
+ * (3 face axes of each box and the 9 cross products of their edges).
+ * The impact point is the midpoint of the supporting features of both boxes along the normal,
+ * each one clamped to the other box, which keeps it inside the overlapping region.
+ *
+ * @param A				first box (usually the weapon box)
+ * @param B				second box (usually the damage box)
+ * @param OutContact	contact between the boxes. Only set if the boxes overlap
+ * @return true if the boxes overlap
+ */
+PROJECTGAME_API bool ComputeBoxContact(const FOrientedBox& A, const FOrientedBox& B, FBoxContact& OutContact);
+
+/** Result of sweeping an oriented box against another one */
+struct FSweptBoxContact
+{
+	/** Time of impact, as a fraction of the sweep (0 = start transform, 1 = end transform) */
+	float Time;
+
+	/** Contact between the boxes just after the time of impact */
+	FBoxContact Contact;
+};
+
+/**
+ * Sweeps a box from a start transform to an end transform against a static oriented box and finds the earliest time of impact.
+ * The sweep is split in substeps of at most MaxSubstepAngle degrees of rotation. In each substep the box keeps a fixed orientation
+ * and moves in a straight line, so the Separating Axis Theorem gives the exact interval of time in which the boxes overlap.
+ * Used to detect hits of fast weapons that pass through a damage box between two frames.
+ *
+ * @param StartTransform	world transform of the moving box at the start of the sweep
+ * @param EndTransform		world transform of the moving box at the end of the sweep
+ * @param BoxExtent			unscaled half size of the moving box
+ * @param Target			static box
+ * @param OutContact		earliest contact. Only set if the boxes overlap at some point of the sweep
+ * @return true if the boxes overlap at some point of the sweep
+ */
+PROJECTGAME_API bool SweepBoxContact(const FTransform& StartTransform, const FTransform& EndTransform, const FVector& BoxExtent,
+	const FOrientedBox& Target, FSweptBoxContact& OutContact);
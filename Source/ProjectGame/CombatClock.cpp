@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatClock.h"
+#include "FightingStats.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+
+UCombatClock* UCombatClock::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	return World != NULL ? World->GetSubsystem<UCombatClock>() : NULL;
+}
+
+void UCombatClock::Step()
+{
+	Frame++;
+	OnCombatStep.Broadcast(Frame);
+}
+
+void UCombatClock::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (World == NULL || World->IsPaused()) return;
+
+	// Delta time of the world, scaled by its time dilation and the global time dilation
+	const float StepTime = GetStepTime();
+	Accumulator += World->GetDeltaSeconds();
+
+	int32 Steps = 0;
+	while (Accumulator >= StepTime && Steps < MaxStepsPerFrame) {
+		Accumulator -= StepTime;
+		Step();
+		Steps++;
+	}
+
+	// Drop the time that could not be simulated, so a long hitch does not make the following frames run many steps
+	if (Accumulator >= StepTime) Accumulator = FMath::Fmod(Accumulator, StepTime);
+}
+
+ETickableTickType UCombatClock::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+UWorld* UCombatClock::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UCombatClock::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatClock, STATGROUP_Fighting);
+}
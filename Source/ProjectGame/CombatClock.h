@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "CombatClock.generated.h"
+
+/** Broadcast once per combat step with the number of the new combat frame */
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCombatStep, int32 /* Frame */);
+
+/**
+ * Fixed timestep clock of the combat rules.
+ * The time of each rendered frame is accumulated and the combat state is advanced in steps of exactly 1 / TickRate seconds (GetStepTime()),
+ * numbered by an integer frame counter. Combat rules measure their windows and cooldowns in combat frames instead of
+ * float seconds, so the same inputs give the same outcome at any frame rate.
+ * Visuals can interpolate between the last two combat steps with GetInterpolationAlpha().
+ * The clock only advances with its own world: it stops while the world is paused and follows its time dilation.
+ */
+UCLASS()
+class PROJECTGAME_API UCombatClock : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Number of combat steps per second */
+	static const int32 TickRate = 60;
+
+	/** Returns the duration of a combat step in seconds */
+	static FORCEINLINE float GetStepTime() { return 1.0f / TickRate; }
+
+	/** Maximum number of combat steps run in one rendered frame. After a longer hitch the remaining time is dropped */
+	static const int32 MaxStepsPerFrame = 8;
+
+	/** Converts a duration in seconds to a number of combat frames (rounded) */
+	static FORCEINLINE int32 SecondsToFrames(float Seconds) { return FMath::RoundToInt(Seconds * TickRate); }
+
+	/** Returns the combat clock of the world of an object, or NULL */
+	static UCombatClock* Get(const UObject* WorldContextObject);
+
+	/** Returns the number of the current combat frame */
+	FORCEINLINE int32 GetFrame() const { return Frame; }
+
+	/** Returns the fraction (0..1) of a combat step elapsed since the current combat frame, for interpolating visuals */
+	FORCEINLINE float GetInterpolationAlpha() const { return Accumulator * TickRate; }
+
+	/** Returns the time of the current combat frame in seconds */
+	FORCEINLINE float GetFrameTime() const { return Frame * GetStepTime(); }
+
+	/**
+	 * Advances the combat state by one step without waiting for real time. Used to run simulations faster than real time.
+	 */
+	void Step();
+
+	/**
+	 * Sets the number of the current combat frame without broadcasting OnCombatStep.
+	 * Used when a rollback session restores or resimulates earlier frames.
+	 */
+	FORCEINLINE void SetFrame(int32 NewFrame) { Frame = NewFrame; }
+
+	/** Broadcast once per combat step, after the frame counter is incremented */
+	FOnCombatStep OnCombatStep;
+
+	//~ Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject Interface
+
+protected:
+	/** Number of the current combat frame */
+	int32 Frame = 0;
+
+	/** Time accumulated since the current combat frame, always less than a step */
+	float Accumulator = 0.0f;
+};
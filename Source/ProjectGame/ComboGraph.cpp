@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ComboGraph.h"
+
+FComboGraph::FComboGraph()
+{
+	AddState(TEXT(""));
+}
+
+int32 FComboGraph::AddState(const FString& Sequence)
+{
+	int32 State = Sequences.Add(Sequence);
+	Montages.Add(nullptr);
+	bDefined.Add(false);
+	Transitions.AddUninitialized(NumComboInputs);
+	for (int32 i = 0; i < NumComboInputs; i++) {
+		Transitions[State * NumComboInputs + i] = INDEX_NONE;
+	}
+	return State;
+}
+
+void FComboGraph::Build(const TArray<FComboDefinition>& Combos, const FString& OwnerName)
+{
+	Transitions.Reset();
+	Sequences.Reset();
+	Montages.Reset();
+	bDefined.Reset();
+	AddState(TEXT(""));
+
+	for (const FComboDefinition& Combo : Combos) {
+		const FString& Sequence = Combo.Sequence;
+		if (Sequence.IsEmpty()) {
+			UE_LOG(LogTemp, Warning, TEXT("%s: empty combo sequence ignored"), *OwnerName);
+			continue;
+		}
+
+		// Check the sequence is valid and can be reached:
+		// Move Modifier and Duck only start a sequence, and Taunt starts a sequence or repeats once as its variant ("55")
+		bool bValid = true;
+		for (int32 i = 0; i < Sequence.Len() && bValid; i++) {
+			EComboInput Input = InputFromChar(Sequence[i]);
+			if (Input == EComboInput::None) {
+				UE_LOG(LogTemp, Warning, TEXT("%s: combo sequence \"%s\" has invalid character '%c'"), *OwnerName, *Sequence, Sequence[i]);
+				bValid = false;
+			}
+			else if (i > 0 && Input != EComboInput::Attack1 && Input != EComboInput::Attack2) {
+				bool bTauntVariant = i == 1 && Sequence[0] == Sequence[1]
+					&& (Input == EComboInput::TauntAttack1 || Input == EComboInput::TauntAttack2);
+				if (!bTauntVariant) {
+					UE_LOG(LogTemp, Warning, TEXT("%s: combo sequence \"%s\" can never be reached"), *OwnerName, *Sequence);
+					bValid = false;
+				}
+			}
+		}
+		if (!bValid) continue;
+
+		// Walk the sequence from the root, adding the states that don't exist yet
+		int32 State = RootState;
+		for (int32 i = 0; i < Sequence.Len(); i++) {
+			int32 Transition = State * NumComboInputs + (int32)InputFromChar(Sequence[i]);
+			if (Transitions[Transition] == INDEX_NONE) {
+				int32 NewState = AddState(Sequence.Left(i + 1));
+				Transitions[Transition] = NewState;
+			}
+			State = Transitions[Transition];
+		}
+
+		if (bDefined[State]) {
+			UE_LOG(LogTemp, Warning, TEXT("%s: combo sequence \"%s\" is defined more than once. Only the first definition is used"), *OwnerName, *Sequence);
+			continue;
+		}
+		bDefined[State] = true;
+		Montages[State] = Combo.Montage;
+	}
+
+	// Every prefix of a sequence is played on the way to it, so it should be a combo too
+	for (int32 State = 1; State < Sequences.Num(); State++) {
+		if (!bDefined[State]) {
+			UE_LOG(LogTemp, Warning, TEXT("%s: combo sequence \"%s\" is not defined, but longer sequences start with it"), *OwnerName, *Sequences[State]);
+		}
+	}
+}
+
+EComboInput FComboGraph::InputFromChar(TCHAR Char)
+{
+	switch (Char) {
+	case TEXT('1'): return EComboInput::Attack1;
+	case TEXT('2'): return EComboInput::Attack2;
+	case TEXT('3'): return EComboInput::MoveModAttack1;
+	case TEXT('4'): return EComboInput::MoveModAttack2;
+	case TEXT('5'): return EComboInput::TauntAttack1;
+	case TEXT('6'): return EComboInput::TauntAttack2;
+	case TEXT('0'): return EComboInput::DuckAttack;
+	default: return EComboInput::None;
+	}
+}
+
+TCHAR FComboGraph::CharFromInput(EComboInput Input)
+{
+	static const TCHAR Chars[NumComboInputs] = { TEXT('1'), TEXT('2'), TEXT('3'), TEXT('4'), TEXT('5'), TEXT('6'), TEXT('0') };
+	return Input != EComboInput::None ? Chars[(int32)Input] : TEXT('\0');
+}
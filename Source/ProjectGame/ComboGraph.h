@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ComboGraph.generated.h"
+
+class UAnimMontage;
+
+/**
+ * EComboInput is an Enum that enumerates the inputs that make a combo sequence progress.
+ * Each input has a character in combo sequence strings (shown between brackets):
+ * Attack 1 ("1"), Attack 2 ("2"), Move Modifier + Attack 1 ("3"), Move Modifier + Attack 2 ("4"),
+ * Taunt + Attack 1 ("5"), Taunt + Attack 2 ("6"), Duck + any attack ("0")
+ */
+UENUM(BlueprintType)
+enum class EComboInput : uint8
+{
+	Attack1, Attack2, MoveModAttack1, MoveModAttack2, TauntAttack1, TauntAttack2, DuckAttack,
+	None UMETA(Hidden)
+};
+
+/** Number of different combo inputs */
+static const int32 NumComboInputs = (int32)EComboInput::None;
+
+/**
+ * Describes one combo sequence, such as "212" (Attack 2, followed by Attack 1, followed by Attack 2)
+ * and the Animation Montage that is played when the sequence is reached.
+ */
+USTRUCT(BlueprintType)
+struct FComboDefinition
+{
+	GENERATED_BODY()
+
+	/** Combo sequence string. @see EComboInput for the meaning of each character */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combo)
+	FString Sequence;
+
+	/** Animation Montage played when the sequence is reached. Can be left empty if the animation blueprint selects it */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combo)
+	UAnimMontage* Montage = nullptr;
+};
+
+/**
+ * Combo state machine compiled from a list of combo sequences.
+ * Each prefix of a sequence is a state with an integer id (the empty sequence is RootState),
+ * and transitions between states are stored in a flat [state][input] table,
+ * so advancing a combo is a single array lookup and never allocates.
+ *
+ * Sequences that can never be reached are reported when the graph is built.
+ */
+struct PROJECTGAME_API FComboGraph
+{
+	/** Id of the state of the empty sequence, i.e. when no combo is being performed */
+	static const int32 RootState = 0;
+
+	FComboGraph();
+
+	/**
+	 * Builds the state machine from the specified combo sequences, discarding the previous one.
+	 * Invalid or unreachable sequences are logged and skipped.
+	 *
+	 * @param Combos		list of combo sequences
+	 * @param OwnerName		name of the owner of the combos, used in the log messages
+	 */
+	void Build(const TArray<FComboDefinition>& Combos, const FString& OwnerName);
+
+	/**
+	 * Returns the state reached by applying the specified input on the specified state,
+	 * or INDEX_NONE if that sequence does not exist
+	 */
+	FORCEINLINE int32 Advance(int32 State, EComboInput Input) const
+	{
+		return Transitions[State * NumComboInputs + (int32)Input];
+	}
+
+	/** Returns true if the specified state corresponds to a combo sequence that was defined */
+	FORCEINLINE bool IsComboState(int32 State) const { return bDefined[State]; }
+
+	/** Returns the combo sequence string of the specified state */
+	FORCEINLINE const FString& GetSequence(int32 State) const { return Sequences[State]; }
+
+	/** Returns the Animation Montage of the specified state, or nullptr if none was set */
+	FORCEINLINE UAnimMontage* GetMontage(int32 State) const { return Montages[State]; }
+
+	/** Returns the number of states of the graph, including RootState */
+	FORCEINLINE int32 GetNumStates() const { return Sequences.Num(); }
+
+	/** Returns the combo input of the specified sequence character, or EComboInput::None if it is not valid */
+	static EComboInput InputFromChar(TCHAR Char);
+
+	/** Returns the sequence character of the specified combo input */
+	static TCHAR CharFromInput(EComboInput Input);
+
+protected:
+	/** Adds a new state for the specified sequence and returns its id */
+	int32 AddState(const FString& Sequence);
+
+	/** Transition table, indexed by [State * NumComboInputs + Input] */
+	TArray<int32> Transitions;
+
+	/** Combo sequence string of each state */
+	TArray<FString> Sequences;
+
+	/** Animation Montage of each state */
+	TArray<UAnimMontage*> Montages;
+
+	/** Tracks if each state corresponds to a defined combo sequence, or is just a prefix of one */
+	TArray<bool> bDefined;
+};
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ComboPredictor.h"
+
+FComboPredictor::FComboPredictor()
+{
+	Reset();
+}
+
+void FComboPredictor::Reset()
+{
+	FMemory::Memzero(Contexts);
+	FMemory::Memzero(Counts);
+	HistoryLength = 0;
+	NumObserved = 0;
+}
+
+uint32 FComboPredictor::GetContextKey(int32 Length) const
+{
+	// The length is part of the key, so contexts of different orders do not share entries
+	uint32 key = GetTypeHash(Length + 1);
+	for (int32 i = HistoryLength - Length; i < HistoryLength; i++) key = HashCombine(key, GetTypeHash(History[i]));
+	return key | 1;
+}
+
+void FComboPredictor::Count(uint32 ContextKey, uint16 Attack)
+{
+	FContextSlot& context = Contexts[ContextKey & (NumContextSlots - 1)];
+	if (context.Key != ContextKey) {
+		context.Key = ContextKey;
+		context.Total = context.BestCount = 0;
+		context.Best = Attack;
+	}
+
+	uint32 countKey = HashCombine(ContextKey, GetTypeHash(Attack)) | 1;
+	FCountSlot& count = Counts[countKey & (NumCountSlots - 1)];
+	if (count.Key != countKey) {
+		count.Key = countKey;
+		count.Count = 0;
+	}
+
+	if (count.Count < MAX_uint16) count.Count++;
+	if (context.Total < MAX_uint16) context.Total++;
+
+	// Only the count of the observed attack changed, so it is the only one that can overtake the most frequent one.
+	// The count slot of the most frequent attack may have been taken by another key and started over: its best count is kept
+	if (context.Best == Attack) context.BestCount = FMath::Max(context.BestCount, count.Count);
+	else if (count.Count >= context.BestCount) {
+		context.Best = Attack;
+		context.BestCount = count.Count;
+	}
+}
+
+void FComboPredictor::Observe(int32 Attack)
+{
+	if (Attack < 0 || Attack >= MAX_uint16) return;
+
+	for (int32 length = 0; length <= HistoryLength; length++) Count(GetContextKey(length), (uint16)Attack);
+
+	if (HistoryLength == Order) {
+		for (int32 i = 1; i < Order; i++) History[i - 1] = History[i];
+		HistoryLength--;
+	}
+	History[HistoryLength++] = (uint16)Attack;
+	NumObserved++;
+}
+
+int32 FComboPredictor::PredictNext(float& OutConfidence) const
+{
+	OutConfidence = 0.0f;
+
+	// Falls back to shorter contexts until one has been seen often enough
+	for (int32 length = HistoryLength; length >= 0; length--) {
+		uint32 key = GetContextKey(length);
+		const FContextSlot& context = Contexts[key & (NumContextSlots - 1)];
+		if (context.Key != key || context.Total < MinSamples) continue;
+
+		OutConfidence = (float)context.BestCount / (float)context.Total;
+		return context.Best;
+	}
+	return INDEX_NONE;
+}
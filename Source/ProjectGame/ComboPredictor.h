@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Online n-gram model of the attacks of a fighter, used by the AI to anticipate the next attack of its opponent.
+ * Attacks are identified by the combo state they reach (@see FComboGraph), so the same input is a different attack
+ * at the start and in the middle of a combo.
+ * For every context of the last 0 to Order attacks, the model counts the attacks that followed it in fixed-size hashed tables,
+ * and keeps the most frequent one up to date as each attack is observed. Observing an attack and predicting the next one
+ * cost the same whatever the length of the match, and the model never allocates. Colliding entries replace each other,
+ * so rare contexts may be forgotten.
+ */
+struct PROJECTGAME_API FComboPredictor
+{
+	/** Number of previous attacks in the longest context */
+	static const int32 Order = 2;
+
+	/** Number of entries of the context table and of the count table. Powers of two */
+	static const int32 NumContextSlots = 256;
+	static const int32 NumCountSlots = 1024;
+
+	/** Number of times a context must have been seen before it is used to predict */
+	static const int32 MinSamples = 2;
+
+	FComboPredictor();
+
+	/** Forgets all observed attacks */
+	void Reset();
+
+	/**
+	 * Counts an attack as following the current context, then appends it to the context
+	 *
+	 * @param Attack	combo state reached by the attack
+	 */
+	void Observe(int32 Attack);
+
+	/**
+	 * Returns the most likely next attack after the current context, using the longest context seen at least MinSamples times
+	 *
+	 * @param OutConfidence		fraction of the times the context was followed by the returned attack. 0 if there is no prediction
+	 * @return combo state of the most likely next attack, or INDEX_NONE if no context was seen MinSamples times yet
+	 */
+	int32 PredictNext(float& OutConfidence) const;
+
+	/** Returns the number of attacks observed since the last Reset() */
+	FORCEINLINE int32 GetNumObserved() const { return NumObserved; }
+
+private:
+	/** Attacks observed after a context, and the most frequent of them */
+	struct FContextSlot
+	{
+		uint32 Key;
+		uint16 Total;
+		uint16 BestCount;
+		uint16 Best;
+	};
+
+	/** Times an attack followed a context */
+	struct FCountSlot
+	{
+		uint32 Key;
+		uint16 Count;
+	};
+
+	/** Returns the key of the context made of the last Length attacks. Keys are never 0, which marks empty slots */
+	uint32 GetContextKey(int32 Length) const;
+
+	/** Counts an attack after the context of the specified key */
+	void Count(uint32 ContextKey, uint16 Attack);
+
+	FContextSlot Contexts[NumContextSlots];
+	FCountSlot Counts[NumCountSlots];
+
+	/** Last Order attacks, the most recent last */
+	uint16 History[Order];
+	int32 HistoryLength;
+
+	int32 NumObserved;
+};
@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FighterAIScheduler.h"
+#include "FightingStats.h"
+#include "FightingCharacter.h"
+#include "AIController.h"
+#include "BrainComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+
+static TAutoConsoleVariable<int32> CVarAISchedulerEnable(
+	TEXT("Fighting.AIScheduler.Enable"),
+	1,
+	TEXT("1: the behaviour trees of AI fighters are updated by the fighter AI scheduler, under Fighting.AIScheduler.BudgetMs.\n")
+	TEXT("0: every AI fighter updates its behaviour tree every frame.\n")
+	TEXT("Read when a FightingCharacter begins play."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAISchedulerBudgetMs(
+	TEXT("Fighting.AIScheduler.BudgetMs"),
+	0.5f,
+	TEXT("Game thread time in milliseconds the fighter AI scheduler spends updating behaviour trees in one frame.\n")
+	TEXT("At least one fighter is updated every frame."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarAISchedulerFixedStepDecisions(
+	TEXT("Fighting.AIScheduler.FixedStepDecisions"),
+	0,
+	TEXT("Number of fighters the fighter AI scheduler updates in one frame when the engine uses a fixed time step, instead of\n")
+	TEXT("Fighting.AIScheduler.BudgetMs, so the decisions are the same on any CPU. 0: every fighter."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAISchedulerStrikeDistance(
+	TEXT("Fighting.AIScheduler.StrikeDistance"),
+	200.0f,
+	TEXT("Distance to its target under which the decisions of an AI fighter are urgent."),
+	ECVF_Default);
+
+const float UFighterAIScheduler::UrgentPriorityScale = 4.0f;
+
+bool UFighterAIScheduler::IsEnabled()
+{
+	return CVarAISchedulerEnable.GetValueOnGameThread() != 0;
+}
+
+void UFighterAIScheduler::Deinitialize()
+{
+	for (FScheduledFighter& scheduled : Fighters) ReleaseBrain(scheduled);
+	Fighters.Empty();
+	Super::Deinitialize();
+}
+
+void UFighterAIScheduler::RegisterFighter(AFightingCharacter* Fighter)
+{
+	if (Fighter == NULL || Fighters.ContainsByPredicate([Fighter](const FScheduledFighter& Scheduled) { return Scheduled.Fighter.Get() == Fighter; })) return;
+
+	FScheduledFighter& scheduled = Fighters.AddDefaulted_GetRef();
+	scheduled.Fighter = Fighter;
+	scheduled.LastUpdateTime = 0.0f;
+	scheduled.Priority = 0.0f;
+}
+
+void UFighterAIScheduler::UnregisterFighter(AFightingCharacter* Fighter)
+{
+	int32 index = Fighters.IndexOfByPredicate([Fighter](const FScheduledFighter& Scheduled) { return Scheduled.Fighter.Get() == Fighter; });
+	if (index == INDEX_NONE) return;
+
+	ReleaseBrain(Fighters[index]);
+	Fighters.RemoveAtSwap(index);
+}
+
+UBrainComponent* UFighterAIScheduler::TakeOverBrain(FScheduledFighter& Scheduled, float CurrentTime, float DeltaTime)
+{
+	// AI controllers usually start their behaviour tree after possessing the fighter, so the brain is looked up every frame
+	AFightingCharacter* fighter = Scheduled.Fighter.Get();
+	AAIController* controller = fighter != NULL ? Cast<AAIController>(fighter->GetController()) : NULL;
+	UBrainComponent* brain = controller != NULL ? controller->GetBrainComponent() : NULL;
+
+	if (brain != Scheduled.Brain.Get()) {
+		ReleaseBrain(Scheduled);
+		Scheduled.Brain = brain;
+		// As if the brain had been updated in the previous frame
+		Scheduled.LastUpdateTime = CurrentTime - DeltaTime;
+	}
+
+	// Restarting the logic of a brain can enable its tick again
+	if (brain != NULL && brain->IsComponentTickEnabled()) brain->SetComponentTickEnabled(false);
+	return brain;
+}
+
+void UFighterAIScheduler::ReleaseBrain(FScheduledFighter& Scheduled)
+{
+	if (UBrainComponent* brain = Scheduled.Brain.Get()) brain->SetComponentTickEnabled(true);
+	Scheduled.Brain.Reset();
+}
+
+bool UFighterAIScheduler::IsUrgent(AFightingCharacter* Fighter, float StrikeDistanceSquared)
+{
+	if (Fighter->Reaction != ReactType::NoReact) return true;
+
+	AFightingCharacter* target = Fighter->GetTargetEnemy();
+	if (target == NULL) return false;
+	return target->IsAttacking || FVector::DistSquared2D(Fighter->GetActorLocation(), target->GetActorLocation()) <= StrikeDistanceSquared;
+}
+
+void UFighterAIScheduler::Tick(float DeltaTime)
+{
+	UWorld* world = GetWorld();
+	if (world == NULL || world->IsPaused()) return;
+
+	FIGHTING_SCOPE_CYCLE_COUNTER(AIScheduler);
+
+	const float currentTime = world->GetTimeSeconds();
+	const float strikeDistance = CVarAISchedulerStrikeDistance.GetValueOnGameThread();
+
+	// Fighters destroyed without EndPlay (e.g. with their level) are dropped
+	for (int32 i = Fighters.Num() - 1; i >= 0; i--) {
+		if (Fighters[i].Fighter.IsValid()) continue;
+		ReleaseBrain(Fighters[i]);
+		Fighters.RemoveAtSwap(i);
+	}
+
+	// Fighters that waited the longest go first, urgent ones waiting less for the same priority
+	UpdateOrder.Reset();
+	for (int32 i = 0; i < Fighters.Num(); i++) {
+		FScheduledFighter& scheduled = Fighters[i];
+		if (TakeOverBrain(scheduled, currentTime, DeltaTime) == NULL) continue;
+
+		float waited = currentTime - scheduled.LastUpdateTime;
+		scheduled.Priority = IsUrgent(scheduled.Fighter.Get(), strikeDistance * strikeDistance) ? waited * UrgentPriorityScale : waited;
+		UpdateOrder.Add(i);
+	}
+	UpdateOrder.Sort([this](int32 A, int32 B) { return Fighters[A].Priority > Fighters[B].Priority; });
+
+	// A time budget would make the order of the decisions, and of the random numbers they draw, depend on the CPU
+	const bool bFixedStep = FApp::UseFixedTimeStep();
+	const int32 fixedStepDecisions = CVarAISchedulerFixedStepDecisions.GetValueOnGameThread();
+	const int32 maxDecisions = bFixedStep && fixedStepDecisions > 0 ? fixedStepDecisions : UpdateOrder.Num();
+
+	const double budget = CVarAISchedulerBudgetMs.GetValueOnGameThread() / 1000.0;
+	const uint64 startCycles = FPlatformTime::Cycles64();
+	int32 decisions = 0;
+
+	for (int32 index : UpdateOrder) {
+		if (decisions >= maxDecisions) break;
+		if (!bFixedStep && decisions > 0 && FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - startCycles) >= budget) break;
+
+		FScheduledFighter& scheduled = Fighters[index];
+		UBrainComponent* brain = scheduled.Brain.Get();
+		if (brain == NULL) continue;
+
+		// The brain catches up with all the time it waited, so timers and latent tasks keep their real duration
+		brain->TickComponent(currentTime - scheduled.LastUpdateTime, LEVELTICK_All, &brain->PrimaryComponentTick);
+		scheduled.LastUpdateTime = currentTime;
+		decisions++;
+	}
+
+	FIGHTING_INC_COUNTER_BY(AIDecisions, decisions);
+	FIGHTING_INC_COUNTER_BY(AISkippedUpdates, UpdateOrder.Num() - decisions);
+}
+
+ETickableTickType UFighterAIScheduler::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UFighterAIScheduler::IsTickable() const
+{
+	return Fighters.Num() > 0;
+}
+
+UWorld* UFighterAIScheduler::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UFighterAIScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFighterAIScheduler, STATGROUP_Fighting);
+}
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "FighterAIScheduler.generated.h"
+
+class AFightingCharacter;
+class UBrainComponent;
+
+/**
+ * Spreads the decision updates of the AI fighters of a world across frames, under a game thread budget.
+ * The scheduler takes over the brain component (behaviour tree) of each registered fighter's AI controller and disables its tick.
+ * Every frame it sorts the fighters by how long they have been waiting, weighted up for the urgent ones (within striking distance
+ * of their target, reacting to a hit or facing an attack), then ticks their brains in that order with the time elapsed since
+ * their last update, until Fighting.AIScheduler.BudgetMs is spent. At least one fighter is updated every frame.
+ * The cost of the AI stays within the budget whatever the number of fighters; fighters only decide less often.
+ * With a fixed time step (e.g. in the match harness) the decisions must not depend on the speed of the CPU, so a fixed number of
+ * fighters, Fighting.AIScheduler.FixedStepDecisions, is updated every frame instead.
+ * Decisions and skipped updates of each frame are counted in "stat Fighting".
+ * Enabled with the console variable Fighting.AIScheduler.Enable (read when a fighter begins play).
+ */
+UCLASS()
+class PROJECTGAME_API UFighterAIScheduler : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns true if the decisions of AI fighters should be scheduled */
+	static bool IsEnabled();
+
+	/** Registers a fighter. Called in AFightingCharacter::BeginPlay(). Fighters not controlled by an AI controller are ignored until they are */
+	void RegisterFighter(AFightingCharacter* Fighter);
+
+	/** Unregisters a fighter and gives the tick of its brain back. Called in AFightingCharacter::EndPlay() */
+	void UnregisterFighter(AFightingCharacter* Fighter);
+
+	//~ Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	//~ Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject Interface
+
+protected:
+	/** How much faster the priority of an urgent fighter grows while it waits */
+	static const float UrgentPriorityScale;
+
+	struct FScheduledFighter
+	{
+		TWeakObjectPtr<AFightingCharacter> Fighter;
+
+		/** Brain taken over from the fighter's AI controller. Invalid until the controller runs one */
+		TWeakObjectPtr<UBrainComponent> Brain;
+
+		/** World time of the last update of the brain */
+		float LastUpdateTime;
+
+		/** Priority of the fighter this frame */
+		float Priority;
+	};
+
+	/**
+	 * Returns the current brain of a fighter and makes sure its tick is disabled, releasing the previous brain if it changed
+	 *
+	 * @param Scheduled		fighter to update the brain of
+	 * @param CurrentTime	world time of this frame
+	 * @param DeltaTime		duration of this frame
+	 * @return the brain of the fighter, or NULL if it is not controlled by an AI controller running one
+	 */
+	UBrainComponent* TakeOverBrain(FScheduledFighter& Scheduled, float CurrentTime, float DeltaTime);
+
+	/** Enables the tick of the brain taken over from a fighter again */
+	void ReleaseBrain(FScheduledFighter& Scheduled);
+
+	/** Returns true if the decisions of a fighter cannot wait: it is within striking distance, reacting to a hit or facing an attack */
+	static bool IsUrgent(AFightingCharacter* Fighter, float StrikeDistanceSquared);
+
+	/** Registered fighters. Fighters destroyed without being unregistered are dropped in the next tick */
+	TArray<FScheduledFighter> Fighters;
+
+	/** Indices in Fighters of the fighters with a brain, by decreasing priority. Rebuilt every frame */
+	TArray<int32> UpdateOrder;
+};
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FightingCharacter.h"
+#include "LimbVelocitySampler.h"
+
+/**
+ * Buttons and movement of a fighter in one combat frame. Sent over the network every frame, so it is kept at 4 bytes.
+ */
+struct FFighterInput
+{
+	/** Bits of Buttons */
+	enum EButton : uint16
+	{
+		Attack1 = 1 << 0,
+		Attack2 = 1 << 1,
+		Block = 1 << 2,
+		Duck = 1 << 3,
+		MoveMod = 1 << 4,
+		Taunt = 1 << 5,
+		Run = 1 << 6,
+		Jump = 1 << 7
+	};
+
+	/** Buttons being pressed */
+	uint16 Buttons = 0;
+
+	/** World space movement direction, quantized to -127..127 on each axis */
+	int8 MoveX = 0;
+	int8 MoveY = 0;
+
+	FORCEINLINE bool IsPressed(EButton Button) const { return (Buttons & Button) != 0; }
+
+	FORCEINLINE bool operator==(const FFighterInput& Other) const
+	{
+		return Buttons == Other.Buttons && MoveX == Other.MoveX && MoveY == Other.MoveY;
+	}
+	FORCEINLINE bool operator!=(const FFighterInput& Other) const { return !(*this == Other); }
+};
+
+static_assert(sizeof(FFighterInput) == 4, "FFighterInput is sent every frame and must stay small");
+
+/** Press waiting in the input buffer of a fighter, as saved in FFighterState. @see FBufferedInput */
+struct FSavedPress
+{
+	/** Combat frame of the press */
+	int32 Frame;
+
+	/** Bits of the actions held right after the press */
+	uint16 HeldMask;
+
+	/** EFighterAction pressed */
+	uint8 Action;
+};
+
+/**
+ * Gameplay state of a fighter in one combat frame, as saved by AFightingCharacter::SaveState().
+ * Plain data of fixed size, so it can be copied with memcpy and kept in ring buffers.
+ */
+struct FFighterState
+{
+	/** Number of pending presses of the input buffer kept in the state. Presses are only pending for the buffer window */
+	static const int32 MaxPendingPresses = 8;
+
+	/** Bits of Flags */
+	enum EFlag : uint32
+	{
+		CanMove = 1 << 0,
+		CanJump = 1 << 1,
+		CanAttack = 1 << 2,
+		CanBlock = 1 << 3,
+		CanDuck = 1 << 4,
+		CanAddNextComboAttack = 1 << 5,
+		IsAttacking = 1 << 6,
+		IsBlocking = 1 << 7,
+		IsDucking = 1 << 8,
+		MoveModPressed = 1 << 9,
+		TauntPressed = 1 << 10,
+		Defeated = 1 << 11,
+		IsRunning = 1 << 12,
+		Attack1 = 1 << 13,
+		Attack2 = 1 << 14,
+		TrackFists = 1 << 15,
+		TrackFeet = 1 << 16
+	};
+
+	/** Combat frame the state was saved in */
+	int32 Frame;
+
+	/** Actor location, yaw and velocity */
+	FVector Location;
+	float Yaw;
+	FVector Velocity;
+
+	/** Current max walk speed of the movement component */
+	float MovementMaxWalkSpeed;
+
+	/** Body part table and health */
+	float HealthPoints;
+	float DamagePotential[NumBodyParts];
+	int32 LastDamageTakenFrame[NumBodyParts];
+	int32 LastArmsOverlapFrame;
+
+	/** Combo state machine state and seed of the random stream of the taunt variants */
+	int32 ComboState;
+	int32 ComboRandomSeed;
+
+	/** Results of the current attack */
+	float LastAttackImpactVel;
+	int32 LastAttackPoints;
+
+	/** Maximum velocity reached by each limb in the current attack, indexed by ELimb */
+	float PeakLimbVelocity[NumLimbs];
+
+	/** Position in the attack montage being played */
+	float MontagePosition;
+
+	/** Id in the AttackCatalog of the attack montage being played, or INDEX_NONE */
+	int16 MontageAttackId;
+
+	/** ReactType being played */
+	uint8 Reaction;
+
+	/** Hit flags (HitHead, HitTorso, ...), indexed by EBodyPart */
+	uint8 HitFlags;
+
+	/** EFlag bits */
+	uint32 Flags;
+
+	/** IsDamageBoxOverlapping bits */
+	uint16 DamageBoxOverlapMask;
+
+	/** Input applied in the previous frame, so button presses and releases can be detected */
+	FFighterInput LastInput;
+
+	/** Actions held in the input buffer (EFighterAction bits), and its presses that can still be performed */
+	uint16 HeldActions;
+	uint8 NumPendingPresses;
+	FSavedPress PendingPresses[MaxPendingPresses];
+
+	/** Combat frame the last attack was performed from the input buffer */
+	int32 LastBufferedAttackFrame;
+};
+
+static_assert(NumDamageBoxes <= 16, "FFighterState::DamageBoxOverlapMask has 16 bits");
+static_assert(NumBodyParts <= 8, "FFighterState::HitFlags has 8 bits");
+static_assert(TIsTriviallyCopyConstructible<FFighterState>::Value && TIsTriviallyDestructible<FFighterState>::Value, "FFighterState must be plain data");
+static_assert(sizeof(FFighterState) <= 256, "FFighterState must fit in 256 bytes");
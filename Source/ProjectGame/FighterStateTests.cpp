@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FightingTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FightingCharacter.h"
+#include "FighterState.h"
+#include "CombatClock.h"
+
+/** Inputs of the scripted frames. Attack 1 is pressed with the move modifier, then Attack 2 is buffered while they are held */
+static FFighterInput GetScriptedInput(int32 Step)
+{
+	FFighterInput input;
+	if (Step >= 1) input.Buttons |= FFighterInput::Attack1 | FFighterInput::MoveMod;
+	if (Step >= 3) input.Buttons |= FFighterInput::Attack2;
+	if (Step >= 12) input.Buttons &= ~FFighterInput::Attack1;
+	return input;
+}
+
+/** Applies the scripted inputs of the steps [FirstStep, LastStep) and steps the combat clock after each */
+static void RunScriptedSteps(AFightingCharacter* Fighter, UCombatClock* Clock, int32 FirstStep, int32 LastStep, FFighterInput& LastInput)
+{
+	for (int32 step = FirstStep; step < LastStep; step++) {
+		// The next combo attack can be added once the first attack has played for a while, as an animation notify would allow
+		if (step == 8) Fighter->CanAddNextComboAttack = true;
+
+		const FFighterInput input = GetScriptedInput(step);
+		Fighter->ApplyInput(input, LastInput);
+		LastInput = input;
+		Clock->Step();
+	}
+}
+
+/**
+ * Saves the state of a fighter while buttons are held and a press is buffered, steps it, loads the saved state and steps it again
+ * with the same inputs. Both runs must end in the same state, as rollback and replay seeking rely on it.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFighterStateRoundTripTest, "ProjectGame.Fighting.State.SaveStepLoadStep",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFighterStateRoundTripTest::RunTest(const FString& Parameters)
+{
+	FFightingTestWorld testWorld;
+	UCombatClock* clock = testWorld.GetCombatClock();
+	AFightingCharacter* fighter = testWorld.SpawnFighter(FVector::ZeroVector, 0.0f);
+	if (!TestNotNull(TEXT("Combat clock"), clock) || !TestNotNull(TEXT("Fighter"), fighter)) return false;
+
+	const int32 saveStep = 5;
+	const int32 endStep = 20;
+
+	FFighterInput lastInput;
+	RunScriptedSteps(fighter, clock, 0, saveStep, lastInput);
+
+	FFighterState saved;
+	fighter->SaveState(saved);
+	saved.LastInput = lastInput;
+	TestTrue(TEXT("Buttons are held when the state is saved"), saved.HeldActions != 0);
+	TestEqual(TEXT("Attack 2 is buffered when the state is saved"), (int32)saved.NumPendingPresses, 1);
+
+	RunScriptedSteps(fighter, clock, saveStep, endStep, lastInput);
+	FFighterState live;
+	fighter->SaveState(live);
+
+	fighter->LoadState(saved);
+	clock->SetFrame(saved.Frame);
+	lastInput = saved.LastInput;
+	RunScriptedSteps(fighter, clock, saveStep, endStep, lastInput);
+	FFighterState resimulated;
+	fighter->SaveState(resimulated);
+
+	TestEqual(TEXT("Combo state"), resimulated.ComboState, live.ComboState);
+	TestEqual(TEXT("Flags"), resimulated.Flags, live.Flags);
+	TestEqual(TEXT("Held actions"), (int32)resimulated.HeldActions, (int32)live.HeldActions);
+	TestEqual(TEXT("Last buffered attack frame"), resimulated.LastBufferedAttackFrame, live.LastBufferedAttackFrame);
+	TestTrue(TEXT("Resimulated state is identical to the live state"), FMemory::Memcmp(&resimulated, &live, sizeof(FFighterState)) == 0);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
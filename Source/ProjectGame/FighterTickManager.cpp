@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FighterTickManager.h"
+#include "FightingStats.h"
+#include "FightingCharacter.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+static TAutoConsoleVariable<int32> CVarTickManagerEnable(
+	TEXT("Fighting.TickManager.Enable"),
+	1,
+	TEXT("1: the movement and tracking work of FightingCharacters is batched by the fighter tick manager. 0: each fighter does it in its Tick().\n")
+	TEXT("Read when a FightingCharacter begins play."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTickManagerMinParallelFighters(
+	TEXT("Fighting.TickManager.MinParallelFighters"),
+	8,
+	TEXT("Minimum number of fighters for the compute phase of the fighter tick manager to run in parallel."),
+	ECVF_Default);
+
+bool UFighterTickManager::IsEnabled()
+{
+	return CVarTickManagerEnable.GetValueOnGameThread() != 0;
+}
+
+void FFighterTickManagerTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Manager != NULL) Manager->TickFighters(DeltaTime);
+}
+
+FString FFighterTickManagerTickFunction::DiagnosticMessage()
+{
+	return TEXT("FFighterTickManagerTickFunction");
+}
+
+void UFighterTickManager::Deinitialize()
+{
+	for (AFightingCharacter* Fighter : Fighters) {
+		Fighter->GetCharacterMovement()->PrimaryComponentTick.RemovePrerequisite(this, TickFunction);
+	}
+	Fighters.Empty();
+	if (TickFunction.IsTickFunctionRegistered()) TickFunction.UnRegisterTickFunction();
+	Super::Deinitialize();
+}
+
+void UFighterTickManager::RegisterFighter(AFightingCharacter* Fighter)
+{
+	if (Fighter == NULL || Fighters.Contains(Fighter)) return;
+
+	UWorld* World = GetWorld();
+	if (!TickFunction.IsTickFunctionRegistered() && World != NULL && World->PersistentLevel != NULL) {
+		TickFunction.Manager = this;
+		TickFunction.bCanEverTick = true;
+		TickFunction.TickGroup = TG_PrePhysics;
+		TickFunction.RegisterTickFunction(World->PersistentLevel);
+	}
+
+	// The movement of the fighter uses the rotation and the max walk speed written by the manager in the same frame
+	Fighter->GetCharacterMovement()->PrimaryComponentTick.AddPrerequisite(this, TickFunction);
+	Fighters.Add(Fighter);
+}
+
+void UFighterTickManager::UnregisterFighter(AFightingCharacter* Fighter)
+{
+	if (Fighters.RemoveSwap(Fighter) == 0) return;
+
+	Fighter->GetCharacterMovement()->PrimaryComponentTick.RemovePrerequisite(this, TickFunction);
+}
+
+void UFighterTickManager::Gather()
+{
+	const int32 Num = Fighters.Num();
+	Flags.SetNumUninitialized(Num, false);
+	Locations.SetNumUninitialized(Num, false);
+	Rotations.SetNumUninitialized(Num, false);
+	TargetLocations.SetNumUninitialized(Num, false);
+	Velocities.SetNumUninitialized(Num, false);
+	MaxWalkSpeeds.SetNumUninitialized(Num, false);
+	MaxRunSpeeds.SetNumUninitialized(Num, false);
+	MaxAccelerations.SetNumUninitialized(Num, false);
+	MovementMaxWalkSpeeds.SetNumUninitialized(Num, false);
+	LimbLocations.SetNumUninitialized(Num * NumLimbs, false);
+	NewRotations.SetNumUninitialized(Num, false);
+
+	for (int32 i = 0; i < Num; i++) {
+		AFightingCharacter* Fighter = Fighters[i];
+		UCharacterMovementComponent* Movement = Fighter->GetCharacterMovement();
+
+		uint8 FighterFlags = 0;
+		if (Fighter->TargetEnemy != NULL) {
+			FighterFlags |= HasTarget;
+			TargetLocations[i] = Fighter->TargetEnemy->GetActorLocation();
+		}
+		if (Fighter->bIsRunning) FighterFlags |= IsRunning;
+
+		Locations[i] = Fighter->GetActorLocation();
+		Rotations[i] = Fighter->GetActorRotation();
+		Velocities[i] = Fighter->GetVelocity();
+		MaxWalkSpeeds[i] = Fighter->MaxWalkSpeed;
+		MaxRunSpeeds[i] = Fighter->MaxRunSpeed;
+		MaxAccelerations[i] = Movement->MaxAcceleration;
+		MovementMaxWalkSpeeds[i] = Movement->MaxWalkSpeed;
+
+		FVector* Limbs = &LimbLocations[i * NumLimbs];
+		if (Fighter->bTrackFistsVelocity) {
+			FighterFlags |= TrackFists;
+			Limbs[(int32)ELimb::RightFist] = Fighter->GetLimbLocation(ELimb::RightFist);
+			Limbs[(int32)ELimb::LeftFist] = Fighter->GetLimbLocation(ELimb::LeftFist);
+		}
+		if (Fighter->bTrackFeetVelocity) {
+			FighterFlags |= TrackFeet;
+			Limbs[(int32)ELimb::RightFoot] = Fighter->GetLimbLocation(ELimb::RightFoot);
+			Limbs[(int32)ELimb::LeftFoot] = Fighter->GetLimbLocation(ELimb::LeftFoot);
+		}
+
+		Flags[i] = FighterFlags;
+	}
+}
+
+void UFighterTickManager::Compute(int32 Index, float DeltaTime, float CurrentTime)
+{
+	uint8& FighterFlags = Flags[Index];
+
+	// Same as AFightingCharacter::RotateToTarget()
+	if ((FighterFlags & HasTarget) && Velocities[Index].Size() != 0) {
+		FVector ToTarget = TargetLocations[Index] - Locations[Index];
+		ToTarget.Z = 0.0f;
+		FRotator LookAt = ToTarget.Rotation();
+		NewRotations[Index] = FMath::RInterpTo(Rotations[Index], LookAt, DeltaTime, 2.0f);
+		FighterFlags |= RotationChanged;
+	}
+
+	// Same as the max walk speed adjustment of AFightingCharacter::Tick()
+	if (FighterFlags & IsRunning) {
+		MovementMaxWalkSpeeds[Index] = MaxRunSpeeds[Index];
+	}
+	else if (Velocities[Index].Size() > MaxWalkSpeeds[Index]) {
+		MovementMaxWalkSpeeds[Index] -= MaxAccelerations[Index] * DeltaTime;
+	}
+	else MovementMaxWalkSpeeds[Index] = MaxWalkSpeeds[Index];
+
+	// The velocity samplers are plain data owned by a single fighter, so they can be updated here
+	AFightingCharacter* Fighter = Fighters[Index];
+	const FVector* Limbs = &LimbLocations[Index * NumLimbs];
+	if (FighterFlags & TrackFists) {
+		Fighter->LimbVelocity[(int32)ELimb::RightFist].AddPose(CurrentTime, Limbs[(int32)ELimb::RightFist]);
+		Fighter->LimbVelocity[(int32)ELimb::LeftFist].AddPose(CurrentTime, Limbs[(int32)ELimb::LeftFist]);
+	}
+	if (FighterFlags & TrackFeet) {
+		Fighter->LimbVelocity[(int32)ELimb::RightFoot].AddPose(CurrentTime, Limbs[(int32)ELimb::RightFoot]);
+		Fighter->LimbVelocity[(int32)ELimb::LeftFoot].AddPose(CurrentTime, Limbs[(int32)ELimb::LeftFoot]);
+	}
+}
+
+void UFighterTickManager::WriteBack()
+{
+	for (int32 i = 0; i < Fighters.Num(); i++) {
+		AFightingCharacter* Fighter = Fighters[i];
+		UCharacterMovementComponent* Movement = Fighter->GetCharacterMovement();
+
+		if (Flags[i] & RotationChanged) Fighter->SetActorRotation(NewRotations[i]);
+
+		// If it's running character orients rotation to movement, but if it's only walking it does not
+		Movement->bOrientRotationToMovement = (Flags[i] & IsRunning) != 0;
+		Movement->MaxWalkSpeed = MovementMaxWalkSpeeds[i];
+	}
+}
+
+void UFighterTickManager::TickFighters(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (World == NULL || Fighters.Num() == 0) return;
+
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("Fighter Tick Manager"), STAT_FighterTickManager, STATGROUP_Fighting);
+
+	const float CurrentTime = World->GetTimeSeconds();
+
+	Gather();
+
+	const bool bSingleThread = Fighters.Num() < CVarTickManagerMinParallelFighters.GetValueOnGameThread();
+	ParallelFor(Fighters.Num(), [this, DeltaTime, CurrentTime](int32 Index) {
+		Compute(Index, DeltaTime, CurrentTime);
+	}, bSingleThread);
+
+	WriteBack();
+}
+
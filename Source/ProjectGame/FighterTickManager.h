@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineBaseTypes.h"
+#include "LimbVelocitySampler.h"
+#include "FighterTickManager.generated.h"
+
+class AFightingCharacter;
+class UFighterTickManager;
+
+/** Tick function of the fighter tick manager, registered in the persistent level of its world */
+struct FFighterTickManagerTickFunction : public FTickFunction
+{
+	UFighterTickManager* Manager = NULL;
+
+	//~ Begin FTickFunction Interface
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	//~ End FTickFunction Interface
+};
+
+/**
+ * Runs the per-frame movement and tracking work of all the FightingCharacters of a world in one pass:
+ * rotation to the target enemy, max walk speed blending and limb velocity tracking.
+ * Each frame has three phases:
+ *  - Gather (game thread): copies the hot state of every fighter into structure-of-arrays buffers.
+ *  - Compute (ParallelFor): pure math on the buffers and on the fighters' velocity samplers, without calling any UObject function.
+ *  - Write back (game thread): applies the new rotations and speeds to the actors and their movement components.
+ * Fighters register in BeginPlay() and skip that work in their own Tick() while registered.
+ * The manager ticks in TG_PrePhysics and is a prerequisite of the movement component of every registered fighter,
+ * so the rotations and max walk speeds it writes are used by the movement of the same frame. Being a level tick function,
+ * it does not tick while its world is paused, and is given the dilated world delta time.
+ * Enabled with the console variable Fighting.TickManager.Enable (read when a fighter begins play).
+ */
+UCLASS()
+class PROJECTGAME_API UFighterTickManager : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns true if fighters should be ticked by the manager */
+	static bool IsEnabled();
+
+	/** Registers a fighter. Called in AFightingCharacter::BeginPlay() */
+	void RegisterFighter(AFightingCharacter* Fighter);
+
+	/** Unregisters a fighter. Called in AFightingCharacter::EndPlay() */
+	void UnregisterFighter(AFightingCharacter* Fighter);
+
+	//~ Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	/** Runs the three phases for all the registered fighters. Called by the tick function */
+	void TickFighters(float DeltaTime);
+
+protected:
+	/** Bits of Flags */
+	enum EFighterFlags : uint8
+	{
+		HasTarget = 1 << 0,
+		IsRunning = 1 << 1,
+		TrackFists = 1 << 2,
+		TrackFeet = 1 << 3,
+		RotationChanged = 1 << 4
+	};
+
+	/** Copies the state of every fighter into the buffers */
+	void Gather();
+
+	/** Computes the new state of one fighter. Must not call UObject functions, as it runs in parallel */
+	void Compute(int32 Index, float DeltaTime, float CurrentTime);
+
+	/** Applies the new state to the fighters */
+	void WriteBack();
+
+	/** Registered in the persistent level when the first fighter registers */
+	FFighterTickManagerTickFunction TickFunction;
+
+	/** Registered fighters. Index i of every buffer belongs to Fighters[i] */
+	TArray<AFightingCharacter*> Fighters;
+
+	//~ Begin Buffers (inputs)
+	TArray<uint8> Flags;
+	TArray<FVector> Locations;
+	TArray<FRotator> Rotations;
+	TArray<FVector> TargetLocations;
+	TArray<FVector> Velocities;
+	TArray<float> MaxWalkSpeeds;
+	TArray<float> MaxRunSpeeds;
+	TArray<float> MaxAccelerations;
+
+	/** Current max walk speed of each fighter's movement component. Updated by Compute() */
+	TArray<float> MovementMaxWalkSpeeds;
+
+	/** Locations of the tracked limbs, NumLimbs per fighter indexed by ELimb */
+	TArray<FVector> LimbLocations;
+	//~ End Buffers (inputs)
+
+	//~ Begin Buffers (outputs)
+	TArray<FRotator> NewRotations;
+	//~ End Buffers (outputs)
+};
@@ -0,0 +1,512 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/**
+ * Development console commands that measure the cost of the combat code in a running game, and the automation spec
+ * ProjectGame.Fighting.CombatRules that measures the combat rules in a test world.
+ * They are not compiled in shipping builds.
+ */
+
+#include "CoreMinimal.h"
+#include "FightingCharacter.h"
+#include "BoxContact.h"
+#include "EngineUtils.h"
+#include "CombatClock.h"
+#include "FightingTestWorld.h"
+#include "FighterState.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/MemoryBase.h"
+#include "Misc/AutomationTest.h"
+#include "Components/BoxComponent.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#include "Engine.h"
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Impact point as AFightingCharacter::OnAttackOverlapBegin used to find it:
+ * a sphere sweep between both components, searching the results for the damage box.
+ */
+static bool SweepImpactPoint(UWorld* World, UPrimitiveComponent* WeaponBox, UPrimitiveComponent* DamageBox, FVector& OutImpactPoint)
+{
+	TArray<FHitResult> AllResults;
+
+	auto Start = WeaponBox->GetComponentLocation();
+	auto End = DamageBox->GetComponentLocation();
+	auto CollisionRadius = FVector::Dist(Start, End) * 1.1f;
+
+	World->SweepMultiByObjectType(AllResults, Start, End, FQuat::Identity, 0, FCollisionShape::MakeSphere(CollisionRadius),
+		FCollisionQueryParams(false));
+
+	for (auto HitResult : AllResults) {
+		if (HitResult.GetComponent() != NULL && DamageBox->GetUniqueID() == HitResult.GetComponent()->GetUniqueID()) {
+			OutImpactPoint = HitResult.ImpactPoint;
+			return true;
+		}
+	}
+	return false;
+}
+
+/** Returns true if the point is inside the box, with a small tolerance */
+static bool IsInsideBox(const FOrientedBox& Box, const FVector& Point)
+{
+	return FVector::DistSquared(Box.GetClosestPoint(Point), Point) < 0.01f;
+}
+
+/**
+ * Fighting.BenchBoxContact [Iterations]
+ * Places a probe box, the size of a fist collision box, at random overlapping poses around the damage boxes
+ * of a FightingCharacter, and finds the impact point with both the scene sweep and ComputeBoxContact().
+ * Logs the cost of each method and how often the impact point lies inside both boxes.
+ */
+static void BenchBoxContact(const TArray<FString>& Args, UWorld* World)
+{
+	int32 Iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+
+	AFightingCharacter* Victim = NULL;
+	for (TActorIterator<AFightingCharacter> It(World); It; ++It) {
+		Victim = *It;
+		break;
+	}
+	if (Victim == NULL || Victim->GetDamageCollisionBoxes().empty()) {
+		UE_LOG(LogTemp, Warning, TEXT("Fighting.BenchBoxContact: no FightingCharacter in the world"));
+		return;
+	}
+
+	// The scene sweep needs the physics bodies of the damage boxes, which are unregistered when the fighter uses its Hitboxes
+	if (Victim->UsesHitboxes()) {
+		UE_LOG(LogTemp, Warning, TEXT("Fighting.BenchBoxContact: the damage boxes have no physics body, set Fighting.Hitbox.UseComponent 0 for the scene sweep"));
+	}
+
+	AActor* ProbeActor = World->SpawnActor<AActor>();
+	UBoxComponent* Probe = NewObject<UBoxComponent>(ProbeActor);
+	Probe->SetBoxExtent(Victim->RightFistCollisionBox->GetUnscaledBoxExtent());
+	Probe->SetCollisionProfileName("Weapon");
+	ProbeActor->SetRootComponent(Probe);
+	Probe->RegisterComponent();
+
+	const std::vector<UBoxComponent*>& DamageBoxes = Victim->GetDamageCollisionBoxes();
+	FRandomStream Random(1234);
+
+	uint64 SweepCycles = 0, SolverCycles = 0;
+	int32 Samples = 0, SweepFound = 0, SweepInside = 0, SolverInside = 0;
+	float SumDistance = 0.0f, MaxDistance = 0.0f;
+
+	for (int32 i = 0; i < Iterations; i++) {
+		int32 DamageIndex = Random.RandHelper(DamageBoxes.size());
+		UBoxComponent* DamageBox = DamageBoxes[DamageIndex];
+		FOrientedBox Damage = Victim->GetDamageOrientedBox(DamageIndex);
+
+		FVector Offset(Random.FRandRange(-1, 1), Random.FRandRange(-1, 1), Random.FRandRange(-1, 1));
+		FVector Location = Damage.Center + Damage.Axes[0] * Offset.X * Damage.Extent.X
+			+ Damage.Axes[1] * Offset.Y * Damage.Extent.Y + Damage.Axes[2] * Offset.Z * Damage.Extent.Z;
+		Probe->SetWorldLocationAndRotation(Location, FRotator(Random.FRandRange(-180, 180), Random.FRandRange(-180, 180), Random.FRandRange(-180, 180)));
+
+		FOrientedBox Weapon = FOrientedBox::FromBoxComponent(Probe);
+
+		uint64 Start = FPlatformTime::Cycles64();
+		FVector SweepPoint;
+		bool bSweepFound = SweepImpactPoint(World, Probe, DamageBox, SweepPoint);
+		uint64 Middle = FPlatformTime::Cycles64();
+		FBoxContact Contact;
+		bool bOverlapping = ComputeBoxContact(FOrientedBox::FromBoxComponent(Probe), Damage, Contact);
+		uint64 End = FPlatformTime::Cycles64();
+
+		SweepCycles += Middle - Start;
+		SolverCycles += End - Middle;
+		if (!bOverlapping) continue;
+
+		Samples++;
+		if (IsInsideBox(Weapon, Contact.ImpactPoint) && IsInsideBox(Damage, Contact.ImpactPoint)) SolverInside++;
+		if (bSweepFound) {
+			SweepFound++;
+			if (IsInsideBox(Weapon, SweepPoint) && IsInsideBox(Damage, SweepPoint)) SweepInside++;
+			float Distance = FVector::Dist(SweepPoint, Contact.ImpactPoint);
+			SumDistance += Distance;
+			MaxDistance = FMath::Max(MaxDistance, Distance);
+		}
+	}
+
+	ProbeActor->Destroy();
+
+	double NsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1.e9;
+	UE_LOG(LogTemp, Display, TEXT("Fighting.BenchBoxContact: %d iterations, %d overlapping samples"), Iterations, Samples);
+	UE_LOG(LogTemp, Display, TEXT("  sweep:  %.1f ns/op, impact point found %d/%d, inside both boxes %d/%d"),
+		SweepCycles * NsPerCycle / Iterations, SweepFound, Samples, SweepInside, Samples);
+	UE_LOG(LogTemp, Display, TEXT("  solver: %.1f ns/op, inside both boxes %d/%d"),
+		SolverCycles * NsPerCycle / Iterations, SolverInside, Samples);
+	UE_LOG(LogTemp, Display, TEXT("  distance between impact points: mean %.2f, max %.2f"),
+		SweepFound > 0 ? SumDistance / SweepFound : 0.0f, MaxDistance);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchBoxContactCommand(
+	TEXT("Fighting.BenchBoxContact"),
+	TEXT("Compares the cost and accuracy of the sweep and of the box contact solver to find impact points. Usage: Fighting.BenchBoxContact [Iterations]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchBoxContact));
+
+/** Allocations made by the current thread since the counting allocator was installed */
+static thread_local uint64 GThreadAllocations = 0;
+
+/**
+ * Allocator that counts the allocations of each thread in GThreadAllocations and forwards everything to the allocator it wraps.
+ * Only used if the process was started with -CountAllocations, as every later allocation of the process goes through it:
+ * installed as GMalloc the first time a benchmark counts allocations, and never removed or freed, as other threads may be
+ * calling it, or freeing memory through it, at any time.
+ */
+class FCountingMalloc final : public FMalloc
+{
+public:
+	/** Installs the allocator if the process was started with -CountAllocations. Returns true if allocations are counted */
+	static bool Install()
+	{
+		static const bool bEnabled = FParse::Param(FCommandLine::Get(), TEXT("CountAllocations"));
+		if (!bEnabled) return false;
+
+		static FCountingMalloc* Instance = NULL;
+		if (Instance != NULL) return true;
+
+		Instance = new FCountingMalloc(GMalloc);
+		FPlatformMisc::MemoryBarrier();
+		GMalloc = Instance;
+		return true;
+	}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		GThreadAllocations++;
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if (Count > 0) GThreadAllocations++;
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override { Inner->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+	virtual void UpdateStats() override { Inner->UpdateStats(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+private:
+	explicit FCountingMalloc(FMalloc* InInner) : Inner(InInner) {}
+
+	FMalloc* Inner;
+};
+
+/** Result of one combat rule benchmark */
+struct FCombatRuleResult
+{
+	FString Name;
+	int32 Iterations;
+	double NsPerOp;
+	double P50Ns;
+	double P99Ns;
+
+	/** Allocations per call, or -1 if allocations are not counted (without -CountAllocations) */
+	double AllocsPerCall;
+};
+
+/**
+ * Calls a function Iterations times, timing each call, and counts the allocations made by the calls on the calling thread.
+ * Prepare is called before each call, outside of the measurement.
+ */
+template <typename PrepareType, typename CallType>
+static FCombatRuleResult RunCombatRule(const TCHAR* Name, int32 Iterations, PrepareType Prepare, CallType Call)
+{
+	TArray<uint32> Cycles;
+	Cycles.SetNumUninitialized(Iterations);
+
+	const bool bCountAllocations = FCountingMalloc::Install();
+
+	uint64 Allocations = 0;
+	for (int32 i = 0; i < Iterations; i++) {
+		Prepare(i);
+
+		uint64 AllocationsBefore = GThreadAllocations;
+		uint64 Start = FPlatformTime::Cycles64();
+		Call(i);
+		uint64 End = FPlatformTime::Cycles64();
+		Allocations += GThreadAllocations - AllocationsBefore;
+
+		Cycles[i] = (uint32)(End - Start);
+	}
+
+	uint64 TotalCycles = 0;
+	for (uint32 Cycle : Cycles) TotalCycles += Cycle;
+	Cycles.Sort();
+
+	const double NsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1.e9;
+
+	FCombatRuleResult Result;
+	Result.Name = Name;
+	Result.Iterations = Iterations;
+	Result.NsPerOp = TotalCycles * NsPerCycle / Iterations;
+	Result.P50Ns = Cycles[(Iterations - 1) / 2] * NsPerCycle;
+	Result.P99Ns = Cycles[FMath::Min(FMath::CeilToInt(Iterations * 0.99) - 1, Iterations - 1)] * NsPerCycle;
+	Result.AllocsPerCall = bCountAllocations ? (double)Allocations / Iterations : -1.0;
+	return Result;
+}
+
+/** Reads the ns/op of each rule from a CSV written by Fighting.BenchCombatRules */
+static TMap<FString, double> LoadCombatRulesBaseline(const FString& Path)
+{
+	TMap<FString, double> Baseline;
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *Path)) return Baseline;
+
+	for (int32 i = 1; i < Lines.Num(); i++) {
+		TArray<FString> Columns;
+		Lines[i].ParseIntoArray(Columns, TEXT(","));
+		if (Columns.Num() >= 3) Baseline.Add(Columns[0], FCString::Atod(*Columns[2]));
+	}
+	return Baseline;
+}
+
+/**
+ * Spawns two fighters of a class facing each other, away from the fight, and calls the combat hot paths on them with synthetic hits:
+ * InflictDamage, ReactionStart, GetWeaponVelocity, GetSpeedForAnimation, GetTargetSocketLocation and OnAttackOverlapBegin.
+ * The fighters are destroyed afterwards.
+ *
+ * @param World			world to spawn the fighters in. Must have a combat clock
+ * @param FighterClass	class of the fighters
+ * @param Iterations	number of calls of each function
+ * @param OutResults	receives the result of each function
+ * @return false if the fighters could not be spawned
+ */
+static bool MeasureCombatRules(UWorld* World, UClass* FighterClass, int32 Iterations, TArray<FCombatRuleResult>& OutResults)
+{
+	UCombatClock* CombatClock = UCombatClock::Get(World);
+	if (CombatClock == NULL) return false;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	const FVector Origin(0.0f, 0.0f, -100000.0f);
+	AFightingCharacter* Attacker = World->SpawnActor<AFightingCharacter>(FighterClass, Origin, FRotator(0.0f, 0.0f, 0.0f), SpawnParameters);
+	AFightingCharacter* Victim = World->SpawnActor<AFightingCharacter>(FighterClass, Origin + FVector(150.0f, 0.0f, 0.0f), FRotator(0.0f, 180.0f, 0.0f), SpawnParameters);
+	if (Attacker == NULL || Victim == NULL || Victim->GetDamageCollisionBoxes().empty()) {
+		if (Attacker != NULL) Attacker->Destroy();
+		if (Victim != NULL) Victim->Destroy();
+		return false;
+	}
+
+	// Gravity and AI would move the fighters between calls
+	Attacker->GetCharacterMovement()->DisableMovement();
+	Victim->GetCharacterMovement()->DisableMovement();
+	Attacker->DetachFromControllerPendingDestroy();
+	Victim->DetachFromControllerPendingDestroy();
+	Attacker->SetTargetEnemy(Victim);
+	Victim->SetTargetEnemy(Attacker);
+
+	FFighterState VictimStart;
+	Victim->SaveState(VictimStart);
+	const int32 StartFrame = CombatClock->GetFrame();
+
+	const std::vector<UBoxComponent*>& DamageBoxes = Victim->GetDamageCollisionBoxes();
+	const std::vector<UBoxComponent*>& WeaponBoxes = Attacker->GetWeaponCollisionBoxes();
+	TArray<FName> SocketNames = Victim->GetMesh()->GetAllSocketNames();
+	if (SocketNames.Num() == 0) SocketNames.Add("head");
+
+	// Synthetic hits, generated up front so the random stream is not measured
+	FRandomStream Random(1234);
+	TArray<int32> HitBoxes;
+	TArray<float> HitVelocities;
+	HitBoxes.SetNumUninitialized(Iterations);
+	HitVelocities.SetNumUninitialized(Iterations);
+	for (int32 i = 0; i < Iterations; i++) {
+		HitBoxes[i] = Random.RandHelper(DamageBoxes.size());
+		HitVelocities[i] = Random.FRandRange(100.0f, 1500.0f);
+	}
+
+	// Moves the clock past the damage cooldown and the block window before each hit, and heals the victim before it is defeated
+	int32 Frame = StartFrame;
+	auto PrepareHit = [&](int32 i) {
+		Frame += UCombatClock::TickRate;
+		CombatClock->SetFrame(Frame);
+		if (Victim->GetHealthPoints() < 0.5f) Victim->LoadState(VictimStart);
+	};
+	auto PrepareNothing = [](int32 i) {};
+
+	OutResults.Add(RunCombatRule(TEXT("InflictDamage"), Iterations, PrepareHit, [&](int32 i) {
+		Victim->InflictDamage(DamageBoxes[HitBoxes[i]], HitVelocities[i], Attacker);
+	}));
+
+	OutResults.Add(RunCombatRule(TEXT("ReactionStart"), Iterations, PrepareHit, [&](int32 i) {
+		UBoxComponent* DamageBox = DamageBoxes[HitBoxes[i]];
+		Victim->ReactionStart(Attacker, DamageBox, HitVelocities[i], DamageBox->GetComponentLocation(), 0);
+	}));
+
+	OutResults.Add(RunCombatRule(TEXT("GetWeaponVelocity"), Iterations, PrepareNothing, [&](int32 i) {
+		Attacker->GetWeaponVelocity(WeaponBoxes[i % WeaponBoxes.size()]);
+	}));
+
+	OutResults.Add(RunCombatRule(TEXT("GetSpeedForAnimation"), Iterations, PrepareNothing, [&](int32 i) {
+		Attacker->GetSpeedForAnimation(UCombatClock::GetStepTime());
+	}));
+
+	OutResults.Add(RunCombatRule(TEXT("GetTargetSocketLocation"), Iterations, PrepareNothing, [&](int32 i) {
+		Attacker->GetTargetSocketLocation(SocketNames[i % SocketNames.Num()]);
+	}));
+
+	FHitResult NoSweep;
+	OutResults.Add(RunCombatRule(TEXT("OnAttackOverlapBegin"), Iterations, PrepareHit, [&](int32 i) {
+		Attacker->OnAttackOverlapBegin(WeaponBoxes[i % WeaponBoxes.size()], Victim, DamageBoxes[HitBoxes[i]], 0, false, NoSweep);
+	}));
+
+	CombatClock->SetFrame(StartFrame);
+	Attacker->Destroy();
+	Victim->Destroy();
+	return true;
+}
+
+/**
+ * Logs the results, compared with the ns/op of a baseline CSV if one is given, and writes them to
+ * Saved/Benchmarks/CombatRules-<time>.csv
+ *
+ * @return path of the CSV file
+ */
+static FString WriteCombatRulesResults(const TArray<FCombatRuleResult>& Results, const FString& BaselinePath)
+{
+	TMap<FString, double> Baseline;
+	if (!BaselinePath.IsEmpty()) Baseline = LoadCombatRulesBaseline(BaselinePath);
+
+	FString Csv = TEXT("Name,Iterations,NsPerOp,P50Ns,P99Ns,AllocsPerCall") LINE_TERMINATOR;
+	for (const FCombatRuleResult& Result : Results) {
+		Csv += FString::Printf(TEXT("%s,%d,%.2f,%.2f,%.2f,%.4f") LINE_TERMINATOR,
+			*Result.Name, Result.Iterations, Result.NsPerOp, Result.P50Ns, Result.P99Ns, Result.AllocsPerCall);
+
+		FString Comparison;
+		if (const double* BaselineNsPerOp = Baseline.Find(Result.Name)) {
+			Comparison = FString::Printf(TEXT(" (baseline %.1f ns/op, %+.1f%%)"), *BaselineNsPerOp,
+				*BaselineNsPerOp > 0.0 ? (Result.NsPerOp / *BaselineNsPerOp - 1.0) * 100.0 : 0.0);
+		}
+		UE_LOG(LogTemp, Display, TEXT("  %-24s %10.1f ns/op  p50 %10.1f ns  p99 %10.1f ns  %.3f allocs/call%s"),
+			*Result.Name, Result.NsPerOp, Result.P50Ns, Result.P99Ns, Result.AllocsPerCall, *Comparison);
+	}
+
+	const FString Path = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("CombatRules-%s.csv"), *FDateTime::Now().ToString());
+	FFileHelper::SaveStringToFile(Csv, *Path);
+	return Path;
+}
+
+/**
+ * Fighting.BenchCombatRules [Iterations] [BaselineCsv]
+ * Measures the combat hot paths with MeasureCombatRules() on fighters of the same class as the ones in the world.
+ * Writes ns/op, p50 and p99 latency and allocations per call to Saved/Benchmarks/CombatRules-<time>.csv, and compares
+ * them with a baseline CSV written by a previous run, if given.
+ * Allocations are only counted if the process was started with -CountAllocations, and are -1 otherwise.
+ */
+static void BenchCombatRules(const TArray<FString>& Args, UWorld* World)
+{
+	int32 Iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 100) : 1000000;
+
+	// Fighters of the same class as the ones in the world, so they have the same meshes and collision boxes
+	UClass* FighterClass = AFightingCharacter::StaticClass();
+	for (TActorIterator<AFightingCharacter> It(World); It; ++It) {
+		FighterClass = It->GetClass();
+		break;
+	}
+
+	TArray<FCombatRuleResult> Results;
+	if (!MeasureCombatRules(World, FighterClass, Iterations, Results)) {
+		UE_LOG(LogTemp, Warning, TEXT("Fighting.BenchCombatRules: could not spawn the fighters"));
+		return;
+	}
+
+	const FString Path = WriteCombatRulesResults(Results, Args.Num() > 1 ? Args[1] : FString());
+	UE_LOG(LogTemp, Display, TEXT("Fighting.BenchCombatRules: %d iterations per rule, results written to %s"), Iterations, *Path);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchCombatRulesCommand(
+	TEXT("Fighting.BenchCombatRules"),
+	TEXT("Measures ns/op, p50/p99 latency and allocations per call of the combat hot paths, and writes them to a CSV file. Usage: Fighting.BenchCombatRules [Iterations] [BaselineCsv]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchCombatRules));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * ProjectGame.Fighting.CombatRules
+ * Automation spec of the combat hot paths: spawns two fighters in a test world and measures each rule with MeasureCombatRules().
+ * Settings are read from the command line:
+ *  -CombatRulesIterations=N		calls of each rule (default 1000000)
+ *  -CombatRulesFighterClass=Path	fighter class, e.g. a Blueprint with the game meshes (default AFightingCharacter)
+ *  -CombatRulesBaseline=Csv		CSV of a previous run. A rule fails if it allocates more per call than in it,
+ *									or if it is slower by more than the tolerance
+ *  -CombatRulesTolerance=Percent	tolerance of the comparison with the baseline (default 10)
+ * Allocations are only counted, and compared with the baseline, if the process is started with -CountAllocations.
+ */
+BEGIN_DEFINE_SPEC(FCombatRulesSpec, "ProjectGame.Fighting.CombatRules", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+END_DEFINE_SPEC(FCombatRulesSpec)
+
+void FCombatRulesSpec::Define()
+{
+	It("measures every combat rule against the baseline", [this]() {
+		const TCHAR* CommandLine = FCommandLine::Get();
+		int32 Iterations = 1000000;
+		FString FighterClassPath, BaselinePath;
+		float Tolerance = 10.0f;
+		FParse::Value(CommandLine, TEXT("CombatRulesIterations="), Iterations);
+		FParse::Value(CommandLine, TEXT("CombatRulesFighterClass="), FighterClassPath);
+		FParse::Value(CommandLine, TEXT("CombatRulesBaseline="), BaselinePath);
+		FParse::Value(CommandLine, TEXT("CombatRulesTolerance="), Tolerance);
+
+		UClass* FighterClass = AFightingCharacter::StaticClass();
+		if (!FighterClassPath.IsEmpty()) {
+			FighterClass = LoadClass<AFightingCharacter>(NULL, *FighterClassPath);
+			if (!TestNotNull(TEXT("Fighter class"), FighterClass)) return;
+		}
+
+		TArray<FCombatRuleResult> Results;
+		{
+			FFightingTestWorld TestWorld;
+			if (!TestTrue(TEXT("Fighters spawned"), MeasureCombatRules(TestWorld.GetWorld(), FighterClass, FMath::Max(Iterations, 100), Results))) return;
+		}
+
+		const FString Path = WriteCombatRulesResults(Results, BaselinePath);
+		AddInfo(FString::Printf(TEXT("Results written to %s"), *Path));
+
+		TMap<FString, double> BaselineNsPerOp, BaselineAllocs;
+		TArray<FString> Lines;
+		if (!BaselinePath.IsEmpty() && TestTrue(TEXT("Baseline loaded"), FFileHelper::LoadFileToStringArray(Lines, *BaselinePath))) {
+			for (int32 i = 1; i < Lines.Num(); i++) {
+				TArray<FString> Columns;
+				Lines[i].ParseIntoArray(Columns, TEXT(","));
+				if (Columns.Num() < 6) continue;
+				BaselineNsPerOp.Add(Columns[0], FCString::Atod(*Columns[2]));
+				BaselineAllocs.Add(Columns[0], FCString::Atod(*Columns[5]));
+			}
+		}
+
+		TestEqual(TEXT("Rules measured"), Results.Num(), 6);
+		for (const FCombatRuleResult& Result : Results) {
+			AddInfo(FString::Printf(TEXT("%s: %.1f ns/op, p99 %.1f ns, %.3f allocs/call"), *Result.Name, Result.NsPerOp, Result.P99Ns, Result.AllocsPerCall));
+			TestTrue(FString::Printf(TEXT("%s ns/op measured"), *Result.Name), Result.NsPerOp > 0.0);
+			TestTrue(FString::Printf(TEXT("%s p99 latency not below the median"), *Result.Name), Result.P99Ns >= Result.P50Ns);
+			if (const double* NsPerOp = BaselineNsPerOp.Find(Result.Name)) {
+				TestTrue(FString::Printf(TEXT("%s ns/op within %.0f%% of the baseline (%.1f)"), *Result.Name, Tolerance, *NsPerOp),
+					Result.NsPerOp <= *NsPerOp * (1.0 + Tolerance / 100.0));
+			}
+
+			// Allocations are only compared if both runs counted them
+			const double* Allocs = BaselineAllocs.Find(Result.Name);
+			if (Allocs != NULL && *Allocs >= 0.0 && Result.AllocsPerCall >= 0.0) {
+				TestTrue(FString::Printf(TEXT("%s allocations per call not above the baseline (%.3f)"), *Result.Name, *Allocs),
+					Result.AllocsPerCall <= *Allocs + 0.0001);
+			}
+		}
+	});
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
+
+#endif // !UE_BUILD_SHIPPING
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FightingCameraManager.h"
+#include "FightingCharacter.h"
+#include "FightingStats.h"
+#include "MyGameMode.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/KismetMathLibrary.h"
+#include "Engine/World.h"
+
+bool AFightingCameraManager::GatherFramedLocations(AFightingCharacter* ViewFighter)
+{
+	FramedLocations.Reset();
+	const FVector ViewLocation = ViewFighter->GetActorLocation();
+	FramedLocations.Add(ViewLocation);
+
+	AFightingCharacter* Target = ViewFighter->GetTargetEnemy();
+	if (Target != NULL && !Target->IsPendingKill()) FramedLocations.Add(Target->GetActorLocation());
+
+	// In the arena, the fighters standing around the viewed fighter are framed as well
+	AMyGameMode* GameMode = Cast<AMyGameMode>(GetWorld()->GetAuthGameMode());
+	if (GameMode != NULL && GameMode->bArenaMode) {
+		const float RadiusSquared = ArenaFramingRadius * ArenaFramingRadius;
+		for (AFightingCharacter* Fighter : GameMode->Fighters) {
+			if (Fighter == NULL || Fighter == ViewFighter || Fighter == Target || Fighter->IsPendingKill() || Fighter->GetHealthPoints() <= 0.0f) continue;
+
+			const FVector Location = Fighter->GetActorLocation();
+			if (FVector::DistSquared2D(Location, ViewLocation) <= RadiusSquared) FramedLocations.Add(Location);
+		}
+	}
+
+	return FramedLocations.Num() > 1;
+}
+
+void AFightingCameraManager::UpdateViewTarget(FTViewTarget& OutVT, float DeltaTime)
+{
+	Super::UpdateViewTarget(OutVT, DeltaTime);
+
+	AFightingCharacter* ViewFighter = Cast<AFightingCharacter>(OutVT.Target);
+	if (ViewFighter == NULL || !ViewFighter->IsFightCameraActive() || !GatherFramedLocations(ViewFighter)) {
+		bHasFraming = false;
+		return;
+	}
+
+	FIGHTING_SCOPE_CYCLE_COUNTER(FighterCamera);
+
+	// Bounding circle of the framed fighters on the ground
+	FBox Bounds(ForceInit);
+	for (const FVector& Location : FramedLocations) Bounds += Location;
+	FVector Center = Bounds.GetCenter();
+	float RadiusSquared = 0.0f;
+	for (const FVector& Location : FramedLocations) RadiusSquared = FMath::Max(RadiusSquared, FVector::DistSquared2D(Location, Center));
+	const float Radius = FMath::Sqrt(RadiusSquared);
+
+	// The camera stays on the side of the line between the viewed fighter and its target
+	AFightingCharacter* Target = ViewFighter->GetTargetEnemy();
+	FVector Axis = (Target != NULL ? Target->GetActorLocation() - ViewFighter->GetActorLocation() : ViewFighter->GetActorForwardVector()).GetSafeNormal2D();
+	if (Axis.IsNearlyZero()) Axis = ViewFighter->GetActorForwardVector().GetSafeNormal2D();
+
+	// The camera moves by about FramingDistance times the change of the axis when it turns
+	const float ThresholdSquared = MotionThreshold * MotionThreshold;
+	const bool bMoved = !bHasFraming
+		|| FVector::DistSquared(Center, FramedCenter) > ThresholdSquared
+		|| FMath::Square(Radius - FramedRadius) > ThresholdSquared
+		|| FVector::DistSquared(Axis, FramedAxis) * FramingDistance * FramingDistance > ThresholdSquared;
+
+	if (bMoved) {
+		FramedCenter = Center;
+		FramedRadius = Radius;
+		FramedAxis = Axis;
+		bHasFraming = true;
+
+		// If the fighters are spread out, the camera moves away so all of them can be seen
+		const float Spread = 2.0f * Radius;
+		const float DistanceOffset = Spread > FramingSpread ? (Spread - FramingSpread) * 0.5f : 0.0f;
+
+		FVector LookAt = Center;
+		FramingLocation = LookAt + Axis.RotateAngleAxis(90.0f, FVector::UpVector) * (FramingDistance + DistanceOffset);
+		LookAt.Z = FramingHeight;
+		FramingLocation.Z = FramingHeight;
+		FramingRotation = UKismetMathLibrary::FindLookAtRotation(FramingLocation, LookAt);
+
+		// Movement input is relative to the control rotation
+		if (PCOwner != NULL) PCOwner->SetControlRotation(FramingRotation);
+	}
+
+	OutVT.POV.Location = FramingLocation;
+	OutVT.POV.Rotation = FramingRotation;
+}
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Camera/PlayerCameraManager.h"
+#include "FightingCameraManager.generated.h"
+
+class AFightingCharacter;
+
+/**
+ * Camera manager that frames the fight when the view target is a fighter with its fight camera (Camera2) active.
+ * The camera looks at the center of the fighters being framed from the side of the line between the viewed fighter and
+ * its target, and moves away as the fighters spread out. The player's control rotation follows the camera, so movement
+ * input stays relative to the view.
+ * The framing is computed once per frame after all actors ticked, and is only recomputed and applied when the framed
+ * fighters moved more than MotionThreshold.
+ */
+UCLASS()
+class PROJECTGAME_API AFightingCameraManager : public APlayerCameraManager
+{
+	GENERATED_BODY()
+
+public:
+	/** Distance between the camera and the center of the fight when the fighters are close */
+	UPROPERTY(EditAnywhere, Category = Framing, meta = (ClampMin = "0.0"))
+	float FramingDistance = 300.0f;
+
+	/** Height of the camera and of the point it looks at */
+	UPROPERTY(EditAnywhere, Category = Framing)
+	float FramingHeight = 250.0f;
+
+	/** Spread of the fighters above which the camera moves away from the fight, by half the extra spread */
+	UPROPERTY(EditAnywhere, Category = Framing, meta = (ClampMin = "0.0"))
+	float FramingSpread = 500.0f;
+
+	/** In arena mode, only the fighters still standing within this distance of the viewed fighter are framed */
+	UPROPERTY(EditAnywhere, Category = Framing, meta = (ClampMin = "0.0"))
+	float ArenaFramingRadius = 1500.0f;
+
+	/** Distance the camera must move for the framing to be updated */
+	UPROPERTY(EditAnywhere, Category = Framing, meta = (ClampMin = "0.0"))
+	float MotionThreshold = 1.0f;
+
+protected:
+	//~ Begin APlayerCameraManager Interface
+	virtual void UpdateViewTarget(FTViewTarget& OutVT, float DeltaTime) override;
+	//~ End APlayerCameraManager Interface
+
+	/** Fills FramedLocations with the locations of the fighters to frame. Returns false if there is no other fighter to frame */
+	bool GatherFramedLocations(AFightingCharacter* ViewFighter);
+
+	/** Locations of the fighters being framed, the viewed fighter first */
+	TArray<FVector> FramedLocations;
+
+	/** Center and radius of the framed fighters and direction from the viewed fighter to its target, when the framing was computed */
+	FVector FramedCenter;
+	float FramedRadius = 0.0f;
+	FVector FramedAxis;
+
+	/** Camera location and rotation of the framing */
+	FVector FramingLocation;
+	FRotator FramingRotation;
+
+	/** True if the framing was computed for the current view target */
+	bool bHasFraming = false;
+};
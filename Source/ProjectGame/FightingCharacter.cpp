@@ -2,16 +2,51 @@
 
 
 #include "FightingCharacter.h"
+#include "AttackCatalog.h"
+#include "BoxContact.h"
+#include "HitDetectionSubsystem.h"
+#include "HitboxComponent.h"
+#include "FighterTickManager.h"
+#include "FighterAIScheduler.h"
+#include "CombatClock.h"
+#include "FighterState.h"
+#include "FightingInputBufferComponent.h"
+#include "FightingStats.h"
+#include "HitTelemetry.h"
+#include "MyGameMode.h"
+#include "RollbackSubsystem.h"
+#include "Animation/AnimInstance.h"
 #include "Engine/EngineTypes.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Math/UnrealMathUtility.h"
+#include "HAL/IConsoleManager.h"
 #include "RenderCore.h"
 
 #include <vector>
-#include <random>
 
 #include "Engine.h"
 
+static TAutoConsoleVariable<int32> CVarGateDamageBoxes(
+	TEXT("Fighting.HitDetection.GateDamageBoxes"),
+	1,
+	TEXT("If 1, the Damage Collision Boxes of a FightingCharacter are only active while a fighter with an open attack window is\n")
+	TEXT("within its DamageBoxReachRadius: their collision is disabled, or with Fighting.Hitbox.UseComponent their hitboxes are\n")
+	TEXT("not updated and not tested for hits. Read when a FightingCharacter begins play."),
+	ECVF_Default);
+
+/** Bits of the fists and of the feet (and legs) in WeaponCollisionBoxes, in the order they are added in CollisionBoxesInit() */
+static const uint8 FistsWeaponMask = 0x03;
+static const uint8 FeetWeaponMask = 0x3C;
+
+/** Number of combat frames after the arms last overlapped in which a blocking character does not take damage nor react to head/chest hits (1 second) */
+static const int32 BlockWindowFrames = UCombatClock::TickRate;
+
+/** Minimum number of combat frames between two hits that damage the same body part (0.5 seconds) */
+static const int32 DamageCooldownFrames = UCombatClock::TickRate / 2;
+
+/** Minimum number of combat frames IsAttacking stays true after an attack performed from the input buffer, like a short key press (0.1 seconds) */
+static const int32 BufferedAttackPressFrames = UCombatClock::TickRate / 10;
+
 
 AFightingCharacter::AFightingCharacter()
 {
@@ -39,14 +74,14 @@ AFightingCharacter::AFightingCharacter()
 	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
 	FollowCamera->bUsePawnControlRotation = false;
 
-	Cam2LookAt = GetActorLocation() + FVector(100.0f, 0.0f, 0.0f);
-	Cam2Location = Cam2LookAt + GetActorForwardVector().RotateAngleAxis(90, FVector(0.0f, 0.0f, 1.0f)).GetSafeNormal()*Cam2Distance;
-
+	// Camera 2 is placed by AFightingCameraManager while active. Until then it looks at the front of the character from its right
 	Camera2 = CreateDefaultSubobject<UCameraComponent>(TEXT("Camera2"));
-	Camera2->SetWorldLocation(Cam2Location);
+	Camera2->SetRelativeLocation(FVector(100.0f, 300.0f, 0.0f));
 	Camera2->SetupAttachment(RootComponent);
 	Camera2->bUsePawnControlRotation = true;
 
+	InputBuffer = CreateDefaultSubobject<UFightingInputBufferComponent>(TEXT("InputBuffer"));
+
 	bDefeated = false;
 	IsBlocking = false;
 
@@ -62,118 +97,374 @@ void AFightingCharacter::BeginPlay()
 	FollowCamera->Deactivate();
 	Camera2->Activate();
 
-	// Set the Camera Location as the Controller Rotation
-	ControllerRotation = UKismetMathLibrary::FindLookAtRotation(Cam2Location, Cam2LookAt);
-	ThisPlayerController = UGameplayStatics::GetPlayerController(this, 0);
-	ThisPlayerController->SetControlRotation(ControllerRotation);
+	AttachCollisionBoxesToSockets();
 
-	IsPlayableChar = UGameplayStatics::GetPlayerPawn(GetWorld(), 0) == this;
+	// Use the default attacks if no AttackCatalog data asset was assigned in the Blueprint. Baked into a catalog of this
+	// character, as the class default object is shared by everything that reads the defaults
+	if (AttackCatalog == NULL) AttackCatalog = NewObject<UAttackCatalog>(this, TEXT("DefaultAttackCatalog"));
+	AttackCatalog->Bake();
 
-	AttachCollisionBoxesToSockets();
+	HitDetection = UHitDetectionSubsystem::IsEnabled() ? GetWorld()->GetSubsystem<UHitDetectionSubsystem>() : NULL;
+	HitTelemetry = UHitTelemetrySubsystem::Get(this);
 
-	// Set Collision events for Weapon Collision Boxes
-	for (UBoxComponent* weapon : WeaponCollisionBoxes) {
-		weapon->OnComponentHit.AddDynamic(this, &AFightingCharacter::OnAttackHit);
-		weapon->OnComponentBeginOverlap.AddDynamic(this, &AFightingCharacter::OnAttackOverlapBegin);
-		weapon->OnComponentEndOverlap.AddDynamic(this, &AFightingCharacter::OnAttackOverlapEnd);
+	if (HitDetection != NULL) {
+		// The subsystem tests the boxes itself, so the physics engine does not need to generate overlaps for them
+		if (UHitboxComponent::IsEnabled()) InitHitboxes();
+		HitDetection->RegisterFighter(this);
+		for (UBoxComponent* damageBox : DamageCollisionBoxes) damageBox->SetGenerateOverlapEvents(false);
 	}
+	else {
+		// Set Collision events for Weapon Collision Boxes
+		for (UBoxComponent* weapon : WeaponCollisionBoxes) {
+			weapon->OnComponentHit.AddDynamic(this, &AFightingCharacter::OnAttackHit);
+			weapon->OnComponentBeginOverlap.AddDynamic(this, &AFightingCharacter::OnAttackOverlapBegin);
+			weapon->OnComponentEndOverlap.AddDynamic(this, &AFightingCharacter::OnAttackOverlapEnd);
+		}
+	}
+
+	bGateDamageBoxes = CVarGateDamageBoxes.GetValueOnGameThread() != 0;
+	if (bGateDamageBoxes) SetDamageBoxesActive(false);
+
+	CombatClock = GetWorld()->GetSubsystem<UCombatClock>();
+	if (CombatClock != NULL) CombatClock->OnCombatStep.AddUObject(this, &AFightingCharacter::CombatStep);
 
 	VariablesInit();
+
+	TickManager = UFighterTickManager::IsEnabled() ? GetWorld()->GetSubsystem<UFighterTickManager>() : NULL;
+	if (TickManager != NULL) TickManager->RegisterFighter(this);
+
+	AIScheduler = UFighterAIScheduler::IsEnabled() ? GetWorld()->GetSubsystem<UFighterAIScheduler>() : NULL;
+	if (AIScheduler != NULL) AIScheduler->RegisterFighter(this);
 }
 
-// Called every frame
-void AFightingCharacter::Tick(float DeltaTime)
+void AFightingCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	if (HitDetection != NULL) HitDetection->UnregisterFighter(this);
+	HitDetection = NULL;
+
+	if (TickManager != NULL) TickManager->UnregisterFighter(this);
+	TickManager = NULL;
+
+	if (AIScheduler != NULL) AIScheduler->UnregisterFighter(this);
+	AIScheduler = NULL;
+
+	if (CombatClock != NULL) CombatClock->OnCombatStep.RemoveAll(this);
+	CombatClock = NULL;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 AFightingCharacter::GetCombatFrame() const
+{
+	return CombatClock != NULL ? CombatClock->GetFrame() : 0;
+}
 
-	RotateToTarget(DeltaTime);
+bool AFightingCharacter::IsResimulating() const
+{
+	URollbackSubsystem* rollback = GetWorld()->GetSubsystem<URollbackSubsystem>();
+	return rollback != NULL && rollback->IsResimulating();
+}
 
-	// Setting max speed on whether is running or not
-	// If it's running character orients rotation to movement, but if it's only walking it does not
-	if (bIsRunning) {
-		GetCharacterMovement()->bOrientRotationToMovement = true;
-		GetCharacterMovement()->MaxWalkSpeed = MaxRunSpeed;
+void AFightingCharacter::SaveState(FFighterState& OutState) const
+{
+	FMemory::Memzero(OutState);
+
+	OutState.Frame = GetCombatFrame();
+	OutState.Location = GetActorLocation();
+	OutState.Yaw = GetActorRotation().Yaw;
+	OutState.Velocity = GetCharacterMovement()->Velocity;
+	OutState.MovementMaxWalkSpeed = GetCharacterMovement()->MaxWalkSpeed;
+
+	OutState.HealthPoints = HealthPoints;
+	for (int32 part = 0; part < NumBodyParts; part++) {
+		OutState.DamagePotential[part] = DamagePotential[part];
+		OutState.LastDamageTakenFrame[part] = LastDamageTakenFrame[part];
+		if (HitFlags[part] != NULL && *HitFlags[part]) OutState.HitFlags |= 1 << part;
 	}
-	else {
-		GetCharacterMovement()->bOrientRotationToMovement = false;
-		//If it's not running but current speed is more than the max walk speed, decrease it gradually
-		if (GetVelocity().Size() > MaxWalkSpeed) {
-			GetCharacterMovement()->MaxWalkSpeed -= GetCharacterMovement()->MaxAcceleration*DeltaTime;
-		}
-		else GetCharacterMovement()->MaxWalkSpeed = MaxWalkSpeed;
+	OutState.LastArmsOverlapFrame = LastArmsOverlapFrame;
+
+	OutState.ComboState = ComboState;
+	OutState.ComboRandomSeed = ComboRandom.GetCurrentSeed();
+	OutState.LastAttackImpactVel = LastAttackImpactVel;
+	OutState.LastAttackPoints = LastAttackPoints;
+	for (int32 limb = 0; limb < NumLimbs; limb++) OutState.PeakLimbVelocity[limb] = LimbVelocity[limb].GetPeakVelocity();
+
+	UAnimMontage* montage = GetCurrentMontage();
+	int32 attackId = montage != NULL ? AttackCatalog->FindAttackId(montage) : INDEX_NONE;
+	OutState.MontageAttackId = (int16)attackId;
+	OutState.MontagePosition = attackId != INDEX_NONE ? GetMesh()->GetAnimInstance()->Montage_GetPosition(montage) : 0.0f;
+	OutState.Reaction = (uint8)Reaction.GetValue();
+
+	uint32 flags = 0;
+	if (CanMove) flags |= FFighterState::CanMove;
+	if (CanJump_) flags |= FFighterState::CanJump;
+	if (CanAttack) flags |= FFighterState::CanAttack;
+	if (CanBlock) flags |= FFighterState::CanBlock;
+	if (CanDuck) flags |= FFighterState::CanDuck;
+	if (CanAddNextComboAttack) flags |= FFighterState::CanAddNextComboAttack;
+	if (IsAttacking) flags |= FFighterState::IsAttacking;
+	if (IsBlocking) flags |= FFighterState::IsBlocking;
+	if (IsDucking) flags |= FFighterState::IsDucking;
+	if (MoveModPressed) flags |= FFighterState::MoveModPressed;
+	if (TauntPressed) flags |= FFighterState::TauntPressed;
+	if (bDefeated) flags |= FFighterState::Defeated;
+	if (bIsRunning) flags |= FFighterState::IsRunning;
+	if (bAttack1) flags |= FFighterState::Attack1;
+	if (bAttack2) flags |= FFighterState::Attack2;
+	if (bTrackFistsVelocity) flags |= FFighterState::TrackFists;
+	if (bTrackFeetVelocity) flags |= FFighterState::TrackFeet;
+	OutState.Flags = flags;
+
+	for (int32 i = 0; i < NumDamageBoxes; i++) {
+		if (IsDamageBoxOverlapping[i]) OutState.DamageBoxOverlapMask |= 1 << i;
+	}
+
+	// Buttons still held and presses not performed yet are used by the next frames
+	FBufferedInput pending[FFighterState::MaxPendingPresses];
+	const int32 numPending = InputBuffer->GetPendingPresses(OutState.Frame, pending, FFighterState::MaxPendingPresses);
+	OutState.HeldActions = InputBuffer->GetHeldMask();
+	OutState.NumPendingPresses = (uint8)numPending;
+	for (int32 i = 0; i < numPending; i++) {
+		OutState.PendingPresses[i].Frame = pending[i].Frame;
+		OutState.PendingPresses[i].HeldMask = pending[i].HeldMask;
+		OutState.PendingPresses[i].Action = (uint8)pending[i].Action;
 	}
+	OutState.LastBufferedAttackFrame = LastBufferedAttackFrame;
+}
 
-	// Tracking velocity of fists/foots when punching/kicking
-	if (bTrackFistsVelocity) {
-		FVector currentPos = LeftFistCollisionBox->GetComponentLocation();
-		LeftFistVelocity = (currentPos - LeftFistLastPos).Size()/DeltaTime;
-		LeftFistLastPos = currentPos;
+void AFightingCharacter::LoadState(const FFighterState& State)
+{
+	uint32 flags = State.Flags;
+
+	// Inputs only record the buttons that change against the input of the saved frame, so the held buttons and pending presses are restored
+	FBufferedInput pending[FFighterState::MaxPendingPresses];
+	const int32 numPending = FMath::Min<int32>(State.NumPendingPresses, FFighterState::MaxPendingPresses);
+	for (int32 i = 0; i < numPending; i++) {
+		pending[i].Frame = State.PendingPresses[i].Frame;
+		pending[i].HeldMask = State.PendingPresses[i].HeldMask;
+		pending[i].Action = (EFighterAction)State.PendingPresses[i].Action;
+		pending[i].bPressed = true;
+		pending[i].bConsumed = false;
+	}
+	InputBuffer->Restore(State.HeldActions, pending, numPending);
+	LastBufferedAttackFrame = State.LastBufferedAttackFrame;
+
+	// Attacks performed after the saved frame are performed again, or not, when the frames are simulated again
+	PendingAttacks.RemoveAll([&State](const FPendingAttack& attack) { return attack.Frame > State.Frame; });
+
+	// Attack windows change the collision profiles of the weapon boxes, so they are opened or closed through the usual functions
+	bool trackFists = (flags & FFighterState::TrackFists) != 0;
+	bool trackFeet = (flags & FFighterState::TrackFeet) != 0;
+	if (trackFists != bTrackFistsVelocity) {
+		if (trackFists) PunchAttackStart();
+		else PunchAttackEnd();
+	}
+	if (trackFeet != bTrackFeetVelocity) {
+		if (trackFeet) KickAttackStart();
+		else KickAttackEnd();
+	}
 
-		currentPos = RightFistCollisionBox->GetComponentLocation();
-		RightFistVelocity = (currentPos - RightFistLastPos).Size() / DeltaTime;
-		RightFistLastPos = currentPos;
+	SetActorLocationAndRotation(State.Location, FRotator(0.0f, State.Yaw, 0.0f), false, nullptr, ETeleportType::TeleportPhysics);
+	GetCharacterMovement()->Velocity = State.Velocity;
+	GetCharacterMovement()->MaxWalkSpeed = State.MovementMaxWalkSpeed;
 
-		//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Blue, FString::Printf(TEXT("RightFistVelocity: %f"), RightFistVelocity));
-		//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Yellow, FString::Printf(TEXT("LeftFistLastPos: %f"), LeftFistVelocity));
+	// Listeners of OnFighterDamaged would not see the health going back otherwise
+	float previous_health = HealthPoints;
+	HealthPoints = State.HealthPoints;
+	if (HealthPoints != previous_health && !IsResimulating()) OnFighterDamaged.Broadcast(EBodyPart::None, previous_health - HealthPoints, HealthPoints, 0.0f);
 
-		if (LeftFistVelocity > LeftFistVelocity_max) LeftFistVelocity_max = LeftFistVelocity;
-		if (RightFistVelocity > RightFistVelocity_max) RightFistVelocity_max = RightFistVelocity;
+	for (int32 part = 0; part < NumBodyParts; part++) {
+		DamagePotential[part] = State.DamagePotential[part];
+		LastDamageTakenFrame[part] = State.LastDamageTakenFrame[part];
+		if (HitFlags[part] != NULL) *HitFlags[part] = (State.HitFlags & (1 << part)) != 0;
+	}
+	LastArmsOverlapFrame = State.LastArmsOverlapFrame;
+
+	ComboState = State.ComboState;
+	ComboSequenceStr = AttackCatalog->GetComboGraph().GetSequence(ComboState);
+	ComboRandom.Initialize(State.ComboRandomSeed);
+	if (LastAttackImpactVel != State.LastAttackImpactVel || LastAttackPoints != State.LastAttackPoints) {
+		LastAttackImpactVel = State.LastAttackImpactVel;
+		LastAttackPoints = State.LastAttackPoints;
+		if (!IsResimulating()) OnAttackStatsChanged.Broadcast();
+	}
+	for (int32 limb = 0; limb < NumLimbs; limb++) LimbVelocity[limb].SetPeakVelocity(State.PeakLimbVelocity[limb]);
+
+	// Restart the attack montage at the saved position. Montages that are not attacks (reactions) are driven by Reaction
+	UAnimInstance* animInstance = GetMesh()->GetAnimInstance();
+	UAnimMontage* currentMontage = GetCurrentMontage();
+	UAnimMontage* savedMontage = AttackCatalog->GetAttackMontage(State.MontageAttackId);
+	if (animInstance != NULL) {
+		if (savedMontage != NULL) {
+			if (currentMontage != savedMontage) animInstance->Montage_Play(savedMontage);
+			animInstance->Montage_SetPosition(savedMontage, State.MontagePosition);
+		}
+		else if (currentMontage != NULL && AttackCatalog->FindAttackId(currentMontage) != INDEX_NONE) {
+			animInstance->Montage_Stop(0.0f, currentMontage);
+		}
+	}
+	Reaction = (ReactType)State.Reaction;
+
+	// The weapon sweeps of the frames simulated from this state start from its pose, not from the pose before the load
+	if (bContinuousHitDetection) {
+		static const FName WeaponProfile("Weapon");
+
+		GetMesh()->TickAnimation(0.0f, false);
+		GetMesh()->RefreshBoneTransforms();
+		if (bUseHitboxes) Hitboxes->UpdateBoxes();
+		for (int32 i = 0; i < (int32)WeaponCollisionBoxes.size(); i++) {
+			LastWeaponTransforms[i] = GetWeaponBoxTransform(i);
+			WasWeaponBoxActive[i] = WeaponCollisionBoxes[i]->GetCollisionProfileName() == WeaponProfile;
+		}
+		LastWeaponSweepFrame = State.Frame;
 	}
 
-	if (bTrackFeetVelocity) {
-		FVector currentPos = LeftFootCollisionBox->GetComponentLocation();
-		LeftFootVelocity = (currentPos - LeftFootLastPos).Size() / DeltaTime;
-		LeftFootLastPos = currentPos;
+	CanMove = (flags & FFighterState::CanMove) != 0;
+	CanJump_ = (flags & FFighterState::CanJump) != 0;
+	CanAttack = (flags & FFighterState::CanAttack) != 0;
+	CanBlock = (flags & FFighterState::CanBlock) != 0;
+	CanDuck = (flags & FFighterState::CanDuck) != 0;
+	CanAddNextComboAttack = (flags & FFighterState::CanAddNextComboAttack) != 0;
+	IsAttacking = (flags & FFighterState::IsAttacking) != 0;
+	IsBlocking = (flags & FFighterState::IsBlocking) != 0;
+	IsDucking = (flags & FFighterState::IsDucking) != 0;
+	MoveModPressed = (flags & FFighterState::MoveModPressed) != 0;
+	TauntPressed = (flags & FFighterState::TauntPressed) != 0;
+	bDefeated = (flags & FFighterState::Defeated) != 0;
+	bIsRunning = (flags & FFighterState::IsRunning) != 0;
+	bAttack1 = (flags & FFighterState::Attack1) != 0;
+	bAttack2 = (flags & FFighterState::Attack2) != 0;
+
+	for (int32 i = 0; i < NumDamageBoxes; i++) {
+		IsDamageBoxOverlapping[i] = (State.DamageBoxOverlapMask & (1 << i)) != 0;
+	}
+}
 
-		currentPos = RightFootCollisionBox->GetComponentLocation();
-		RightFootVelocity = (currentPos - RightFootLastPos).Size() / DeltaTime;
-		RightFootLastPos = currentPos;
+void AFightingCharacter::ApplyInput(const FFighterInput& Input, const FFighterInput& PreviousInput)
+{
+	// Calls the press function of each button that was pressed and the release function of each button that was released
+	auto ApplyButton = [&](FFighterInput::EButton Button, void (AFightingCharacter::*Press)(), void (AFightingCharacter::*Release)()) {
+		bool pressed = Input.IsPressed(Button);
+		if (pressed == PreviousInput.IsPressed(Button)) return;
+		if (pressed) (this->*Press)();
+		else if (Release != NULL) (this->*Release)();
+	};
+
+	ApplyButton(FFighterInput::Run, &AFightingCharacter::Run, &AFightingCharacter::StopRunning);
+	ApplyButton(FFighterInput::MoveMod, &AFightingCharacter::MoveMod, &AFightingCharacter::StopMoveMod);
+	ApplyButton(FFighterInput::Taunt, &AFightingCharacter::Taunt, &AFightingCharacter::StopTaunt);
+	ApplyButton(FFighterInput::Duck, &AFightingCharacter::Duck, &AFightingCharacter::StopDucking);
+	ApplyButton(FFighterInput::Block, &AFightingCharacter::Block, &AFightingCharacter::StopBlocking);
+	ApplyButton(FFighterInput::Attack1, &AFightingCharacter::Attack1, &AFightingCharacter::StopAttack1);
+	ApplyButton(FFighterInput::Attack2, &AFightingCharacter::Attack2, &AFightingCharacter::StopAttack2);
+	ApplyButton(FFighterInput::Jump, &AFightingCharacter::JumpChecking, &AFightingCharacter::StopJumpChecking);
+
+	// Same as MoveForward() and MoveRight(), with the direction already in world space
+	if (!bDefeated && CanMove && (Input.MoveX != 0 || Input.MoveY != 0)) {
+		AddMovementInput(FVector(Input.MoveX, Input.MoveY, 0.0f) / 127.0f);
+	}
+}
 
-		//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Blue, FString::Printf(TEXT("RightFootVelocity: %f"), RightFootVelocity));
-		//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Yellow, FString::Printf(TEXT("LeftFootVelocity: %f"), LeftFootVelocity));
+void AFightingCharacter::ResimulateStep(float DeltaTime)
+{
+	// Movement is not resimulated by the character movement component: the saved velocity is kept
+	SetActorLocation(GetActorLocation() + GetCharacterMovement()->Velocity * DeltaTime);
 
-		if (LeftFootVelocity > LeftFootVelocity_max) LeftFootVelocity_max = LeftFootVelocity;
-		if (RightFootVelocity > RightFootVelocity_max) RightFootVelocity_max = RightFootVelocity;
-	}
+	GetMesh()->TickAnimation(DeltaTime, false);
+	GetMesh()->RefreshBoneTransforms();
+	if (bUseHitboxes) Hitboxes->UpdateBoxes();
+
+	// Same hit detection work as Tick(), on the resimulated pose
+	if (bGateDamageBoxes) UpdateDamageBoxGating();
+	if (bContinuousHitDetection) SweepWeaponCollisionBoxes();
+}
 
-	// Track last time an arm was overlapping while blocking
+FFighterInput AFightingCharacter::GetCurrentInput() const
+{
+	// The buttons of FFighterInput are in the same order as the actions of the input buffer
+	static_assert(FFighterInput::Attack1 == 1 << (int32)EFighterAction::Attack1 && FFighterInput::Attack2 == 1 << (int32)EFighterAction::Attack2
+		&& FFighterInput::Block == 1 << (int32)EFighterAction::Block && FFighterInput::Duck == 1 << (int32)EFighterAction::Duck
+		&& FFighterInput::MoveMod == 1 << (int32)EFighterAction::MoveMod && FFighterInput::Taunt == 1 << (int32)EFighterAction::Taunt
+		&& FFighterInput::Run == 1 << (int32)EFighterAction::Run && FFighterInput::Jump == 1 << (int32)EFighterAction::Jump,
+		"FFighterInput::EButton must match EFighterAction");
+
+	FFighterInput input;
+	input.Buttons = InputBuffer->GetHeldMask();
+
+	FVector move = GetLastMovementInputVector().GetClampedToMaxSize(1.0f);
+	input.MoveX = (int8)FMath::RoundToInt(move.X * 127.0f);
+	input.MoveY = (int8)FMath::RoundToInt(move.Y * 127.0f);
+	return input;
+}
+
+void AFightingCharacter::CombatStep(int32 Frame)
+{
+	// Track last frame an arm was overlapping while blocking
 	if (IsBlocking) {
-		if(IsDamageBoxOverlapping[TEXT("RightArmCollisionBox")] || IsDamageBoxOverlapping[TEXT("RightForearmCollisionBox")]
-			|| IsDamageBoxOverlapping[TEXT("LeftArmCollisionBox")] || IsDamageBoxOverlapping[TEXT("LeftForearmCollisionBox")])
-			LastArmsOverlapTime = GetWorld()->GetTimeSeconds();
+		if (IsBodyPartOverlapping(EBodyPart::RightArm) || IsBodyPartOverlapping(EBodyPart::LeftArm))
+			LastArmsOverlapFrame = Frame;
 	}
 
-	/*for (UBoxComponent* db : DamageCollisionBoxes) { // for debugging
-		GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Yellow, FString::Printf(TEXT("%s is overlapping"), *db->GetName()));
-	}*/
+	// Perform an attack pressed while the previous one was playing, as soon as the next combo attack can be added
+	PerformBufferedAttack();
+	ObserveConfirmedAttacks();
 
+	// An attack performed from the buffer may have been released already. It is shown as a short press
+	if (IsAttacking && !InputBuffer->IsHeld(EFighterAction::Attack1) && !InputBuffer->IsHeld(EFighterAction::Attack2)
+		&& Frame - LastBufferedAttackFrame >= BufferedAttackPressFrames) {
+		IsAttacking = false;
+	}
+}
 
-	//Set Camera 2 location and rotation
-	if (IsPlayableChar && Camera2->IsActive() && TargetEnemy != NULL && ThisPlayerController != NULL) {
-		FVector ToTargetDirection = TargetEnemy->GetActorLocation() - GetActorLocation();
-		float distance = ToTargetDirection.Size();
-		//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Cyan, FString::Printf(TEXT("distance: %f"), distance));
+// Called every frame
+void AFightingCharacter::Tick(float DeltaTime)
+{
+	FIGHTING_SCOPE_CYCLE_COUNTER(FighterTick);
 
-		// If character are very distanced from each other add a distanceOffset,
-		// so the camera is further away and both characters can been seen
-		float distanceOffset = 0.0f;
-		if (distance > 500.0f) {
-			distanceOffset = (distance - 500.0f)*0.5;
+	Super::Tick(DeltaTime);
+
+	// When registered with the tick manager, all fighters are updated by it in a single pass
+	if (TickManager == NULL) {
+		RotateToTarget(DeltaTime);
+
+		// Setting max speed on whether is running or not
+		// If it's running character orients rotation to movement, but if it's only walking it does not
+		if (bIsRunning) {
+			GetCharacterMovement()->bOrientRotationToMovement = true;
+			GetCharacterMovement()->MaxWalkSpeed = MaxRunSpeed;
+		}
+		else {
+			GetCharacterMovement()->bOrientRotationToMovement = false;
+			//If it's not running but current speed is more than the max walk speed, decrease it gradually
+			if (GetVelocity().Size() > MaxWalkSpeed) {
+				GetCharacterMovement()->MaxWalkSpeed -= GetCharacterMovement()->MaxAcceleration*DeltaTime;
+			}
+			else GetCharacterMovement()->MaxWalkSpeed = MaxWalkSpeed;
 		}
 
-		// Look At is middle point between the character and the target enemy
-		Cam2LookAt = GetActorLocation() + ToTargetDirection/2;
+		// Tracking velocity of fists/foots when punching/kicking
+		float current_time = GetWorld()->GetTimeSeconds();
+		if (bTrackFistsVelocity) {
+			LimbVelocity[(int32)ELimb::RightFist].AddPose(current_time, GetLimbLocation(ELimb::RightFist));
+			LimbVelocity[(int32)ELimb::LeftFist].AddPose(current_time, GetLimbLocation(ELimb::LeftFist));
+		}
 
-		// Location is to the right of Cam2LookAt (90 angle with ToTargetDirection) at a (Cam2Distance + distanceOffset) distance
-		Cam2Location = Cam2LookAt + ToTargetDirection.RotateAngleAxis(90, FVector(0.0f, 0.0f, 1.0f)).GetSafeNormal() * (Cam2Distance + distanceOffset);
-		Cam2LookAt.Z = 250;
-		Cam2Location.Z = 250;		
-		
-		Camera2->SetWorldLocation(Cam2Location);
-		ControllerRotation = UKismetMathLibrary::FindLookAtRotation(Cam2Location, Cam2LookAt);
-		ThisPlayerController->SetControlRotation(ControllerRotation);
+		if (bTrackFeetVelocity) {
+			LimbVelocity[(int32)ELimb::RightFoot].AddPose(current_time, GetLimbLocation(ELimb::RightFoot));
+			LimbVelocity[(int32)ELimb::LeftFoot].AddPose(current_time, GetLimbLocation(ELimb::LeftFoot));
+		}
 	}
-	
+
+	if (bGateDamageBoxes) UpdateDamageBoxGating();
+	if (bDamageBoxesActive) {
+		FIGHTING_INC_COUNTER_BY(DamageBoxesActive, NumDamageBoxes);
+	}
+
+	if (bContinuousHitDetection) SweepWeaponCollisionBoxes();
+
+	/*for (UBoxComponent* db : DamageCollisionBoxes) { // for debugging
+		GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Yellow, FString::Printf(TEXT("%s is overlapping"), *db->GetName()));
+	}*/
 
 	//UE_LOG(LogTemp, Warning, TEXT("speed: %f"), GetVelocity().Size());
 }
@@ -195,7 +486,7 @@ void AFightingCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputC
 	PlayerInputComponent->BindAction("Run", IE_Released, this, &AFightingCharacter::StopRunning);
 
 	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &AFightingCharacter::JumpChecking);
-	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
+	PlayerInputComponent->BindAction("Jump", IE_Released, this, &AFightingCharacter::StopJumpChecking);
 
 	PlayerInputComponent->BindAction("Attack1", IE_Pressed, this, &AFightingCharacter::Attack1);
 	PlayerInputComponent->BindAction("Attack1", IE_Released, this, &AFightingCharacter::StopAttack1);
@@ -256,87 +547,152 @@ void AFightingCharacter::LookUp(float Val)
 
 void AFightingCharacter::Run()
 {
+	InputBuffer->Record(EFighterAction::Run, true, GetCombatFrame());
 	bIsRunning = true;
 }
 
 void AFightingCharacter::StopRunning()
 {
+	InputBuffer->Record(EFighterAction::Run, false, GetCombatFrame());
 	bIsRunning = false;
 }
 
 void AFightingCharacter::JumpChecking()
 {
+	InputBuffer->Record(EFighterAction::Jump, true, GetCombatFrame());
 	if (!bDefeated && CanJump_) {
 		Jump();
 	}
 }
 
+void AFightingCharacter::StopJumpChecking()
+{
+	InputBuffer->Record(EFighterAction::Jump, false, GetCombatFrame());
+	StopJumping();
+}
+
 void AFightingCharacter::Attack1()
 {
+	InputBuffer->Record(EFighterAction::Attack1, true, GetCombatFrame());
 	if (!bDefeated && CanAttack && !(GetCharacterMovement()->IsFalling())) {
-		if (CanAddNextComboAttack) {
-			if (IsDucking) ComboSequenceStr = TEXT("0");
-			// Move modifier is only effecitve if it's the beginning of a new sequence
-			else if (MoveModPressed && ComboSequenceStr.Equals(TEXT(""))) ComboSequenceStr = TEXT("3");
-			else if (TauntPressed) {
-				// Randomly chooses between two taunt animations
-				if( get_random_float() <= 0.50) ComboSequenceStr = TEXT("5");
-				else ComboSequenceStr = TEXT("55");
-			}
-			else ComboSequenceStr += TEXT("1");
-			CanAddNextComboAttack = false;
-			CanMove = false;
-			CanBlock = false;
-			CanJump_ = false;
-			CanDuck = false;
-
-			Foot_R_Location = GetMesh()->GetSocketLocation("foot_r");
-			Foot_L_Location = GetMesh()->GetSocketLocation("foot_l");
-		}
+		PerformBufferedAttack();
 		IsAttacking = true;
 	}
 }
 
 void AFightingCharacter::StopAttack1()
 {
+	InputBuffer->Record(EFighterAction::Attack1, false, GetCombatFrame());
 	bAttack1 = false;
 	IsAttacking = false;
 }
 
 void AFightingCharacter::Attack2()
 {
+	InputBuffer->Record(EFighterAction::Attack2, true, GetCombatFrame());
 	if (!bDefeated && CanAttack && !(GetCharacterMovement()->IsFalling())) {
-		if (CanAddNextComboAttack) { 
-			if (IsDucking) ComboSequenceStr = TEXT("0");
-			// Move modifier is only effecitve if it's the beginning of a new sequence
-			else if (MoveModPressed && ComboSequenceStr.Equals(TEXT(""))) ComboSequenceStr = TEXT("4");
-			else if (TauntPressed) {
-				// Randomly chooses between two taunt animations
-				if (get_random_float() <= 0.90) ComboSequenceStr = TEXT("6");
-				else ComboSequenceStr = TEXT("66");
-			}
-			else ComboSequenceStr += TEXT("2");
-			CanAddNextComboAttack = false;
-			CanMove = false;
-			CanBlock = false;
-			CanJump_ = false;
-			CanDuck = false;
-
-			Foot_R_Location = GetMesh()->GetSocketLocation("foot_r");
-			Foot_L_Location = GetMesh()->GetSocketLocation("foot_l");
-		}
+		PerformBufferedAttack();
 		IsAttacking = true;
 	}
 }
 
 void AFightingCharacter::StopAttack2()
 {
+	InputBuffer->Record(EFighterAction::Attack2, false, GetCombatFrame());
 	bAttack2 = false;
 	IsAttacking = false;
 }
 
+void AFightingCharacter::PerformBufferedAttack()
+{
+	if (bDefeated || !CanAttack || !CanAddNextComboAttack || GetCharacterMovement()->IsFalling()) return;
+
+	const int32 frame = GetCombatFrame();
+	const uint16 attackMask = GetActionBit(EFighterAction::Attack1) | GetActionBit(EFighterAction::Attack2);
+	FBufferedInput press;
+
+	// Presses are performed in the order they were made, with the modifiers held at the time
+	while (InputBuffer->ConsumePress(attackMask, frame, press)) {
+		EComboInput attackInput = press.Action == EFighterAction::Attack1 ? EComboInput::Attack1 : EComboInput::Attack2;
+		if (!AdvanceCombo(attackInput, press.IsHeld(EFighterAction::MoveMod), press.IsHeld(EFighterAction::Taunt))) continue;
+
+		CanAddNextComboAttack = false;
+		CanMove = false;
+		CanBlock = false;
+		CanJump_ = false;
+		CanDuck = false;
+
+		Foot_R_Location = GetMesh()->GetSocketLocation("foot_r");
+		Foot_L_Location = GetMesh()->GetSocketLocation("foot_l");
+
+		IsAttacking = true;
+		LastBufferedAttackFrame = frame;
+
+		// A rollback may still replace the attack, so it is observed once its frame is confirmed
+		if (frame > LastObservedAttackFrame) PendingAttacks.Add({ frame, ComboState });
+		return;
+	}
+}
+
+void AFightingCharacter::ObserveConfirmedAttacks()
+{
+	if (PendingAttacks.Num() == 0) return;
+
+	// Without a rollback session every frame is final
+	URollbackSubsystem* rollback = GetWorld()->GetSubsystem<URollbackSubsystem>();
+	const int32 confirmed_frame = rollback != NULL && rollback->IsSessionRunning() ? rollback->GetConfirmedCombatFrame() : GetCombatFrame();
+
+	int32 observed = 0;
+	for (; observed < PendingAttacks.Num() && PendingAttacks[observed].Frame <= confirmed_frame; observed++) {
+		const FPendingAttack& attack = PendingAttacks[observed];
+		if (attack.Frame <= LastObservedAttackFrame) continue;
+
+		ComboPredictor.Observe(attack.ComboState);
+		LastObservedAttackFrame = attack.Frame;
+	}
+	PendingAttacks.RemoveAt(0, observed, false);
+}
+
+bool AFightingCharacter::AdvanceCombo(EComboInput AttackInput, bool bMoveMod, bool bTaunt)
+{
+	const FComboGraph& Combos = AttackCatalog->GetComboGraph();
+	bool isAttack1 = AttackInput == EComboInput::Attack1;
+	int32 nextState;
+
+	if (IsDucking) nextState = Combos.Advance(FComboGraph::RootState, EComboInput::DuckAttack);
+	// Move modifier is only effecitve if it's the beginning of a new sequence
+	else if (bMoveMod && ComboState == FComboGraph::RootState) {
+		nextState = Combos.Advance(FComboGraph::RootState, isAttack1 ? EComboInput::MoveModAttack1 : EComboInput::MoveModAttack2);
+	}
+	else if (bTaunt) {
+		EComboInput tauntInput = isAttack1 ? EComboInput::TauntAttack1 : EComboInput::TauntAttack2;
+		nextState = Combos.Advance(FComboGraph::RootState, tauntInput);
+
+		// Randomly chooses between two taunt animations ("5" or "55" / "6" or "66")
+		float variantThreshold = isAttack1 ? 0.50 : 0.90;
+		if (nextState != INDEX_NONE && ComboRandom.GetFraction() > variantThreshold) {
+			int32 variantState = Combos.Advance(nextState, tauntInput);
+			if (variantState != INDEX_NONE) nextState = variantState;
+		}
+	}
+	else nextState = Combos.Advance(ComboState, AttackInput);
+
+	// Sequence not defined in the combo graph
+	if (nextState == INDEX_NONE) return false;
+
+	ComboState = nextState;
+	ComboSequenceStr = Combos.GetSequence(ComboState);
+	return true;
+}
+
+UAnimMontage* AFightingCharacter::GetComboMontage()
+{
+	return AttackCatalog->GetComboGraph().GetMontage(ComboState);
+}
+
 void AFightingCharacter::Block()
 {
+	InputBuffer->Record(EFighterAction::Block, true, GetCombatFrame());
 	if (!bDefeated && CanBlock && !(GetCharacterMovement()->IsFalling())) {
 		IsBlocking = true;
 		CanMove = false;
@@ -346,6 +702,12 @@ void AFightingCharacter::Block()
 }
 
 void AFightingCharacter::StopBlocking()
+{
+	InputBuffer->Record(EFighterAction::Block, false, GetCombatFrame());
+	EndBlocking();
+}
+
+void AFightingCharacter::EndBlocking()
 {
 	if (IsBlocking) {
 		IsBlocking = false;
@@ -357,6 +719,7 @@ void AFightingCharacter::StopBlocking()
 
 void AFightingCharacter::Duck()
 {
+	InputBuffer->Record(EFighterAction::Duck, true, GetCombatFrame());
 	if (!bDefeated && CanDuck && !(GetCharacterMovement()->IsFalling())) {
 		IsDucking = true;
 		CanMove = false;
@@ -367,6 +730,7 @@ void AFightingCharacter::Duck()
 
 void AFightingCharacter::StopDucking()
 {
+	InputBuffer->Record(EFighterAction::Duck, false, GetCombatFrame());
 	if (IsDucking) {
 		IsDucking = false;
 		CanMove = true;
@@ -377,22 +741,26 @@ void AFightingCharacter::StopDucking()
 
 void AFightingCharacter::MoveMod()
 {
+	InputBuffer->Record(EFighterAction::MoveMod, true, GetCombatFrame());
 	MoveModPressed = true;
 }
 
 
 void AFightingCharacter::StopMoveMod()
 {
+	InputBuffer->Record(EFighterAction::MoveMod, false, GetCombatFrame());
 	MoveModPressed = false;
 }
 
 void AFightingCharacter::Taunt()
 {
+	InputBuffer->Record(EFighterAction::Taunt, true, GetCombatFrame());
 	TauntPressed = true;
 }
 
 void AFightingCharacter::StopTaunt()
 {
+	InputBuffer->Record(EFighterAction::Taunt, false, GetCombatFrame());
 	TauntPressed = false;
 }
 
@@ -420,20 +788,72 @@ float AFightingCharacter::GetHealthPoints() {
 	return HealthPoints;
 }
 
+void AFightingCharacter::SetDamageTuning(float BaseDamageScale, float NewPotentialIncrement)
+{
+	for (int32 part = 0; part < NumBodyParts; part++) BaseDamage[part] *= BaseDamageScale;
+	if (NewPotentialIncrement >= 0.0f) PotentialIncrement = NewPotentialIncrement;
+}
+
 float AFightingCharacter::GetDamagePotential(FString bodyPart) {
-	return DamagePotential[bodyPart];
+	return GetBodyPartDamagePotential(BodyPartFromName(bodyPart));
+}
+
+float AFightingCharacter::GetBodyPartDamagePotential(EBodyPart BodyPart) {
+	if (BodyPart == EBodyPart::None) return 0.0f;
+	return DamagePotential[(int32)GetDamageCategory(BodyPart)];
+}
+
+EBodyPart AFightingCharacter::GetBodyPart(const UPrimitiveComponent* CollisionBox) const
+{
+	int32 index = GetDamageBoxIndex(CollisionBox);
+	return index != INDEX_NONE ? DamageBoxBodyPart[index] : EBodyPart::None;
+}
+
+int32 AFightingCharacter::GetDamageBoxIndex(const UPrimitiveComponent* CollisionBox) const
+{
+	// There are only NumDamageBoxes boxes, so a linear search over the pointers is cheaper than any map lookup
+	for (int32 i = 0; i < (int32)DamageCollisionBoxes.size(); i++) {
+		if (DamageCollisionBoxes[i] == CollisionBox) return i;
+	}
+	return INDEX_NONE;
+}
+
+bool AFightingCharacter::IsBodyPartOverlapping(EBodyPart BodyPart) const
+{
+	for (int32 i = 0; i < (int32)DamageCollisionBoxes.size(); i++) {
+		if (DamageBoxBodyPart[i] == BodyPart && IsDamageBoxOverlapping[i]) return true;
+	}
+	return false;
+}
+
+EBodyPart AFightingCharacter::BodyPartFromName(const FString& Name)
+{
+	if (Name.Equals(TEXT("head"))) return EBodyPart::Head;
+	else if (Name.Equals(TEXT("chest"))) return EBodyPart::Chest;
+	else if (Name.Equals(TEXT("torso"))) return EBodyPart::Torso;
+	else if (Name.Equals(TEXT("right_arm"))) return EBodyPart::RightArm;
+	else if (Name.Equals(TEXT("left_arm"))) return EBodyPart::LeftArm;
+	else if (Name.Equals(TEXT("right_leg"))) return EBodyPart::RightLeg;
+	else if (Name.Equals(TEXT("left_leg"))) return EBodyPart::LeftLeg;
+	return EBodyPart::None;
+}
+
+EBodyPart AFightingCharacter::GetDamageCategory(EBodyPart BodyPart)
+{
+	return BodyPart == EBodyPart::Chest ? EBodyPart::Torso : BodyPart;
 }
 
 float AFightingCharacter::GetWeaponVelocity(UPrimitiveComponent* WeaponComponent) {
 
-	float velocity = 0.0;
+	ELimb limb = ELimb::None;
 
-	if (WeaponComponent == LeftFistCollisionBox) velocity = LeftFistVelocity;
-	else if(WeaponComponent == RightFistCollisionBox) velocity = RightFistVelocity;
-	else if (WeaponComponent == LeftFootCollisionBox || WeaponComponent == LeftLegCollisionBox) velocity = LeftFootVelocity;
-	else if (WeaponComponent == RightFootCollisionBox || WeaponComponent == RightLegCollisionBox) velocity = RightFootVelocity;
+	if (WeaponComponent == LeftFistCollisionBox) limb = ELimb::LeftFist;
+	else if(WeaponComponent == RightFistCollisionBox) limb = ELimb::RightFist;
+	else if (WeaponComponent == LeftFootCollisionBox || WeaponComponent == LeftLegCollisionBox) limb = ELimb::LeftFoot;
+	else if (WeaponComponent == RightFootCollisionBox || WeaponComponent == RightLegCollisionBox) limb = ELimb::RightFoot;
 
-	return velocity;
+	if (limb == ELimb::None) return 0.0;
+	return LimbVelocity[(int32)limb].GetVelocity(GetWorld()->GetTimeSeconds());
 }
 
 
@@ -443,18 +863,22 @@ void AFightingCharacter::PunchAttackStart()
 
 	LeftFistCollisionBox->SetCollisionProfileName("Weapon");
 	LeftFistCollisionBox->SetNotifyRigidBodyCollision(true);
-	LeftFistCollisionBox->SetGenerateOverlapEvents(true);
+	LeftFistCollisionBox->SetGenerateOverlapEvents(HitDetection == NULL);
 
 	RightFistCollisionBox->SetCollisionProfileName("Weapon");
 	RightFistCollisionBox->SetNotifyRigidBodyCollision(true);
-	RightFistCollisionBox->SetGenerateOverlapEvents(true);
+	RightFistCollisionBox->SetGenerateOverlapEvents(HitDetection == NULL);
+
+	if (HitDetection != NULL) HitDetection->SetWeaponBoxesActive(this, FistsWeaponMask, true);
 
 	bTrackFistsVelocity = true;
-	LeftFistLastPos = LeftFistCollisionBox->GetComponentLocation();
-	RightFistLastPos = RightFistCollisionBox->GetComponentLocation();
+	if (bGateDamageBoxes) ActivateDamageBoxesInReach();
+	float current_time = GetWorld()->GetTimeSeconds();
+	LimbVelocity[(int32)ELimb::LeftFist].Reset(current_time, GetLimbLocation(ELimb::LeftFist));
+	LimbVelocity[(int32)ELimb::RightFist].Reset(current_time, GetLimbLocation(ELimb::RightFist));
 
-	RightFistVelocity_max = LeftFistVelocity_max = 0;
 	LastAttackImpactVel = LastAttackPoints = 0.0f;
+	if (!IsResimulating()) OnAttackStatsChanged.Broadcast();
 }
 
 void AFightingCharacter::PunchAttackEnd()
@@ -467,10 +891,12 @@ void AFightingCharacter::PunchAttackEnd()
 	RightFistCollisionBox->SetNotifyRigidBodyCollision(false);
 	RightFistCollisionBox->SetGenerateOverlapEvents(false);
 
+	if (HitDetection != NULL) HitDetection->SetWeaponBoxesActive(this, FistsWeaponMask, false);
+
 	bTrackFistsVelocity = false;
 
-	//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Cyan, FString::Printf(TEXT("RightFistVelocity_max: %f"), RightFistVelocity_max));
-	//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Yellow, FString::Printf(TEXT("LeftFistVelocity_max: %f"), LeftFistVelocity_max));
+	//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Cyan, FString::Printf(TEXT("RightFistVelocity_max: %f"), LimbVelocity[(int32)ELimb::RightFist].GetPeakVelocity()));
+	//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Yellow, FString::Printf(TEXT("LeftFistVelocity_max: %f"), LimbVelocity[(int32)ELimb::LeftFist].GetPeakVelocity()));
 }
 
 void AFightingCharacter::KickAttackStart()
@@ -479,21 +905,25 @@ void AFightingCharacter::KickAttackStart()
 
 	LeftFootCollisionBox->SetCollisionProfileName("Weapon");
 	LeftFootCollisionBox->SetNotifyRigidBodyCollision(true);
-	LeftFootCollisionBox->SetGenerateOverlapEvents(true);
+	LeftFootCollisionBox->SetGenerateOverlapEvents(HitDetection == NULL);
 
 	RightFootCollisionBox->SetCollisionProfileName("Weapon");
 	RightFootCollisionBox->SetNotifyRigidBodyCollision(true);
-	RightFootCollisionBox->SetGenerateOverlapEvents(true);
+	RightFootCollisionBox->SetGenerateOverlapEvents(HitDetection == NULL);
 
 	LeftLegCollisionBox->SetCollisionProfileName("Weapon");
 	RightLegCollisionBox->SetCollisionProfileName("Weapon");
 
+	if (HitDetection != NULL) HitDetection->SetWeaponBoxesActive(this, FeetWeaponMask, true);
+
 	bTrackFeetVelocity = true;
-	LeftFootLastPos = LeftFootCollisionBox->GetComponentLocation();
-	RightFootLastPos = RightFootCollisionBox->GetComponentLocation();
+	if (bGateDamageBoxes) ActivateDamageBoxesInReach();
+	float current_time = GetWorld()->GetTimeSeconds();
+	LimbVelocity[(int32)ELimb::LeftFoot].Reset(current_time, GetLimbLocation(ELimb::LeftFoot));
+	LimbVelocity[(int32)ELimb::RightFoot].Reset(current_time, GetLimbLocation(ELimb::RightFoot));
 
-	RightFootVelocity_max = LeftFootVelocity_max = 0;
 	LastAttackImpactVel = LastAttackPoints = 0.0f;
+	if (!IsResimulating()) OnAttackStatsChanged.Broadcast();
 }
 
 void AFightingCharacter::KickAttackEnd()
@@ -508,20 +938,27 @@ void AFightingCharacter::KickAttackEnd()
 
 	LeftLegCollisionBox->SetCollisionProfileName("DamageBox");
 	RightLegCollisionBox->SetCollisionProfileName("DamageBox");
+	if (!bDamageBoxesActive) {
+		LeftLegCollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		RightLegCollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+
+	if (HitDetection != NULL) HitDetection->SetWeaponBoxesActive(this, FeetWeaponMask, false);
 
 	bTrackFeetVelocity = false;
 
-	//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Green, FString::Printf(TEXT("RightFootVelocity_max: %f"), RightFootVelocity_max));
-	//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Orange, FString::Printf(TEXT("LeftFootVelocity_max: %f"), LeftFootVelocity_max));
+	//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Green, FString::Printf(TEXT("RightFootVelocity_max: %f"), LimbVelocity[(int32)ELimb::RightFoot].GetPeakVelocity()));
+	//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Orange, FString::Printf(TEXT("LeftFootVelocity_max: %f"), LimbVelocity[(int32)ELimb::LeftFoot].GetPeakVelocity()));
 }
 
-void AFightingCharacter::ReactionStart(AActor* attacker, UPrimitiveComponent* CollisionBox, float ImpactVel, FVector ImpactPoint, FString AttackName) 
+void AFightingCharacter::ReactionStart(AFightingCharacter* attacker, UPrimitiveComponent* CollisionBox, float ImpactVel, FVector ImpactPoint, int32 AttackId)
 {
+	FIGHTING_SCOPE_CYCLE_COUNTER(ReactionStart);
+
 	Foot_R_Location = GetMesh()->GetSocketLocation("foot_r");
 	Foot_L_Location = GetMesh()->GetSocketLocation("foot_l");
 
-	FString CollisionBoxName = CollisionBox->GetName();
-	FString hitArea = DamageCBCategory[CollisionBoxName];
+	EBodyPart hitArea = GetBodyPart(CollisionBox);
 
 	// Check if attacker is behind the character
 	FVector actorToAttacker = attacker->GetActorLocation() - GetActorLocation();
@@ -529,75 +966,25 @@ void AFightingCharacter::ReactionStart(AActor* attacker, UPrimitiveComponent* Co
 	bool isAttackerBehindActor = cos < -0.35;
 	bool isAttackerInFrontOfActor = cos > 0.35;
 
-	float current_time = GetWorld()->GetTimeSeconds();
+	int32 current_frame = GetCombatFrame();
 	
-	if (hitArea.Equals(TEXT("head"))) {
+	if (hitArea == EBodyPart::Head || hitArea == EBodyPart::Chest) {
 		//if (IsBlocking && isAttackerInFrontOfActor) return;
 		
 		// If the character is blocking and the arms have ovelapped in the last second, then don't react.
-		if (IsBlocking && current_time - LastArmsOverlapTime < 1.0) return;
-		else if (IsBlocking) StopBlocking();
-		if (isAttackerBehindActor) Reaction = ReactType::Back; 
-		else if (AttackName.Equals(TEXT("Attack_Duck_Punch")) || AttackName.Equals(TEXT("Attack_Punch_L_quick")) 
-			|| AttackName.Equals(TEXT("Attack_Punch_Combo"))) {
-			Reaction = ReactType::Face_FS;
-		}
-		else if ( AttackName.Equals(TEXT("Attack_Punch_R_quick"))) {
-			Reaction = ReactType::Face_FM;
-		}
-		else if (AttackName.Equals(TEXT("Attack_Kick_scissors")) || AttackName.Equals(TEXT("Attack_Punch_L_uppercut")) || AttackName.Equals(TEXT("Attack_Punch_R_uppercut"))) {
-			Reaction = ReactType::Face_FB;
-		}
-		else if (AttackName.Equals(TEXT("Attack_Kick_backwards_round"))) {
-			Reaction = ReactType::Face_RB;
-		}
-		else if (AttackName.Equals(TEXT("Attack_Kick_R_high")) || AttackName.Equals(TEXT("Attack_Kick_R_roundhouse"))) {
-			Reaction = ReactType::Face_LM;
-		}
-		else if (AttackName.Equals(TEXT("Attack_Kick_R_high_round")) || AttackName.Equals(TEXT("Attack_Punch_R_swing"))) {
-			Reaction = ReactType::Face_LB;
-		}
+		if (IsBlocking && current_frame - LastArmsOverlapFrame < BlockWindowFrames) return;
+		else if (IsBlocking) EndBlocking();
 	}
-	else if (hitArea.Equals(TEXT("torso"))) {
-		if (IsBlocking) StopBlocking();
-		if (isAttackerBehindActor) Reaction = ReactType::Back;
-		else if (AttackName.Equals(TEXT("Attack_Kick_R_front")) || AttackName.Equals(TEXT("Attack_Kick_L_front"))) {
-			Reaction = ReactType::Torso_FS;
-		}
-		else if (AttackName.Equals(TEXT("Attack_Kick_R_torso"))) {
-			Reaction = ReactType::Torso_FM;
-		}
-		else if (AttackName.Equals(TEXT("Attack_Punch_L_uppercut")) || AttackName.Equals(TEXT("Attack_Punch_R_uppercut"))) {
-			Reaction = ReactType::Torso_FB;
-		}
-		else if (AttackName.Equals(TEXT("Attack_Punch_R_hook"))) {
-			Reaction = ReactType::Torso_LS;
-		}
-		else if (AttackName.Equals(TEXT("Attack_Kick_air")) //|| AttackName.Equals(TEXT("Attack_Kick_R_roundhouse")) || AttackName.Equals(TEXT("Attack_Kick_scissors"))
-			|| AttackName.Equals(TEXT("Attack_Kick_L_roundhouse")) || AttackName.Equals(TEXT("Attack_Kick_R_high"))
-			|| AttackName.Equals(TEXT("Attack_Punch_R_hook_momentum")) || AttackName.Equals(TEXT("Attack_Kick_R_mocap"))) {
-			Reaction = ReactType::Torso_LM;
-		}
-		else if (AttackName.Equals(TEXT("Attack_Punch_L_hook"))) {
-			Reaction = ReactType::Torso_RM;
-		}
-
+	else if (hitArea == EBodyPart::Torso) {
+		if (IsBlocking) EndBlocking();
 	}
-	else if (hitArea.Equals(TEXT("chest"))) {
-		//if (IsBlocking && isAttackerInFrontOfActor) return;
+	else return; // Arms and legs don't react
 
-		// If the character is blocking and the arms have ovelapped in the last second, then don't react.
-		if (IsBlocking && current_time - LastArmsOverlapTime < 1.0) return;
-		else if (IsBlocking) StopBlocking();
-		if (isAttackerBehindActor) Reaction = ReactType::Back;
-		else if (AttackName.Equals(TEXT("Attack_Kick_air")) || AttackName.Equals(TEXT("Attack_Punch_Combo")) 
-			|| AttackName.Equals(TEXT("Attack_Punch_R_hook")) || AttackName.Equals(TEXT("Attack_Punch_R_hook_momentum"))
-			|| AttackName.Equals(TEXT("Attack_Kick_L_roundhouse")) || AttackName.Equals(TEXT("Attack_Kick_R_mocap"))) {
-			Reaction = ReactType::Torso_LM;
-		}
-		else if (AttackName.Equals(TEXT("Attack_Punch_L_hook"))) {
-			Reaction = ReactType::Torso_RM;
-		}
+	if (isAttackerBehindActor) Reaction = ReactType::Back;
+	else {
+		// Reaction to this attack on this hit area, as defined in the attacker's AttackCatalog
+		ReactType attackReaction = attacker->AttackCatalog->GetReaction(AttackId, hitArea);
+		if (attackReaction != ReactType::NoReact) Reaction = attackReaction;
 	}
 
 	// If a reaction was set then set other actions as not being able to be performed
@@ -620,33 +1007,32 @@ void AFightingCharacter::ReactionEnd() {
 	CanBlock = true;
 	CanAttack = true;
 	CanAddNextComboAttack = true;
-	if (IsBlocking) StopBlocking();
+	if (IsBlocking) EndBlocking();
 }
 
-void AFightingCharacter::InflictDamage(UPrimitiveComponent* CollisionBox, float ImpactVel)
+float AFightingCharacter::InflictDamage(UPrimitiveComponent* CollisionBox, float ImpactVel, AFightingCharacter* Attacker)
 {
-	FString hit_area = DamageCBCategory[CollisionBox->GetName()];
-	if (hit_area.IsEmpty()) return;
+	FIGHTING_SCOPE_CYCLE_COUNTER(InflictDamage);
+
+	EBodyPart hit_area = GetBodyPart(CollisionBox);
+	if (hit_area == EBodyPart::None) return 0.0f;
+
+	int32 current_frame = GetCombatFrame();
 
 	// If the character is blocking and the the hit arae is head or chest
 	// and the arms have ovelapped in the last second, then don't infliect damage.
-	if (IsBlocking && (hit_area.Equals(TEXT("chest")) || hit_area.Equals(TEXT("head")))) {
-		float current_time = GetWorld()->GetTimeSeconds();
-		if (current_time - LastArmsOverlapTime < 1.0) return;
+	if (IsBlocking && (hit_area == EBodyPart::Chest || hit_area == EBodyPart::Head)) {
+		if (current_frame - LastArmsOverlapFrame < BlockWindowFrames) return 0.0f;
 	}
 
-	if (hit_area.Equals(TEXT("chest"))) hit_area = TEXT("torso");
-
-	float current_time = GetWorld()->GetTimeSeconds();
+	// Chest shares the Torso entry of the body part table
+	int32 part = (int32)GetDamageCategory(hit_area);
 
 	// Only inflict damage if it's been more than 0.5 seconds since the last time this hit area has damage received
-	if (current_time - LastDamageTakenTime[hit_area] > 0.5) {
-		//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Magenta, FString::Printf(TEXT("Hit Area: %s (%s)"), *hit_area, *CollisionBox->GetName()));
-		//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Cyan, FString::Printf(TEXT("ImpactVel: %f "), ImpactVel)); 
-		
+	if (current_frame - LastDamageTakenFrame[part] > DamageCooldownFrames) {
 		// Calculatinf damage taken based on ImpactVel and DamagePotential of the hit area
-		float base_damage = BaseDamage[hit_area];
-		float damage_multiplier = DamagePotential[hit_area];
+		float base_damage = BaseDamage[part];
+		float damage_multiplier = DamagePotential[part];
 		float damage_taken = base_damage * damage_multiplier * ImpactVel/800;
 		HealthPoints -= damage_taken;
 		if (HealthPoints < 0) { 
@@ -656,23 +1042,24 @@ void AFightingCharacter::InflictDamage(UPrimitiveComponent* CollisionBox, float
 
 		// Increasing DamagePotential of the hit area, based on ImpactVel (min cap of PotentialIncrement)
 		if(PotentialIncrement * ImpactVel / 600 > PotentialIncrement)
-			DamagePotential[hit_area] += PotentialIncrement * ImpactVel / 600;
-		else DamagePotential[hit_area] += PotentialIncrement;
-		if (DamagePotential[hit_area] > 3) DamagePotential[hit_area] = 3;
-		LastDamageTakenTime[hit_area] = current_time;
-
-		//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Yellow, FString::Printf(TEXT("damage taken: %d, DamagePotential: %f, HP: %d "), (int)(damage_taken * 1000), DamagePotential[hit_area], (int)(HealthPoints * 1000)));
-	
-		if (hit_area.Equals(TEXT("torso"))) HitTorso = true;
-		else if (hit_area.Equals(TEXT("head"))) HitHead = true;
-		else if (hit_area.Equals(TEXT("left_arm"))) HitArmL = true;
-		else if (hit_area.Equals(TEXT("right_arm"))) HitArmR = true;
-		else if (hit_area.Equals(TEXT("left_leg"))) HitLegL = true;
-		else if (hit_area.Equals(TEXT("right_Leg"))) HitLegR = true;
+			DamagePotential[part] += PotentialIncrement * ImpactVel / 600;
+		else DamagePotential[part] += PotentialIncrement;
+		if (DamagePotential[part] > 3) DamagePotential[part] = 3;
+		LastDamageTakenFrame[part] = current_frame;
+
+		*HitFlags[part] = true;
+
+		// In the arena the target enemy is only the closest fighter, not necessarily the one that landed the hit
+		if (Attacker != NULL) {
+			Attacker->LastAttackPoints += (int)(damage_taken * 1000);
+			if (ImpactVel > Attacker->LastAttackImpactVel) Attacker->LastAttackImpactVel = ImpactVel;
+			if (!IsResimulating()) Attacker->OnAttackStatsChanged.Broadcast();
+		}
 
-		TargetEnemy->LastAttackPoints += (int)(damage_taken * 1000);
-		if (ImpactVel > TargetEnemy->LastAttackImpactVel) TargetEnemy->LastAttackImpactVel = ImpactVel;
+		if (!IsResimulating()) OnFighterDamaged.Broadcast(hit_area, damage_taken, HealthPoints, ImpactVel);
+		return damage_taken;
 	}
+	return 0.0f;
 }
 
 void AFightingCharacter::OnAttackHit(UPrimitiveComponent * HitComponent, AActor * OtherActor, UPrimitiveComponent * OtherComp, FVector NormalImpulse, const FHitResult & Hit)
@@ -682,59 +1069,146 @@ void AFightingCharacter::OnAttackHit(UPrimitiveComponent * HitComponent, AActor
 
 void AFightingCharacter::OnAttackOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult & SweepResult)
 {
+	FIGHTING_SCOPE_CYCLE_COUNTER(AttackOverlapBegin);
+	FIGHTING_INC_COUNTER(FightingOverlaps);
+
 	if (OtherActor != this && OtherActor != NULL) {
 		if (AFightingCharacter* enemy = Cast<AFightingCharacter>(OtherActor)) {
-			FString hitArea = DamageCBCategory[OtherComp->GetName()];
-
-			// SweepResult is unpopulated for OnOverlapBegin - a bug from Unreal. Solution to get the HitResult:
-		    // https://answers.unrealengine.com/questions/165523/on-component-begin-overlap-sweep-result-not-popula.html
-
-			TArray<FHitResult> AllResults;
-			FHitResult Hit;
-
-			// Get the location of this actor's overlapped component
-			auto Start = OverlappedComponent->GetComponentLocation();
-			// Get the location of the other component
-			auto End = OtherComp->GetComponentLocation();
-			// Use a slightly larger radius to ensure we find the same result
-			auto CollisionRadius = FVector::Dist(Start, End) * 1.1f;
-
-			// Now do a spherical sweep to find the overlap
-			GetWorld()->SweepMultiByObjectType(AllResults, Start, End, FQuat::Identity, 0, FCollisionShape::MakeSphere(CollisionRadius),
-				FCollisionQueryParams::FCollisionQueryParams(false) );
-
-			// Finally check which hit result is the one from this event
-			for (auto HitResult : AllResults)
-			{
-				if (OtherComp->GetUniqueID() == HitResult.GetComponent()->GetUniqueID()) {
-					// A component with the same UniqueID means we found our overlap!
-					Hit = HitResult;
-					break;
-				}
+			// SweepResult is unpopulated for OnOverlapBegin, so the impact point is computed from the two collision boxes.
+			// Weapon and Damage collision boxes are both boxes, so no scene query is needed
+			FVector impactPoint = OtherComp->GetComponentLocation();
+			UBoxComponent* weaponBox = Cast<UBoxComponent>(OverlappedComponent);
+			UBoxComponent* damageBox = Cast<UBoxComponent>(OtherComp);
+			if (weaponBox != NULL && damageBox != NULL) {
+				FOrientedBox weapon = FOrientedBox::FromBoxComponent(weaponBox);
+				FOrientedBox damage = FOrientedBox::FromBoxComponent(damageBox);
+				FBoxContact contact;
+				// Overlap events are generated with a small tolerance, so boxes just touching may not intersect
+				if (ComputeBoxContact(weapon, damage, contact)) impactPoint = contact.ImpactPoint;
+				else impactPoint = damage.GetClosestPoint(weapon.Center);
 			}
-			/************************************/
 
 			//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Blue, FString::Printf(TEXT("%s is overlapping"), *OtherComp->GetName()));
-			enemy->IsDamageBoxOverlapping[OtherComp->GetName()] = true;
+			int32 damageBoxIndex = enemy->GetDamageBoxIndex(OtherComp);
+			if (damageBoxIndex != INDEX_NONE) enemy->IsDamageBoxOverlapping[damageBoxIndex] = true;
 
-			// Inflict damage on enemy and start reaction for enemy
-			enemy->InflictDamage(OtherComp, GetWeaponVelocity(OverlappedComponent));
-			if(GetCurrentMontage() != NULL) enemy->ReactionStart(this, OtherComp, GetWeaponVelocity(OverlappedComponent), Hit.ImpactPoint, GetCurrentMontage()->GetName());
+			RegisterAttackHit(OverlappedComponent, enemy, OtherComp, impactPoint);
 		}
 	}
 }
 
+void AFightingCharacter::RegisterAttackHit(UPrimitiveComponent* WeaponComponent, AFightingCharacter* enemy, UPrimitiveComponent* DamageBox, const FVector& ImpactPoint)
+{
+	FIGHTING_INC_COUNTER(FightingHits);
+
+	// Inflict damage on enemy and start reaction for enemy
+	float impactVel = GetWeaponVelocity(WeaponComponent);
+	float damage = enemy->InflictDamage(DamageBox, impactVel, this);
+	UAnimMontage* attackMontage = GetCurrentMontage();
+	int32 attackId = attackMontage != NULL ? AttackCatalog->FindAttackId(attackMontage) : INDEX_NONE;
+	if (attackMontage != NULL) enemy->ReactionStart(this, DamageBox, impactVel, ImpactPoint, attackId);
+
+	// Hits of resimulated frames were recorded when the frames were first simulated
+	if (HitTelemetry != NULL && !IsResimulating()) {
+		EBodyPart hitArea = enemy->GetBodyPart(DamageBox);
+
+		FHitTelemetryRecord record;
+		record.Frame = GetCombatFrame();
+		record.AttackerId = GetUniqueID();
+		record.VictimId = enemy->GetUniqueID();
+		record.AttackId = (int16)attackId;
+		record.BodyPart = (uint8)hitArea;
+		record.Flags = (uint8)((damage <= 0.0f ? FHitTelemetryRecord::NoDamage : 0) | (damage > 0.0f && enemy->bDefeated ? FHitTelemetryRecord::Defeated : 0));
+		record.ImpactVel = impactVel;
+		record.Damage = damage;
+		record.PotentialAfter = hitArea != EBodyPart::None ? enemy->DamagePotential[(int32)GetDamageCategory(hitArea)] : 0.0f;
+		record.HealthAfter = enemy->HealthPoints;
+		HitTelemetry->RecordHit(record);
+	}
+}
+
+void AFightingCharacter::SweepWeaponCollisionBoxes()
+{
+	FIGHTING_SCOPE_CYCLE_COUNTER(WeaponSweep);
+
+	static const FName WeaponProfile("Weapon");
+
+	// Transforms of the last sweep are only valid if they were recorded in this combat frame or in the steps of the last engine frame
+	const int32 frame = GetCombatFrame();
+	bool bHasLastTransforms = LastWeaponSweepFrame != INDEX_NONE && frame >= LastWeaponSweepFrame
+		&& frame - LastWeaponSweepFrame <= UCombatClock::MaxStepsPerFrame;
+	LastWeaponSweepFrame = frame;
+
+	// Fighters whose gated damage boxes are inactive are out of reach, and their boxes are not up to date
+	TArray<AFightingCharacter*, TInlineAllocator<8>> enemies;
+	GetHittableFighters(enemies);
+	enemies.RemoveAll([](AFightingCharacter* enemy) { return !enemy->AreDamageBoxesActive(); });
+
+	for (int32 i = 0; i < (int32)WeaponCollisionBoxes.size(); i++) {
+		UBoxComponent* weaponBox = WeaponCollisionBoxes[i];
+		const FTransform transform = GetWeaponBoxTransform(i);
+		bool isActive = weaponBox->GetCollisionProfileName() == WeaponProfile;
+
+		if (isActive && WasWeaponBoxActive[i] && bHasLastTransforms && enemies.Num() > 0) {
+			const FVector extent = GetWeaponBoxExtent(i);
+			const FOrientedBox weapon(transform, extent);
+			const float weaponRadius = weapon.Extent.Size();
+
+			// The weapon hits the first damage box it passes through, whichever fighter it belongs to
+			FSweptBoxContact earliest;
+			AFightingCharacter* earliestEnemy = NULL;
+			int32 earliestIndex = INDEX_NONE;
+
+			for (AFightingCharacter* enemy : enemies) {
+				for (int32 j = 0; j < (int32)enemy->GetDamageCollisionBoxes().size(); j++) {
+					// Already overlapping boxes got their hit from the overlap event, and legs that are kicking cannot be hit
+					if (enemy->IsDamageBoxOverlapping[j] || enemy->GetDamageCollisionBoxes()[j]->GetCollisionProfileName() == WeaponProfile) continue;
+
+					FOrientedBox damage = enemy->GetDamageOrientedBox(j);
+
+					// Bounding spheres: the damage box must be close to the segment travelled by the weapon box
+					float reach = weaponRadius + damage.Extent.Size();
+					if (FMath::PointDistToSegmentSquared(damage.Center, LastWeaponTransforms[i].GetLocation(), weapon.Center) > reach * reach) continue;
+
+					// Boxes overlapping at the end of the frame generate an overlap event
+					FBoxContact contact;
+					if (ComputeBoxContact(weapon, damage, contact)) continue;
+
+					FSweptBoxContact swept;
+					if (SweepBoxContact(LastWeaponTransforms[i], transform, extent, damage, swept)) {
+						if (earliestIndex == INDEX_NONE || swept.Time < earliest.Time) {
+							earliest = swept;
+							earliestEnemy = enemy;
+							earliestIndex = j;
+						}
+					}
+				}
+			}
+
+			if (earliestIndex != INDEX_NONE) {
+				//GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Blue, FString::Printf(TEXT("%s swept through %s at %f"), *weaponBox->GetName(), *earliestEnemy->GetDamageCollisionBoxes()[earliestIndex]->GetName(), earliest.Time));
+				RegisterAttackHit(weaponBox, earliestEnemy, earliestEnemy->GetDamageCollisionBoxes()[earliestIndex], earliest.Contact.ImpactPoint);
+			}
+		}
+
+		LastWeaponTransforms[i] = transform;
+		WasWeaponBoxActive[i] = isActive;
+	}
+}
+
 
 void AFightingCharacter::OnAttackOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
 	if (OtherActor != this && OtherActor != NULL) {
 		if (AFightingCharacter* enemy = Cast<AFightingCharacter>(OtherActor)) {
-			enemy->IsDamageBoxOverlapping[OtherComp->GetName()] = false;
+			int32 damageBoxIndex = enemy->GetDamageBoxIndex(OtherComp);
+			if (damageBoxIndex != INDEX_NONE) enemy->IsDamageBoxOverlapping[damageBoxIndex] = false;
 		}
 	}
 }
 
 void AFightingCharacter::RotateToTarget(float DeltaTime) {
+	FIGHTING_SCOPE_CYCLE_COUNTER(RotateToTarget);
 
 	float speed = GetVelocity().Size();
 	if (TargetEnemy != NULL && speed != 0) {
@@ -819,7 +1293,8 @@ FVector AFightingCharacter::GetFootLLocation() {
 
 void AFightingCharacter::ClearComboSequence()
 {
-	ComboSequenceStr = TEXT("");
+	ComboState = FComboGraph::RootState;
+	ComboSequenceStr.Reset();
 	CanAddNextComboAttack = true;
 	CanMove = true;
 	CanBlock = true;
@@ -830,9 +1305,94 @@ void AFightingCharacter::ClearComboSequence()
 }
 
 
+void AFightingCharacter::UpdateDamageBoxGating()
+{
+	if (IsAttackWindowOpen()) ActivateDamageBoxesInReach();
+
+	// Attackers may tick before or after this character, so the boxes stay active until the end of the combat frame after the last request.
+	// Rollbacks and replay seeks resimulate several combat frames in one engine frame, so engine frames cannot be used
+	if (bDamageBoxesActive && DamageBoxesRequestFrame + 1 < GetCombatFrame()) SetDamageBoxesActive(false);
+}
+
+void AFightingCharacter::ActivateDamageBoxesInReach()
+{
+	const FVector location = GetActorLocation();
+	const float radius = GetCapsuleComponent()->GetScaledCapsuleRadius();
+
+	TArray<AFightingCharacter*, TInlineAllocator<8>> fighters;
+	GetHittableFighters(fighters);
+
+	// Fighters stand on the same ground, so the distance between the capsules is measured on the ground plane
+	for (AFightingCharacter* fighter : fighters) {
+		float reach = DamageBoxReachRadius + radius + fighter->GetCapsuleComponent()->GetScaledCapsuleRadius();
+		if (FVector::DistSquared2D(location, fighter->GetActorLocation()) <= reach * reach) fighter->RequestDamageBoxes();
+	}
+}
+
+void AFightingCharacter::GetHittableFighters(TArray<AFightingCharacter*, TInlineAllocator<8>>& OutFighters) const
+{
+	OutFighters.Reset();
+
+	auto addFighter = [&](AFightingCharacter* fighter) {
+		if (fighter != NULL && fighter != this && !fighter->IsPendingKill()) OutFighters.Add(fighter);
+	};
+
+	// In the arena any fighter can be hit, otherwise only the target enemy
+	AMyGameMode* gameMode = Cast<AMyGameMode>(GetWorld()->GetAuthGameMode());
+	if (gameMode != NULL && gameMode->bArenaMode) {
+		for (AFightingCharacter* fighter : gameMode->Fighters) addFighter(fighter);
+	}
+	else addFighter(TargetEnemy);
+}
+
+void AFightingCharacter::RequestDamageBoxes()
+{
+	if (!bGateDamageBoxes) return;
+
+	DamageBoxesRequestFrame = GetCombatFrame();
+	if (!bDamageBoxesActive) SetDamageBoxesActive(true);
+}
+
+void AFightingCharacter::SetDamageBoxesActive(bool bActive)
+{
+	static const FName WeaponProfile("Weapon");
+	static const FName DamageBoxProfile("DamageBox");
+
+	bDamageBoxesActive = bActive;
+
+	// The box components are unregistered: the hitboxes stop following the mesh instead, except the ones that are also weapons
+	if (bUseHitboxes) {
+		for (int32 i = 0; i < NumDamageBoxes; i++) {
+			bool isWeapon = false;
+			for (int32 j = 0; j < NumWeaponBoxes; j++) isWeapon |= WeaponHitbox[j] == DamageHitbox[i];
+			if (!isWeapon) Hitboxes->SetBoxActive(DamageHitbox[i], bActive);
+			if (!bActive) IsDamageBoxOverlapping[i] = false;
+		}
+
+		// The boxes may be tested for hits before the hitboxes tick again
+		if (bActive) Hitboxes->UpdateBoxes();
+		return;
+	}
+
+	for (int32 i = 0; i < (int32)DamageCollisionBoxes.size(); i++) {
+		UBoxComponent* damageBox = DamageCollisionBoxes[i];
+		if (damageBox->GetCollisionProfileName() == WeaponProfile) continue;
+
+		if (bActive) damageBox->SetCollisionProfileName(DamageBoxProfile);
+		else {
+			damageBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			IsDamageBoxOverlapping[i] = false;
+		}
+	}
+}
+
 void AFightingCharacter::CollisionBoxesInit() 
 {
 	CollisionBoxes = CreateDefaultSubobject<USceneComponent>(TEXT("CollisionBoxes"));
+
+	Hitboxes = CreateDefaultSubobject<UHitboxComponent>(TEXT("Hitboxes"));
+	Hitboxes->SetupAttachment(GetMesh());
+	Hitboxes->SetHiddenInGame(false);
 	
 		
 	/** Weapon Collision Boxes**/
@@ -852,54 +1412,42 @@ void AFightingCharacter::CollisionBoxesInit()
 	/** Damage Collision Boxes**/
 
 	HeadCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("HeadCollisionBox"));
-	DamageCollisionBoxes.push_back(HeadCollisionBox);
-	DamageCBCategory[HeadCollisionBox->GetName()] = "head";
+	AddDamageCollisionBox(HeadCollisionBox, EBodyPart::Head);
 
 	ChestCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("ChestCollisionBox"));
-	DamageCollisionBoxes.push_back(ChestCollisionBox);
-	DamageCBCategory[ChestCollisionBox->GetName()] = "chest";
+	AddDamageCollisionBox(ChestCollisionBox, EBodyPart::Chest);
 
 	TorsoCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("TorsoCollisionBox"));
-	DamageCollisionBoxes.push_back(TorsoCollisionBox);
-	DamageCBCategory[TorsoCollisionBox->GetName()] = "torso";
+	AddDamageCollisionBox(TorsoCollisionBox, EBodyPart::Torso);
 
 	HipsCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("HipsCollisionBox"));
-	DamageCollisionBoxes.push_back(HipsCollisionBox);
-	DamageCBCategory[HipsCollisionBox->GetName()] = "torso";
+	AddDamageCollisionBox(HipsCollisionBox, EBodyPart::Torso);
 
 	RightArmCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("RightArmCollisionBox"));
-	DamageCollisionBoxes.push_back(RightArmCollisionBox);
-	DamageCBCategory[RightArmCollisionBox->GetName()] = "right_arm";
+	AddDamageCollisionBox(RightArmCollisionBox, EBodyPart::RightArm);
 
 	RightForearmCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("RightForearmCollisionBox"));
-	DamageCollisionBoxes.push_back(RightForearmCollisionBox);
-	DamageCBCategory[RightForearmCollisionBox->GetName()] = "right_arm";
+	AddDamageCollisionBox(RightForearmCollisionBox, EBodyPart::RightArm);
 
 	LeftArmCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("LeftArmCollisionBox"));
-	DamageCollisionBoxes.push_back(LeftArmCollisionBox);
-	DamageCBCategory[LeftArmCollisionBox->GetName()] = "left_arm";
+	AddDamageCollisionBox(LeftArmCollisionBox, EBodyPart::LeftArm);
 
 	LeftForearmCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("LeftForearmCollisionBox"));
-	DamageCollisionBoxes.push_back(LeftForearmCollisionBox);
-	DamageCBCategory[LeftForearmCollisionBox->GetName()] = "left_arm";
+	AddDamageCollisionBox(LeftForearmCollisionBox, EBodyPart::LeftArm);
 
 	RightThighCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("RightThighCollisionBox"));
-	DamageCollisionBoxes.push_back(RightThighCollisionBox);
-	DamageCBCategory[RightThighCollisionBox->GetName()] = "right_leg";
+	AddDamageCollisionBox(RightThighCollisionBox, EBodyPart::RightLeg);
 
 	RightLegCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("RightLegCollisionBox"));
-	DamageCollisionBoxes.push_back(RightLegCollisionBox);
+	AddDamageCollisionBox(RightLegCollisionBox, EBodyPart::RightLeg);
 	WeaponCollisionBoxes.push_back(RightLegCollisionBox);
-	DamageCBCategory[RightLegCollisionBox->GetName()] = "right_leg";
 
 	LeftThighCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("LeftThighCollisionBox"));
-	DamageCollisionBoxes.push_back(LeftThighCollisionBox);
-	DamageCBCategory[LeftThighCollisionBox->GetName()] = "left_leg";
+	AddDamageCollisionBox(LeftThighCollisionBox, EBodyPart::LeftLeg);
 
 	LeftLegCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("LeftLegCollisionBox"));
-	DamageCollisionBoxes.push_back(LeftLegCollisionBox);
+	AddDamageCollisionBox(LeftLegCollisionBox, EBodyPart::LeftLeg);
 	WeaponCollisionBoxes.push_back(LeftLegCollisionBox);
-	DamageCBCategory[LeftLegCollisionBox->GetName()] = "left_leg";
 	
 
 	for (UBoxComponent* element : WeaponCollisionBoxes)
@@ -916,11 +1464,20 @@ void AFightingCharacter::CollisionBoxesInit()
 		element->SetCollisionProfileName("DamageBox");
 		element->SetNotifyRigidBodyCollision(true);
 		element->SetHiddenInGame(false);
-		IsDamageBoxOverlapping[element->GetName()] = false;
 	}
 
 }
 
+void AFightingCharacter::AddDamageCollisionBox(UBoxComponent* CollisionBox, EBodyPart BodyPart)
+{
+	check(DamageCollisionBoxes.size() < NumDamageBoxes);
+
+	int32 index = DamageCollisionBoxes.size();
+	DamageCollisionBoxes.push_back(CollisionBox);
+	DamageBoxBodyPart[index] = BodyPart;
+	IsDamageBoxOverlapping[index] = false;
+}
+
 void AFightingCharacter::AttachCollisionBoxesToSockets()
 {
 	// attach collision components to sockets based on transformations definitions
@@ -944,28 +1501,92 @@ void AFightingCharacter::AttachCollisionBoxesToSockets()
 	LeftLegCollisionBox->AttachToComponent(GetMesh(), AttachmentRules, "leg_l_collsion");
 }
 
+void AFightingCharacter::InitHitboxes()
+{
+	Hitboxes->ClearBoxes();
+
+	// Each box component becomes one box, at the socket it was attached to and with the world scale it kept
+	TMap<UBoxComponent*, int32> boxIndices;
+	auto addHitbox = [this, &boxIndices](UBoxComponent* box) {
+		if (int32* index = boxIndices.Find(box)) return *index;
+		int32 index = Hitboxes->AddBox(box->GetAttachSocketName(), box->GetUnscaledBoxExtent(), box->GetComponentScale());
+		boxIndices.Add(box, index);
+		return index;
+	};
+
+	for (int32 i = 0; i < (int32)WeaponCollisionBoxes.size(); i++) WeaponHitbox[i] = addHitbox(WeaponCollisionBoxes[i]);
+	for (int32 i = 0; i < (int32)DamageCollisionBoxes.size(); i++) DamageHitbox[i] = addHitbox(DamageCollisionBoxes[i]);
+
+	if (!Hitboxes->BindToMesh(GetMesh())) {
+		Hitboxes->BindToMesh(NULL);
+		Hitboxes->ClearBoxes();
+		return;
+	}
+
+	// The box components are no longer moved with the mesh, and have no physics body nor overlaps to update
+	for (TPair<UBoxComponent*, int32>& pair : boxIndices) {
+		pair.Key->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+		pair.Key->UnregisterComponent();
+	}
+	CollisionBoxes->UnregisterComponent();
+
+	bUseHitboxes = true;
+}
+
+FTransform AFightingCharacter::GetWeaponBoxTransform(int32 Index) const
+{
+	return bUseHitboxes ? Hitboxes->GetBoxTransform(WeaponHitbox[Index]) : WeaponCollisionBoxes[Index]->GetComponentTransform();
+}
+
+FVector AFightingCharacter::GetWeaponBoxExtent(int32 Index) const
+{
+	return bUseHitboxes ? Hitboxes->GetBoxExtent(WeaponHitbox[Index]) : WeaponCollisionBoxes[Index]->GetUnscaledBoxExtent();
+}
+
+FOrientedBox AFightingCharacter::GetWeaponOrientedBox(int32 Index) const
+{
+	return bUseHitboxes ? Hitboxes->GetOrientedBox(WeaponHitbox[Index]) : FOrientedBox::FromBoxComponent(WeaponCollisionBoxes[Index]);
+}
+
+FOrientedBox AFightingCharacter::GetDamageOrientedBox(int32 Index) const
+{
+	return bUseHitboxes ? Hitboxes->GetOrientedBox(DamageHitbox[Index]) : FOrientedBox::FromBoxComponent(DamageCollisionBoxes[Index]);
+}
+
+FVector AFightingCharacter::GetLimbLocation(ELimb Limb) const
+{
+	// The fists and feet are the first Weapon Collision Boxes, in the order of ELimb
+	return GetWeaponBoxTransform((int32)Limb).GetLocation();
+}
+
 void AFightingCharacter::VariablesInit()
 {
-	DamageCBCategories.push_back("head");
-	DamageCBCategories.push_back("torso");
-	DamageCBCategories.push_back("right_arm");
-	DamageCBCategories.push_back("left_arm");
-	DamageCBCategories.push_back("right_leg");
-	DamageCBCategories.push_back("left_leg");
-	
-	float current_time = GetWorld()->GetTimeSeconds();
+	int32 current_frame = GetCombatFrame();
 
-	for (FString cat : DamageCBCategories) {
-		DamagePotential[cat] = 1.0;
-		LastDamageTakenTime[cat] = current_time;
+	for (int32 part = 0; part < NumBodyParts; part++) {
+		DamagePotential[part] = 1.0;
+		LastDamageTakenFrame[part] = current_frame;
+		HitFlags[part] = NULL;
 	}
 
-	BaseDamage["head"] = 0.02;
-	BaseDamage["torso"] = 0.01;
-	BaseDamage["right_arm"] = 0.005;
-	BaseDamage["left_arm"] = 0.005;
-	BaseDamage["right_leg"] = 0.005;
-	BaseDamage["left_leg"] = 0.005;
+	BaseDamage[(int32)EBodyPart::Head] = 0.02;
+	BaseDamage[(int32)EBodyPart::Torso] = 0.01;
+	BaseDamage[(int32)EBodyPart::RightArm] = 0.005;
+	BaseDamage[(int32)EBodyPart::LeftArm] = 0.005;
+	BaseDamage[(int32)EBodyPart::RightLeg] = 0.005;
+	BaseDamage[(int32)EBodyPart::LeftLeg] = 0.005;
+
+	for (int32 i = 0; i < NumWeaponBoxes; i++) WasWeaponBoxActive[i] = false;
+	LastArmsOverlapFrame = current_frame - BlockWindowFrames;
+	LastBufferedAttackFrame = current_frame - BufferedAttackPressFrames;
+	ComboRandom.GenerateNewSeed();
+
+	HitFlags[(int32)EBodyPart::Head] = &HitHead;
+	HitFlags[(int32)EBodyPart::Torso] = &HitTorso;
+	HitFlags[(int32)EBodyPart::RightArm] = &HitArmR;
+	HitFlags[(int32)EBodyPart::LeftArm] = &HitArmL;
+	HitFlags[(int32)EBodyPart::RightLeg] = &HitLegR;
+	HitFlags[(int32)EBodyPart::LeftLeg] = &HitLegL;
 }
 
 FVector AFightingCharacter::GetEnemyLocation() {
@@ -973,10 +1594,3 @@ FVector AFightingCharacter::GetEnemyLocation() {
 	if(TargetEnemy != NULL) target_location = TargetEnemy->GetActorLocation();
 	return target_location;
 }
-
-float get_random_float()
-{
-	static std::default_random_engine e;
-	static std::uniform_real_distribution<> dis(0, 1); // rage 0 - 1
-	return dis(e);
-}
@@ -14,6 +14,10 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "Blueprint/UserWidget.h"
 #include "Components/BoxComponent.h"
+#include "BoxContact.h"
+#include "ComboGraph.h"
+#include "LimbVelocitySampler.h"
+#include "ComboPredictor.h"
 
 #include <unordered_map>
 #include <vector>
@@ -21,6 +25,17 @@
 
 #include "FightingCharacter.generated.h"
 
+class UAttackCatalog;
+class UHitDetectionSubsystem;
+class UHitboxComponent;
+class UFighterTickManager;
+class UFighterAIScheduler;
+class UCombatClock;
+class UFightingInputBufferComponent;
+class UHitTelemetrySubsystem;
+struct FFighterState;
+struct FFighterInput;
+
 /**
  * ReactType is an Enum that enumerates different types of reactions.
  * Direction from which the blow is received: F - Front / L - Left / R - Right
@@ -34,6 +49,43 @@ enum ReactType
 	Torso_FS, Torso_FM, Torso_FB, Torso_LS, Torso_LM, Torso_LB, Torso_RS, Torso_RM, Torso_RB, Back
 };
 
+/**
+ * EBodyPart is an Enum that enumerates the generalised body parts a Damage Collision Box can belong to.
+ * Chest is kept apart from Torso because it reacts differently to attacks (it can be protected by blocking),
+ * but it shares the Torso entry of the body part table when damage is inflicted.
+ */
+UENUM(BlueprintType)
+enum class EBodyPart : uint8
+{
+	Head, Chest, Torso, RightArm, LeftArm, RightLeg, LeftLeg,
+	None UMETA(Hidden)
+};
+
+/** Number of entries of the body part tables (one for each EBodyPart, None excluded) */
+static const int32 NumBodyParts = (int32)EBodyPart::None;
+
+/**
+ * Broadcast when a FightingCharacter takes damage, so the UI only updates when a hit lands instead of polling the fighter every frame.
+ *
+ * @param BodyPart			body part that was hit, or EBodyPart::None if the health was restored by a rollback or a replay
+ * @param Damage			health points taken
+ * @param NewHealth			health points left
+ * @param ImpactVelocity	impact velocity of the hit
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FOnFighterDamaged, EBodyPart, BodyPart, float, Damage, float, NewHealth, float, ImpactVelocity);
+
+/**
+ * Broadcast when LastAttackImpactVel or LastAttackPoints of a FightingCharacter change: reset when an attack starts, raised
+ * when the attack lands, or restored by a rollback or a replay.
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnAttackStatsChanged);
+
+/** Number of Damage Collision Boxes of a FightingCharacter */
+static const int32 NumDamageBoxes = 12;
+
+/** Number of Weapon Collision Boxes of a FightingCharacter (fists, feet and legs) */
+static const int32 NumWeaponBoxes = 6;
+
 
 /**
  * FightingCharacters are Characters that are able to perform different fighting moves.
@@ -50,6 +102,9 @@ class PROJECTGAME_API AFightingCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	/** The tick manager reads and updates the movement and tracking state directly. @see UFighterTickManager */
+	friend class UFighterTickManager;
+
 
 public:
 	/** Default UObject constructor. */
@@ -63,10 +118,14 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
 	UCameraComponent* FollowCamera;
 
-	/** Default Camera that stays half way between the character and their target */
+	/** Default Camera that stays half way between the character and their target. Placed by AFightingCameraManager */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
 	UCameraComponent* Camera2;
 
+	/** Records every press and release of the input actions, so attack presses can be performed when the next combo attack can be added */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Input)
+	UFightingInputBufferComponent* InputBuffer;
+
 	//~ Begin Pressed Keys Flags
 	/** Tracks if one of the attack keys is being pressed while an attack action is possible */
 	UPROPERTY(BlueprintReadOnly, Category = Attack)
@@ -130,12 +189,21 @@ public:
 	UPROPERTY(BlueprintReadWrite, Category = Reaction)
 	TEnumAsByte <ReactType> Reaction = ReactType::NoReact;
 
+	/**
+	 * Id of the current state of the combo state machine (see UAttackCatalog::GetComboGraph()).
+	 * FComboGraph::RootState (0) means no combo sequence is being performed.
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = Attack)
+	int32 ComboState = FComboGraph::RootState;
+
 	/**
 	 * Variable that tracks the current Combo Sequence being performed.
 	 * Example: "212" represents that Attack 2 was performed, followed by Attack 1, and is currently at Attack 2
 	 * Each sequence will map to a different attack Animation Montage in the animation blueprint
 	 * Attack 1 = "1", Attack 2 = "2", Move Modifier + Attack 1 = "3", Move Modifier + Attack 2 = "4"
-	 * Taunt + Attack 1 = "5" or "55", Taunt + Attack 2 = "6" or "6"
+	 * Taunt + Attack 1 = "5" or "55", Taunt + Attack 2 = "6" or "66", Duck + any attack = "0"
+	 * It is copied from the combo state machine whenever ComboState changes, for the animation blueprint
+	 * to keep selecting montages by name. New code should use ComboState or GetComboMontage() instead.
 	 */
 	UPROPERTY(BlueprintReadWrite, Category = Attack)
 	FString ComboSequenceStr = TEXT("");
@@ -191,11 +259,13 @@ public:
 	 */
 	void JumpChecking();
 
+	/** Called when Jump key is released. Calls ACharacter::StopJumping() */
+	void StopJumpChecking();
+
 	/**
-	 * Called when Attack 1 key is pressed.
-	 * If CanAttack and CanAddNextComboAttack, adds the propriate string to the end of ComboSequenceStr
+	 * Called when Attack 1 key is pressed. The press is recorded in the InputBuffer.
+	 * If CanAttack and CanAddNextComboAttack, advances the combo sequence with the oldest buffered attack press (see PerformBufferedAttack())
 	 * and sets IsAttacking to true, which signals the animation blueprint to be play the corresponding Animation Montage
-	 * animation blueprint to be play the corresponding Animation Montage
 	 */
 	UFUNCTION(BlueprintCallable, Category = Behaviour)
 	void Attack1();
@@ -205,8 +275,8 @@ public:
 	void StopAttack1();
 
 	/**
-	* Called when Attack 2 key is pressed.
-	* If CanAttack and CanAddNextComboAttack, adds the propriate string to the end of ComboSequenceStr
+	* Called when Attack 2 key is pressed. The press is recorded in the InputBuffer.
+	* If CanAttack and CanAddNextComboAttack, advances the combo sequence with the oldest buffered attack press (see PerformBufferedAttack())
 	* and sets IsAttacking to true, which signals the animation blueprint to be play the corresponding Animation Montage
 	*/
 	UFUNCTION(BlueprintCallable, Category = Behaviour)
@@ -257,6 +327,9 @@ public:
 	/** Changes the active camera between FollowCamera and Camera2 */
 	void ChangeCamera();
 
+	/** Returns true if Camera2 is the active camera, so AFightingCameraManager frames the fight */
+	FORCEINLINE bool IsFightCameraActive() const { return Camera2->IsActive(); }
+
 	/**
 	 * Sets another AFightingCharacter as the target enemy
 	 *
@@ -273,7 +346,8 @@ public:
 	void RotateToTarget(float DeltaTime);
 
 	/**
-	 * Returns the Weapon velocity of the specified Weapon Collision Box Component (fists or feet collision boxes)
+	 * Returns the current Weapon velocity of the specified Weapon Collision Box Component (fists or feet collision boxes),
+	 * measured over a fixed time window so it does not depend on the frame rate. @see FLimbVelocitySampler
 	 *
 	 * @param WeaponComponent		Weapon Collision Box Component (fists or feet collision boxes)
 	 * @return Velocity of the specified Weapon Component
@@ -312,7 +386,11 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Animation)
 	FVector GetFootLLocation();
 
-	/** Clears the ComboSequenceStr, resetting it back to "". Called when an attack animation finishes and no new attack key has been pressed*/
+	/** Returns the Animation Montage of the current combo sequence, or None if the combo catalog doesn't set one */
+	UFUNCTION(BlueprintCallable, Category = Attack)
+	UAnimMontage* GetComboMontage();
+
+	/** Clears the ComboSequenceStr, resetting it back to "" and ComboState back to the root state. Called when an attack animation finishes and no new attack key has been pressed*/
 	UFUNCTION(BlueprintCallable, Category = Attack)
 	void ClearComboSequence();
 
@@ -328,10 +406,83 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Getter)
 	float GetHealthPoints();
 
-	/** Returns DamagePotential of the specified body part */
+	/**
+	 * Scales the BaseDamage of every body part and sets PotentialIncrement. Used to balance the damage in headless matches.
+	 * Must be called after BeginPlay(), which initialises BaseDamage.
+	 *
+	 * @param BaseDamageScale			factor applied to the BaseDamage of every body part
+	 * @param NewPotentialIncrement		new value of PotentialIncrement. If negative, PotentialIncrement is kept
+	 */
+	void SetDamageTuning(float BaseDamageScale, float NewPotentialIncrement);
+
+	/**
+	 * Returns DamagePotential of the specified body part.
+	 * Kept for the Blueprints that still identify body parts by name ("head", "torso", "right_arm", ...)
+	 *
+	 * @see GetBodyPartDamagePotential()
+	 */
 	UFUNCTION(BlueprintCallable, Category = Getter)
 	float GetDamagePotential(FString bodypart);
 
+	/** Returns DamagePotential of the specified body part */
+	UFUNCTION(BlueprintCallable, Category = Getter)
+	float GetBodyPartDamagePotential(EBodyPart BodyPart);
+
+	/**
+	 * Returns the body part the specified Damage Collision Box belongs to.
+	 * If the component is not one of this character's Damage Collision Boxes, returns EBodyPart::None
+	 */
+	EBodyPart GetBodyPart(const UPrimitiveComponent* CollisionBox) const;
+
+	/** Returns the index of the specified Damage Collision Box in DamageCollisionBoxes, or INDEX_NONE if it is not one */
+	int32 GetDamageBoxIndex(const UPrimitiveComponent* CollisionBox) const;
+
+	/** Returns all the Damage Collision Boxes */
+	const std::vector<UBoxComponent*>& GetDamageCollisionBoxes() const { return DamageCollisionBoxes; }
+
+	/** Returns all the Weapon Collision Boxes */
+	const std::vector<UBoxComponent*>& GetWeaponCollisionBoxes() const { return WeaponCollisionBoxes; }
+
+	/** Returns true if the collision boxes are updated by the Hitboxes component instead of their box components */
+	FORCEINLINE bool UsesHitboxes() const { return bUseHitboxes; }
+
+	/** Returns false if the Damage Collision Boxes are gated by proximity and no attacker is in reach */
+	FORCEINLINE bool AreDamageBoxesActive() const { return !bGateDamageBoxes || bDamageBoxesActive; }
+
+	/** Returns the world transform of the Weapon Collision Box i of WeaponCollisionBoxes */
+	FTransform GetWeaponBoxTransform(int32 Index) const;
+
+	/** Returns the unscaled half size of the Weapon Collision Box i of WeaponCollisionBoxes */
+	FVector GetWeaponBoxExtent(int32 Index) const;
+
+	/** Returns the Weapon Collision Box i of WeaponCollisionBoxes as an oriented box in world space */
+	FOrientedBox GetWeaponOrientedBox(int32 Index) const;
+
+	/** Returns the Damage Collision Box i of DamageCollisionBoxes as an oriented box in world space */
+	FOrientedBox GetDamageOrientedBox(int32 Index) const;
+
+	/** Returns the world location of the collision box of a fist or a foot */
+	FVector GetLimbLocation(ELimb Limb) const;
+
+	/** Returns the model of the attacks performed by this character, used by the AI of its opponents to anticipate them */
+	FORCEINLINE const FComboPredictor& GetComboPredictor() const { return ComboPredictor; }
+
+	/** Returns true if any Damage Collision Box of the specified body part is being overlapped by a weapon */
+	bool IsBodyPartOverlapping(EBodyPart BodyPart) const;
+
+	/** Converts a body part name ("head", "chest", "torso", "right_arm", "left_arm", "right_leg", "left_leg") to EBodyPart */
+	static EBodyPart BodyPartFromName(const FString& Name);
+
+	/** Returns the body part whose table entry is used when damage is inflicted on the specified body part (Chest shares Torso's) */
+	static EBodyPart GetDamageCategory(EBodyPart BodyPart);
+
+	/**
+	 * Catalog of the attacks this character can perform and the reactions they cause on the opponent.
+	 * If not set in the Blueprint, a catalog with the default attacks is created for this character. @see UAttackCatalog
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Attack)
+	UAttackCatalog* AttackCatalog;
+
 	/** Impact velocity of the last attack that performed. If the attack never collided, then the value is zero */
 	UPROPERTY(BlueprintReadOnly, Category = Getter)
 	float LastAttackImpactVel = 0.0f;
@@ -398,6 +549,14 @@ public:
 		UBoxComponent* LeftLegCollisionBox;
 	//~ End Damage Collision Boxes
 
+	/**
+	 * Oriented boxes of all the collision boxes, updated in one pass from the bone transforms of the mesh.
+	 * If Fighting.Hitbox.UseComponent is set and hits are detected by the hit detection subsystem, the boxes are built from
+	 * the box components in BeginPlay(), which are then unregistered and only kept as handles and for their collision profile.
+	 */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Collision, meta = (AllowPrivateAccess = "true"))
+		UHitboxComponent* Hitboxes;
+
 	//~Begin Attacks Functions
 	/** @see PunchAttackNotifyState, KickAttackNotifyState */
 
@@ -418,13 +577,13 @@ public:
 	 * Called when collision occurs between two characters, and this character is the one reaction rather than attacking.
 	 * Sets the Reaction variable to the appropriate ReactType that trigger the animaiton blueprint to play the animation.
 	 *
-	 * @param attacker		pointer to the other actor that is attacking
+	 * @param attacker		pointer to the other character that is attacking
 	 * @param CollisionBox	pointer to the collision box of this character that suffered collision
 	 * @param ImpactVel		impact velocity
 	 * @param ImpactPoint	point of impact
-	 * @param AttackName	Name of the attack Animation Montage being played by the attacker
+	 * @param AttackId		id in the attacker's AttackCatalog of the attack being performed
 	 */
-	void ReactionStart(AActor* attacker, UPrimitiveComponent* CollisionBox, float ImpactVel, FVector ImpactPoint, FString AttackName);
+	void ReactionStart(AFightingCharacter* attacker, UPrimitiveComponent* CollisionBox, float ImpactVel, FVector ImpactPoint, int32 AttackId);
 	
 	/** Triggered when a reaction animation ends. Sets Reaction back to NoReact and resets the actions that can be performed */
 	UFUNCTION(BlueprintCallable, Category = React)
@@ -432,11 +591,14 @@ public:
 
 	/**
 	 * Deducts points from the health points of this character, based on the body part and impact velocity.
+	 * Broadcasts OnFighterDamaged if damage was taken, unless a rollback is resimulating the frame.
 	 *
 	 * @param CollisionBox	pointer to the collision box of this character that suffered collision
 	 * @param ImpactVel		impact velocity
+	 * @param Attacker		fighter that landed the hit, credited with the attack points and impact velocity. Can be NULL
+	 * @return damage taken, 0 if the hit was blocked or the body part is in its damage cooldown
 	 */
-	void InflictDamage(UPrimitiveComponent* CollisionBox, float ImpactVel);
+	float InflictDamage(UPrimitiveComponent* CollisionBox, float ImpactVel, AFightingCharacter* Attacker);
 
 	/** Triggered when the collision hits event fires between Weapon collider and another component */
 	UFUNCTION()
@@ -453,11 +615,97 @@ public:
 	UFUNCTION()
 		void OnAttackOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
-	/** Map that stores where each Damage Box is overlapping or not. Takes the box component's name as key */
-	std::map <FString, bool> IsDamageBoxOverlapping;
+	/**
+	 * Applies a hit of one of this character's Weapon Collision Boxes on a Damage Collision Box of the enemy:
+	 * triggers InflictDamage() and ReactionStart() on the enemy.
+	 * Called by OnAttackOverlapBegin() and by the continuous hit detection.
+	 *
+	 * @param WeaponComponent	Weapon Collision Box of this character
+	 * @param enemy				character being hit
+	 * @param DamageBox			Damage Collision Box of the enemy that was hit
+	 * @param ImpactPoint		point of impact
+	 */
+	void RegisterAttackHit(UPrimitiveComponent* WeaponComponent, AFightingCharacter* enemy, UPrimitiveComponent* DamageBox, const FVector& ImpactPoint);
+
+	/**
+	 * If true, the active Weapon Collision Boxes are swept every frame from their previous to their current transform
+	 * against the Damage Collision Boxes of the fighters it can hit, so fast attacks that pass through a Damage Box between two frames
+	 * still hit. Useful when the tick rate is low (e.g. a capped server tick rate). @see SweepWeaponCollisionBoxes()
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Collision)
+		bool bContinuousHitDetection = false;
+
+	/**
+	 * Distance between the capsules of this character and another fighter under which this character's attacks can reach
+	 * the other fighter's Damage Collision Boxes. While an attack window is open, the Damage Collision Boxes of the fighters
+	 * within this distance are kept active. @see UpdateDamageBoxGating()
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Collision, meta = (ClampMin = "0"))
+		float DamageBoxReachRadius = 150.0f;
+
+	/** Stores whether each Damage Box is overlapping or not. Indexed the same way as DamageCollisionBoxes */
+	bool IsDamageBoxOverlapping[NumDamageBoxes];
 	
-	/** Time in seconds that one of the arms was last overlapped */
-	float LastArmsOverlapTime;
+	/** Combat frame in which one of the arms was last overlapped while blocking. @see UCombatClock */
+	int32 LastArmsOverlapFrame;
+
+	/** Returns the number of the current combat frame, in which the combat rules are measured. @see UCombatClock */
+	int32 GetCombatFrame() const;
+
+	/**
+	 * Returns true while a rollback restores and resimulates frames. Events are not broadcast and hits are not recorded meanwhile,
+	 * as the rollback tells the listeners about the final state. @see URollbackSubsystem::IsResimulating()
+	 */
+	bool IsResimulating() const;
+
+	//~ Begin Rollback
+	/**
+	 * Saves the gameplay state of this character: health, body part table, combo state, reaction, action flags,
+	 * limb velocity maxima, attack montage position, location and velocity. @see FFighterState
+	 *
+	 * @param OutState	saved state. Its LastInput is not set
+	 */
+	void SaveState(FFighterState& OutState) const;
+
+	/**
+	 * Restores a state saved by SaveState(). The attack montage is restarted at the saved position if needed.
+	 *
+	 * @param State		saved state
+	 */
+	void LoadState(const FFighterState& State);
+
+	/**
+	 * Applies the input of one combat frame, calling the same functions as the input bindings for the buttons that
+	 * were pressed or released since the previous frame. Used to drive fighters from a rollback session.
+	 *
+	 * @param Input			input of this frame
+	 * @param PreviousInput	input of the previous frame
+	 */
+	void ApplyInput(const FFighterInput& Input, const FFighterInput& PreviousInput);
+
+	/**
+	 * Advances this character by one combat step outside of the normal world tick, when a rollback session resimulates frames:
+	 * moves it with its saved velocity and advances its animation, which moves the collision boxes, then gates the damage boxes
+	 * and sweeps the weapon boxes as Tick() does.
+	 *
+	 * @param DeltaTime		duration of the step
+	 */
+	void ResimulateStep(float DeltaTime);
+
+	/**
+	 * Returns the input of this character in the current frame: the actions held in its InputBuffer and the movement input
+	 * consumed in the last frame. Used to record replays.
+	 */
+	FFighterInput GetCurrentInput() const;
+	//~ End Rollback
+
+	/** Called when this character takes damage from a hit, after HealthPoints and the Hit flags are updated. @see InflictDamage() */
+	UPROPERTY(BlueprintAssignable, Category = Hit)
+		FOnFighterDamaged OnFighterDamaged;
+
+	/** Called when the stats of the last attack of this character change. @see LastAttackImpactVel, LastAttackPoints */
+	UPROPERTY(BlueprintAssignable, Category = Hit)
+		FOnAttackStatsChanged OnAttackStatsChanged;
 
 	/** Flags that signal when a body part is hit. Used by HealthBar_UI blueprint to flash the respective body part when being hit */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Hit)
@@ -477,14 +725,104 @@ protected:
 	/** Called when the game starts or when spawned */
 	virtual void BeginPlay() override;
 
+	/** Called when the character is removed from the game. Unregisters it from the hit detection subsystem */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	/** Initialises all collision boxes. Called in the constructor. */
 	void CollisionBoxesInit();
 
 	/** Attaches all collision boxes to the respective socket in the character's skeleton mesh. Called during BeginPlay() */
 	void AttachCollisionBoxesToSockets();
 
-	/** Initialises variables DamageCBCategories, DamagePotential, BaseDamage and LastDamageTakenTime. Called during BeginPlay() */
+	/**
+	 * Builds the Hitboxes from the extents, sockets and scales of the attached collision boxes, binds them to the mesh and
+	 * unregisters the box components. Called during BeginPlay() after AttachCollisionBoxesToSockets()
+	 */
+	void InitHitboxes();
+
+	/** Initialises the body part table (BaseDamage, DamagePotential, LastDamageTakenFrame and HitFlags). Called during BeginPlay() */
 	void VariablesInit();
+
+	/**
+	 * Advances the combo state machine with an attack key press, taking into account the modifier keys pressed with it.
+	 * If the resulting combo sequence is not defined, the combo does not advance.
+	 *
+	 * @param AttackInput	EComboInput::Attack1 or EComboInput::Attack2
+	 * @param bMoveMod		whether the move modifier key was held when the attack key was pressed
+	 * @param bTaunt		whether the taunt key was held when the attack key was pressed
+	 * @return true if the combo advanced
+	 */
+	bool AdvanceCombo(EComboInput AttackInput, bool bMoveMod, bool bTaunt);
+
+	/**
+	 * If CanAttack and CanAddNextComboAttack, consumes the oldest attack press in the InputBuffer that is within its window,
+	 * and advances the combo sequence with it. Presses that do not advance the combo are dropped.
+	 * Called when an attack key is pressed and every combat step, so a press made while the previous attack was playing
+	 * is performed as soon as the next combo attack can be added.
+	 */
+	void PerformBufferedAttack();
+
+	/** Observes the pending attacks of the combat frames that can no longer be rolled back. Called every combat step */
+	void ObserveConfirmedAttacks();
+
+	/** Stops blocking when a hit or a reaction interrupts the block, without recording a release of the Block key */
+	void EndBlocking();
+
+	/** Combat frame in which the last attack press was performed from the InputBuffer */
+	int32 LastBufferedAttackFrame;
+
+	/**
+	 * Adds a Damage Collision Box to DamageCollisionBoxes and records the body part it belongs to. Called in CollisionBoxesInit()
+	 *
+	 * @param CollisionBox	Damage Collision Box to be added
+	 * @param BodyPart		body part the Damage Collision Box belongs to
+	 */
+	void AddDamageCollisionBox(UBoxComponent* CollisionBox, EBodyPart BodyPart);
+
+	/**
+	 * Continuous hit detection. Sweeps each active Weapon Collision Box from its transform of the previous frame to the current one
+	 * against the Damage Collision Boxes of the fighters it can hit (GetHittableFighters()), and registers a hit at the earliest time of impact.
+	 * Only hits where the boxes do not overlap anymore at the end of the frame are registered here; the others
+	 * generate overlap events as usual. Called every frame if bContinuousHitDetection is true.
+	 */
+	void SweepWeaponCollisionBoxes();
+
+	/** Returns true if the fists or the feet of this character are inside an attack window */
+	FORCEINLINE bool IsAttackWindowOpen() const { return bTrackFistsVelocity || bTrackFeetVelocity; }
+
+	/**
+	 * Proximity gating of the Damage Collision Boxes, so the physics scene only has to query them when an attack can reach them.
+	 * While an attack window of this character is open, keeps the Damage Collision Boxes of the fighters in reach active.
+	 * Deactivates this character's Damage Collision Boxes once no attacker requested them for a frame.
+	 * Called every frame if bGateDamageBoxes is true.
+	 */
+	void UpdateDamageBoxGating();
+
+	/** Keeps the Damage Collision Boxes of the fighters within DamageBoxReachRadius of this character active this frame */
+	void ActivateDamageBoxesInReach();
+
+	/** Returns the fighters this character can hit: all the other fighters in the arena, otherwise the target enemy */
+	void GetHittableFighters(TArray<AFightingCharacter*, TInlineAllocator<8>>& OutFighters) const;
+
+	/** Activates this character's Damage Collision Boxes, if gated, until the end of the next frame */
+	void RequestDamageBoxes();
+
+	/**
+	 * Enables or disables the collision of the Damage Collision Boxes. The legs are left alone while they are Weapon Collision Boxes.
+	 * With the Hitboxes component, starts or stops updating the damage hitboxes that are not also weapon hitboxes.
+	 *
+	 * @param bActive	true to restore the DamageBox collision profile, false to disable their collision
+	 */
+	void SetDamageBoxesActive(bool bActive);
+
+	/** Whether the Damage Collision Boxes are gated by proximity. Set in BeginPlay() from Fighting.HitDetection.GateDamageBoxes */
+	bool bGateDamageBoxes = false;
+
+	/** Whether the Damage Collision Boxes have their collision enabled, or their hitboxes updated */
+	bool bDamageBoxesActive = true;
+
+	/** Combat frame in which an attacker in reach last requested the Damage Collision Boxes */
+	int32 DamageBoxesRequestFrame = 0;
 	
 	/** Velocity used as the speed variable of the idle/walk Blend Space. @see GetSpeedForAnimation()*/
 	float speedForAnimation;
@@ -493,11 +831,15 @@ protected:
 	std::vector<UBoxComponent*> DamageCollisionBoxes;
 	std::vector<UBoxComponent*> WeaponCollisionBoxes;
 
-	/** Map that stores the category as a generalised body part of each Damage Box */
-	std::map <FString, FString> DamageCBCategory;
+	/** Body part of each Damage Box. Indexed the same way as DamageCollisionBoxes */
+	EBodyPart DamageBoxBodyPart[NumDamageBoxes];
+
+	/** Whether the collision boxes are read from Hitboxes. @see InitHitboxes() */
+	bool bUseHitboxes = false;
 
-	/** List of all the Damage Boxes categories of generalised body parts */
-	std::vector <FString> DamageCBCategories;
+	/** Index in Hitboxes of each Weapon and Damage Collision Box. The legs are both, and share their box */
+	int32 WeaponHitbox[NumWeaponBoxes];
+	int32 DamageHitbox[NumDamageBoxes];
 
 	/** Pointer to the target enemy*/
 	AFightingCharacter* TargetEnemy;
@@ -525,54 +867,96 @@ protected:
 	/** If set to true the velocity of each foot is tracked */
 	bool bTrackFeetVelocity;
 
-	/** Velocity of the each fist collision box. Are only updated if bTrackFistsVelocity is true */
-	float RightFistVelocity;
-	float LeftFistVelocity;
+	/**
+	 * Velocity samplers of each fist/foot collision box, indexed by ELimb.
+	 * Are only updated if bTrackFistsVelocity/bTrackFeetVelocity is true, and are reset when an attack starts
+	 */
+	FLimbVelocitySampler LimbVelocity[NumLimbs];
+
+	/**
+	 * Combo states reached by the attacks of this character, observed once the combat frame they were performed in is confirmed.
+	 * Not part of the rollback state
+	 */
+	FComboPredictor ComboPredictor;
+
+	/** Attack performed in a combat frame that may still be rolled back */
+	struct FPendingAttack
+	{
+		int32 Frame;
+		int32 ComboState;
+	};
+
+	/** Attacks not observed by ComboPredictor yet, oldest first. Dropped when a state from before them is loaded */
+	TArray<FPendingAttack, TInlineAllocator<8>> PendingAttacks;
 
-	/** Velocity of the each foot collision box. Are only updated if bTrackFeetVelocity is true */
-	float RightFootVelocity;
-	float LeftFootVelocity;
+	/** Combat frame of the last attack observed by ComboPredictor, so frames simulated again are not observed twice */
+	int32 LastObservedAttackFrame = -1;
 
-	/** Last position of each fist/foot collision box. Are only updated if bTrackFistsVelocity/bTrackFeetVelocity is true */
-	FVector RightFistLastPos;
-	FVector LeftFistLastPos;
-	FVector RightFootLastPos;
-	FVector LeftFootLastPos;
+	/** Transform of each Weapon Collision Box in the last frame, used by the continuous hit detection. Indexed the same way as WeaponCollisionBoxes */
+	FTransform LastWeaponTransforms[NumWeaponBoxes];
 
-	/** Maximum velocity reached of each fist/foot collision box during the last (or current) attack performed */
-	float RightFistVelocity_max;
-	float LeftFistVelocity_max;
-	float RightFootVelocity_max;
-	float LeftFootVelocity_max;
+	/** Whether each Weapon Collision Box was active (Weapon collision profile) in the last frame */
+	bool WasWeaponBoxActive[NumWeaponBoxes];
 
-	/** Location of Camera 2 */
-	FVector Cam2Location;
+	/** Combat frame in which LastWeaponTransforms were recorded, or INDEX_NONE */
+	int32 LastWeaponSweepFrame = INDEX_NONE;
 
-	/** Look at location of Camera 2 */
-	FVector Cam2LookAt;
+	/**
+	 * Hit detection subsystem this character is registered with. If NULL, hits are detected with the overlap events of the
+	 * Weapon Collision Boxes. @see UHitDetectionSubsystem
+	 */
+	UPROPERTY()
+	UHitDetectionSubsystem* HitDetection;
 
-	/** Controller rotation (equivalent to camera rotation */
-	FRotator ControllerRotation;
+	/**
+	 * Tick manager this character is registered with. If not NULL, the rotation to the target, the max walk speed,
+	 * and the limb velocity tracking are done by the manager instead of Tick(). @see UFighterTickManager
+	 */
+	UPROPERTY()
+	UFighterTickManager* TickManager;
 
-	/** Default distance between Camera 2 and the segment connecting the character and their target */
-	float Cam2Distance = 300;
+	/** AI scheduler this character is registered with. If not NULL, it updates the behaviour tree of this character's AI. @see UFighterAIScheduler */
+	UPROPERTY()
+	UFighterAIScheduler* AIScheduler;
 
-	/** Stores a pointer to the this player's controller */
-	APlayerController* ThisPlayerController;
+	/** Fixed timestep clock of the combat rules of this character's world */
+	UPROPERTY()
+	UCombatClock* CombatClock;
 
-	/** True if this is the playable character */
-	bool IsPlayableChar = false;
+	/** Hit telemetry every hit of this character is recorded into, or NULL if it is disabled. @see UHitTelemetrySubsystem */
+	UPROPERTY()
+	UHitTelemetrySubsystem* HitTelemetry;
 
 	/**
-	 * Maps each body part category to a DamagePotential.
+	 * Advances the combat state of this character by one fixed step. Tracks the arms overlapping while blocking.
+	 * Bound to UCombatClock::OnCombatStep.
+	 *
+	 * @param Frame		number of the new combat frame
+	 */
+	void CombatStep(int32 Frame);
+
+	//~ Begin Body Part Table (indexed by EBodyPart. Chest is folded into Torso, so its entries are unused)
+
+	/**
+	 * DamagePotential of each body part.
 	 * When inflicting damage the base damage is multiplied by this Damage Potential of the corresponding body part.
 	 * The more a body part is hit, the Damage Potential is increased. Starts at 1.0 and caps at 3.0
 	 */
-	std::map <FString, float> DamagePotential;
+	float DamagePotential[NumBodyParts];
+
+	/** BaseDamage of each body part. Head has the biggest base damage, followed by torso, and the legs/arms have the lowest base damage */
+	float BaseDamage[NumBodyParts];
 
-	/**  Maps each body part category to a BaseDamage. Head has the biggest base damage, followed by torso, and the legs/arms have the lowest base damage */
-	std::map <FString, float> BaseDamage;
-	std::map <FString, float> LastDamageTakenTime;
+	/** Combat frame in which each body part has last taken damage */
+	int32 LastDamageTakenFrame[NumBodyParts];
+
+	/** Pointers to the Hit flag (HitHead, HitTorso, ...) that signals each body part being hit */
+	bool* HitFlags[NumBodyParts];
+
+	/** Random stream that chooses between the taunt variants. Part of the saved state, so resimulated frames choose the same ones */
+	FRandomStream ComboRandom;
+
+	//~ End Body Part Table
 
 	/** Tracks the current health points of the character. When 0 is reached, character is set as defeated */
 	float HealthPoints = 1;
@@ -588,6 +972,3 @@ public:
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 };
-
-/** Generates a random float between 0.0 and 1.0*/
-float get_random_float();
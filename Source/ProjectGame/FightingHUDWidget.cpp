@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FightingHUDWidget.h"
+#include "HealthBarWidget.h"
+#include "FightingCharacter.h"
+#include "Blueprint/WidgetTree.h"
+#include "Components/WrapBox.h"
+#include "Components/WrapBoxSlot.h"
+
+bool UFightingHUDWidget::Initialize()
+{
+	if (!Super::Initialize()) return false;
+
+	// Native instances have no layout of their own
+	if (WidgetTree != NULL && WidgetTree->RootWidget == NULL) {
+		UWrapBox* wrap = WidgetTree->ConstructWidget<UWrapBox>(UWrapBox::StaticClass(), TEXT("HealthBars"));
+		wrap->InnerSlotPadding = FVector2D(16.0f, 8.0f);
+		WidgetTree->RootWidget = wrap;
+		HealthBars = wrap;
+	}
+
+	if (HealthBarClass == NULL) HealthBarClass = UHealthBarWidget::StaticClass();
+	return true;
+}
+
+void UFightingHUDWidget::SetFighters(const TArray<AFightingCharacter*>& Fighters)
+{
+	for (UHealthBarWidget* bar : Bars) bar->SetFighter(NULL);
+	Bars.Reset();
+	if (HealthBars == NULL) return;
+	HealthBars->ClearChildren();
+
+	for (AFightingCharacter* fighter : Fighters) {
+		if (fighter == NULL) continue;
+
+		UHealthBarWidget* bar = CreateWidget<UHealthBarWidget>(this, HealthBarClass);
+		if (bar == NULL) continue;
+
+		bar->SetFighter(fighter);
+		HealthBars->AddChild(bar);
+		Bars.Add(bar);
+	}
+}
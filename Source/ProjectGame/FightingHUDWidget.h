@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "FightingHUDWidget.generated.h"
+
+class AFightingCharacter;
+class UHealthBarWidget;
+class UPanelWidget;
+
+/**
+ * HUD showing one UHealthBarWidget for each fighter, so it scales from a 1v1 to the fighters of the arena.
+ * A Blueprint subclass can provide the panel the bars are added to by naming it HealthBars. Otherwise they are wrapped in rows.
+ * @see AMyGameMode
+ */
+UCLASS()
+class PROJECTGAME_API UFightingHUDWidget : public UUserWidget
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Replaces the health bars with one bar for each fighter. Every fighter is an opponent of the others
+	 *
+	 * @param Fighters	fighters to show
+	 */
+	UFUNCTION(BlueprintCallable, Category = "UI HUD")
+	void SetFighters(const TArray<AFightingCharacter*>& Fighters);
+
+	//~ Begin UUserWidget Interface
+	virtual bool Initialize() override;
+	//~ End UUserWidget Interface
+
+	/** Class of the health bar of each fighter */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "UI HUD")
+	TSubclassOf<UHealthBarWidget> HealthBarClass;
+
+protected:
+	/** Panel the health bars are added to */
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UPanelWidget* HealthBars;
+
+	/** Health bar of each fighter, in the order of SetFighters() */
+	UPROPERTY(Transient)
+	TArray<UHealthBarWidget*> Bars;
+};
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FightingInputBufferComponent.h"
+#include "CombatClock.h"
+#include "Algo/Reverse.h"
+
+UFightingInputBufferComponent::UFightingInputBufferComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UFightingInputBufferComponent::Record(EFighterAction Action, bool bPressed, int32 Frame)
+{
+	if (bPressed) HeldMask |= GetActionBit(Action);
+	else HeldMask &= ~GetActionBit(Action);
+
+	// When full, the oldest event is overwritten
+	int32 Index = (Head + Count) % Capacity;
+	if (Count < Capacity) Count++;
+	else Head = (Head + 1) % Capacity;
+
+	FBufferedInput& Event = Events[Index];
+	Event.Frame = Frame;
+	Event.HeldMask = HeldMask;
+	Event.Action = Action;
+	Event.bPressed = bPressed;
+	Event.bConsumed = false;
+}
+
+bool UFightingInputBufferComponent::ConsumePress(uint16 ActionMask, int32 Frame, FBufferedInput& OutInput)
+{
+	// The window is measured in combat frames, so buffering behaves the same at any frame rate
+	const int32 OldestFrame = Frame - UCombatClock::SecondsToFrames(BufferWindow);
+
+	for (int32 i = 0; i < Count; i++) {
+		FBufferedInput& Event = Events[(Head + i) % Capacity];
+		if (!Event.bPressed || Event.bConsumed || Event.Frame < OldestFrame) continue;
+		if ((ActionMask & GetActionBit(Event.Action)) == 0) continue;
+
+		Event.bConsumed = true;
+		OutInput = Event;
+		return true;
+	}
+	return false;
+}
+
+void UFightingInputBufferComponent::Reset()
+{
+	Head = 0;
+	Count = 0;
+	HeldMask = 0;
+}
+
+int32 UFightingInputBufferComponent::GetPendingPresses(int32 Frame, FBufferedInput* OutPresses, int32 MaxPresses) const
+{
+	const int32 OldestFrame = Frame - UCombatClock::SecondsToFrames(BufferWindow);
+
+	// Newest first, so the oldest presses are the ones dropped if there are too many
+	int32 Num = 0;
+	for (int32 i = Count - 1; i >= 0 && Num < MaxPresses; i--) {
+		const FBufferedInput& Event = Events[(Head + i) % Capacity];
+		if (Event.Frame < OldestFrame) break;
+		if (Event.bPressed && !Event.bConsumed) OutPresses[Num++] = Event;
+	}
+	Algo::Reverse(OutPresses, Num);
+	return Num;
+}
+
+void UFightingInputBufferComponent::Restore(uint16 InHeldMask, const FBufferedInput* Presses, int32 NumPresses)
+{
+	NumPresses = FMath::Min(NumPresses, Capacity);
+	for (int32 i = 0; i < NumPresses; i++) Events[i] = Presses[i];
+	Head = 0;
+	Count = NumPresses;
+	HeldMask = InHeldMask;
+}
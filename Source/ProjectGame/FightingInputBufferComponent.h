@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "FightingInputBufferComponent.generated.h"
+
+/** EFighterAction is an Enum that enumerates the input actions of a FightingCharacter recorded in its input buffer */
+enum class EFighterAction : uint8
+{
+	Attack1, Attack2, Block, Duck, MoveMod, Taunt, Run, Jump,
+	None
+};
+
+/** Returns the bit of an action in an action mask */
+FORCEINLINE uint16 GetActionBit(EFighterAction Action) { return (uint16)(1 << (int32)Action); }
+
+/**
+ * A press or release of an input action.
+ * Events are timestamped with the combat frame they were made in, and the ring keeps the order of the events of the same frame.
+ * Wall clock times are not kept: they could not be restored by rollback and replays, which must consume the same presses.
+ */
+struct FBufferedInput
+{
+	/** Combat frame of the event. @see UCombatClock */
+	int32 Frame;
+
+	/** Bits of the actions held right after the event, so the modifiers held when an attack was pressed are known */
+	uint16 HeldMask;
+
+	EFighterAction Action;
+
+	/** True for a press, false for a release */
+	bool bPressed;
+
+	/** True once a press has been used */
+	bool bConsumed;
+
+	/** Returns true if an action was held right after the event */
+	FORCEINLINE bool IsHeld(EFighterAction HeldAction) const { return (HeldMask & GetActionBit(HeldAction)) != 0; }
+};
+
+/**
+ * Records every press and release of the input actions of a FightingCharacter, in order, into a fixed-size ring
+ * timestamped with combat frames. A press that cannot be performed when it arrives (e.g. an attack while CanAddNextComboAttack
+ * is false) stays in the buffer and can be consumed later, as long as it is not older than BufferWindow.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class PROJECTGAME_API UFightingInputBufferComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Number of events kept in the ring. Older events are overwritten */
+	static const int32 Capacity = 32;
+
+	UFightingInputBufferComponent();
+
+	/** How long a press stays in the buffer waiting to be performed, in seconds */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Input, meta = (ClampMin = "0.0"))
+	float BufferWindow = 0.2f;
+
+	/**
+	 * Records a press or release of an action.
+	 *
+	 * @param Action	action pressed or released
+	 * @param bPressed	true for a press, false for a release
+	 * @param Frame		current combat frame
+	 */
+	void Record(EFighterAction Action, bool bPressed, int32 Frame);
+
+	/**
+	 * Finds the oldest press of one of the specified actions that was not consumed yet and is within BufferWindow,
+	 * and marks it consumed.
+	 *
+	 * @param ActionMask	bits of the actions to look for
+	 * @param Frame			current combat frame
+	 * @param OutInput		press found
+	 * @return true if a press was found
+	 */
+	bool ConsumePress(uint16 ActionMask, int32 Frame, FBufferedInput& OutInput);
+
+	/** Returns true if the action is currently held */
+	FORCEINLINE bool IsHeld(EFighterAction Action) const { return (HeldMask & GetActionBit(Action)) != 0; }
+
+	/** Returns the bits of the actions currently held */
+	FORCEINLINE uint16 GetHeldMask() const { return HeldMask; }
+
+	/** Returns the number of events in the ring */
+	FORCEINLINE int32 Num() const { return Count; }
+
+	/** Returns an event, 0 being the oldest */
+	FORCEINLINE const FBufferedInput& Get(int32 Index) const { return Events[(Head + Index) % Capacity]; }
+
+	/** Clears all the events and held actions */
+	void Reset();
+
+	/**
+	 * Copies the presses that could still be consumed: not consumed yet and within BufferWindow. Used to save the state of a fighter
+	 *
+	 * @param Frame			current combat frame
+	 * @param OutPresses	receives the presses, oldest first
+	 * @param MaxPresses	size of OutPresses. The newest presses are kept if there are more
+	 * @return number of presses copied
+	 */
+	int32 GetPendingPresses(int32 Frame, FBufferedInput* OutPresses, int32 MaxPresses) const;
+
+	/**
+	 * Replaces the events and held actions with those of a saved state
+	 *
+	 * @param InHeldMask	bits of the actions held
+	 * @param Presses		pending presses, oldest first (@see GetPendingPresses())
+	 * @param NumPresses	number of presses
+	 */
+	void Restore(uint16 InHeldMask, const FBufferedInput* Presses, int32 NumPresses);
+
+protected:
+	/** Ring of events. The oldest one is at Head */
+	FBufferedInput Events[Capacity];
+	int32 Head = 0;
+	int32 Count = 0;
+
+	/** Bits of the actions currently held */
+	uint16 HeldMask = 0;
+};
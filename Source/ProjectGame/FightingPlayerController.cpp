@@ -0,0 +1,10 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FightingPlayerController.h"
+#include "FightingCameraManager.h"
+
+AFightingPlayerController::AFightingPlayerController()
+{
+	PlayerCameraManagerClass = AFightingCameraManager::StaticClass();
+}
@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerController.h"
+#include "FightingPlayerController.generated.h"
+
+/**
+ * Player controller of the fighting game modes. Uses AFightingCameraManager to frame the fight.
+ */
+UCLASS()
+class PROJECTGAME_API AFightingPlayerController : public APlayerController
+{
+	GENERATED_BODY()
+
+public:
+	AFightingPlayerController();
+};
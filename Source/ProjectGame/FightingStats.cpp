@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FightingStats.h"
+
+DEFINE_STAT(STAT_FighterTick);
+DEFINE_STAT(STAT_RotateToTarget);
+DEFINE_STAT(STAT_FighterCamera);
+DEFINE_STAT(STAT_AttackOverlapBegin);
+DEFINE_STAT(STAT_WeaponSweep);
+DEFINE_STAT(STAT_InflictDamage);
+DEFINE_STAT(STAT_ReactionStart);
+DEFINE_STAT(STAT_HitboxUpdate);
+DEFINE_STAT(STAT_AIScheduler);
+
+DEFINE_STAT(STAT_FightingHits);
+DEFINE_STAT(STAT_FightingOverlaps);
+DEFINE_STAT(STAT_DamageBoxesActive);
+DEFINE_STAT(STAT_AIDecisions);
+DEFINE_STAT(STAT_AISkippedUpdates);
+
+CSV_DEFINE_CATEGORY_MODULE(PROJECTGAME_API, Fighting, true);
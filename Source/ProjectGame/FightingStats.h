@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+/**
+ * Stats of the fighting code, shown with "stat Fighting" and recorded in the Fighting category of -csvprofile captures.
+ * Timers are scoped with FIGHTING_SCOPE_CYCLE_COUNTER(Name) and per-frame counters incremented with FIGHTING_INC_COUNTER(Name),
+ * which feed both the stat STAT_<Name> and the CSV stat <Name>.
+ */
+DECLARE_STATS_GROUP(TEXT("Fighting"), STATGROUP_Fighting, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fighter Tick"), STAT_FighterTick, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rotate To Target"), STAT_RotateToTarget, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Camera Update"), STAT_FighterCamera, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Attack Overlap Begin"), STAT_AttackOverlapBegin, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Weapon Sweep"), STAT_WeaponSweep, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Inflict Damage"), STAT_InflictDamage, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Reaction Start"), STAT_ReactionStart, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Hitbox Update"), STAT_HitboxUpdate, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AI Scheduler"), STAT_AIScheduler, STATGROUP_Fighting, PROJECTGAME_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits"), STAT_FightingHits, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Overlaps"), STAT_FightingOverlaps, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Active Damage Boxes"), STAT_DamageBoxesActive, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("AI Decisions"), STAT_AIDecisions, STATGROUP_Fighting, PROJECTGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("AI Skipped Updates"), STAT_AISkippedUpdates, STATGROUP_Fighting, PROJECTGAME_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(PROJECTGAME_API, Fighting);
+
+/** Times the enclosing scope into STAT_<Stat> and the CSV stat <Stat> */
+#define FIGHTING_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(STAT_##Stat); \
+	CSV_SCOPED_TIMING_STAT(Fighting, Stat)
+
+/** Adds one to the per-frame counter STAT_<Stat> and to the CSV stat <Stat> */
+#define FIGHTING_INC_COUNTER(Stat) \
+	INC_DWORD_STAT(STAT_##Stat); \
+	CSV_CUSTOM_STAT(Fighting, Stat, 1, ECsvCustomStatOp::Accumulate)
+
+/** Adds Amount to the per-frame counter STAT_<Stat> and to the CSV stat <Stat> */
+#define FIGHTING_INC_COUNTER_BY(Stat, Amount) \
+	INC_DWORD_STAT_BY(STAT_##Stat, Amount); \
+	CSV_CUSTOM_STAT(Fighting, Stat, (int32)(Amount), ECsvCustomStatOp::Accumulate)
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FightingTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FightingCharacter.h"
+#include "CombatClock.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+FFightingTestWorld::FFightingTestWorld()
+{
+	World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& context = GEngine->CreateNewWorldContext(EWorldType::Game);
+	context.SetCurrentWorld(World);
+
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+}
+
+FFightingTestWorld::~FFightingTestWorld()
+{
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+}
+
+UCombatClock* FFightingTestWorld::GetCombatClock() const
+{
+	return World->GetSubsystem<UCombatClock>();
+}
+
+AFightingCharacter* FFightingTestWorld::SpawnFighter(const FVector& Location, float Yaw, UClass* FighterClass)
+{
+	if (FighterClass == NULL) FighterClass = AFightingCharacter::StaticClass();
+
+	FActorSpawnParameters spawnParameters;
+	spawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AFightingCharacter* fighter = World->SpawnActor<AFightingCharacter>(FighterClass, Location, FRotator(0.0f, Yaw, 0.0f), spawnParameters);
+	if (fighter == NULL) return NULL;
+
+	// Default pawns are possessed by an AI controller, and gravity would move them between steps
+	fighter->DetachFromControllerPendingDestroy();
+	fighter->GetCharacterMovement()->DisableMovement();
+	return fighter;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
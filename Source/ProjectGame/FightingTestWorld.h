@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class AFightingCharacter;
+class UCombatClock;
+
+/**
+ * Game world created for an automation test, with its world subsystems and begun play, so FightingCharacters can be spawned
+ * and stepped with the combat clock. Destroyed with the object.
+ */
+class FFightingTestWorld
+{
+public:
+	FFightingTestWorld();
+	~FFightingTestWorld();
+
+	FORCEINLINE UWorld* GetWorld() const { return World; }
+
+	/** Returns the combat clock of the world */
+	UCombatClock* GetCombatClock() const;
+
+	/**
+	 * Spawns a fighter without a controller, so only the test drives it
+	 *
+	 * @param Location		location of the fighter
+	 * @param Yaw			rotation of the fighter
+	 * @param FighterClass	class of the fighter, e.g. a Blueprint with the game meshes. AFightingCharacter if NULL
+	 * @return the fighter, or NULL if it could not be spawned
+	 */
+	AFightingCharacter* SpawnFighter(const FVector& Location, float Yaw, UClass* FighterClass = NULL);
+
+private:
+	UWorld* World;
+};
+
+#endif // WITH_DEV_AUTOMATION_TESTS
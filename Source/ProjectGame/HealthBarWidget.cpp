@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HealthBarWidget.h"
+#include "Blueprint/WidgetTree.h"
+#include "Components/InvalidationBox.h"
+#include "Components/VerticalBox.h"
+#include "Components/VerticalBoxSlot.h"
+#include "Components/HorizontalBox.h"
+#include "Components/HorizontalBoxSlot.h"
+#include "Components/SizeBox.h"
+#include "Components/ProgressBar.h"
+#include "Components/TextBlock.h"
+#include "Components/Image.h"
+
+bool UHealthBarWidget::Initialize()
+{
+	if (!Super::Initialize()) return false;
+
+	// Native instances have no layout of their own
+	if (WidgetTree != NULL && WidgetTree->RootWidget == NULL) BuildDefaultWidgetTree();
+
+	for (int32 part = 0; part < NumBodyParts; part++) BodyPartImages[part] = NULL;
+	BodyPartImages[(int32)EBodyPart::Head] = HeadImage;
+	BodyPartImages[(int32)EBodyPart::Torso] = TorsoImage;
+	BodyPartImages[(int32)EBodyPart::RightArm] = ArmRImage;
+	BodyPartImages[(int32)EBodyPart::LeftArm] = ArmLImage;
+	BodyPartImages[(int32)EBodyPart::RightLeg] = LegRImage;
+	BodyPartImages[(int32)EBodyPart::LeftLeg] = LegLImage;
+
+	return true;
+}
+
+void UHealthBarWidget::BuildDefaultWidgetTree()
+{
+	// Slate caches everything under the invalidation box until one of the widgets changes
+	UInvalidationBox* root = WidgetTree->ConstructWidget<UInvalidationBox>(UInvalidationBox::StaticClass(), TEXT("Root"));
+	root->SetCanCache(true);
+	WidgetTree->RootWidget = root;
+
+	USizeBox* size = WidgetTree->ConstructWidget<USizeBox>(USizeBox::StaticClass(), TEXT("Size"));
+	size->SetWidthOverride(240.0f);
+	root->AddChild(size);
+
+	UVerticalBox* column = WidgetTree->ConstructWidget<UVerticalBox>(UVerticalBox::StaticClass(), TEXT("Column"));
+	size->AddChild(column);
+
+	NameText = WidgetTree->ConstructWidget<UTextBlock>(UTextBlock::StaticClass(), TEXT("NameText"));
+	column->AddChildToVerticalBox(NameText);
+
+	HealthBar = WidgetTree->ConstructWidget<UProgressBar>(UProgressBar::StaticClass(), TEXT("HealthBar"));
+	column->AddChildToVerticalBox(HealthBar)->SetPadding(FMargin(0.0f, 2.0f));
+
+	UHorizontalBox* parts = WidgetTree->ConstructWidget<UHorizontalBox>(UHorizontalBox::StaticClass(), TEXT("BodyParts"));
+	column->AddChildToVerticalBox(parts);
+
+	auto addPart = [this, parts](const TCHAR* Name) {
+		UImage* image = WidgetTree->ConstructWidget<UImage>(UImage::StaticClass(), Name);
+		image->Brush.ImageSize = FVector2D(16.0f, 16.0f);
+		parts->AddChildToHorizontalBox(image)->SetPadding(FMargin(0.0f, 0.0f, 2.0f, 0.0f));
+		return image;
+	};
+	HeadImage = addPart(TEXT("HeadImage"));
+	TorsoImage = addPart(TEXT("TorsoImage"));
+	ArmRImage = addPart(TEXT("ArmRImage"));
+	ArmLImage = addPart(TEXT("ArmLImage"));
+	LegRImage = addPart(TEXT("LegRImage"));
+	LegLImage = addPart(TEXT("LegLImage"));
+
+	UHorizontalBox* stats = WidgetTree->ConstructWidget<UHorizontalBox>(UHorizontalBox::StaticClass(), TEXT("AttackStats"));
+	column->AddChildToVerticalBox(stats);
+
+	VelocityText = WidgetTree->ConstructWidget<UTextBlock>(UTextBlock::StaticClass(), TEXT("VelocityText"));
+	stats->AddChildToHorizontalBox(VelocityText)->SetPadding(FMargin(0.0f, 0.0f, 8.0f, 0.0f));
+
+	PointsText = WidgetTree->ConstructWidget<UTextBlock>(UTextBlock::StaticClass(), TEXT("PointsText"));
+	stats->AddChildToHorizontalBox(PointsText);
+}
+
+void UHealthBarWidget::NativeDestruct()
+{
+	UnbindAll();
+
+	Super::NativeDestruct();
+}
+
+void UHealthBarWidget::UnbindAll()
+{
+	if (Fighter == NULL) return;
+
+	Fighter->OnFighterDamaged.RemoveDynamic(this, &UHealthBarWidget::OnFighterDamaged);
+	Fighter->OnAttackStatsChanged.RemoveDynamic(this, &UHealthBarWidget::OnAttackStatsChanged);
+}
+
+void UHealthBarWidget::SetFighter(AFightingCharacter* InFighter)
+{
+	UnbindAll();
+	Fighter = InFighter;
+	if (Fighter != NULL) {
+		Fighter->OnFighterDamaged.AddDynamic(this, &UHealthBarWidget::OnFighterDamaged);
+		Fighter->OnAttackStatsChanged.AddDynamic(this, &UHealthBarWidget::OnAttackStatsChanged);
+	}
+
+	if (NameText != NULL) NameText->SetText(Fighter != NULL ? FText::FromString(Fighter->GetName()) : FText::GetEmpty());
+
+	// Everything is shown again for the new fighter
+	ShownHealth = -1.0f;
+	for (int32 part = 0; part < NumBodyParts; part++) ShownPotential[part] = -1.0f;
+	ShownImpactVel = -1.0f;
+	ShownPoints = -1;
+	Refresh();
+}
+
+void UHealthBarWidget::Refresh()
+{
+	RefreshHealth();
+	RefreshAttackStats();
+}
+
+void UHealthBarWidget::OnFighterDamaged(EBodyPart BodyPart, float Damage, float NewHealth, float ImpactVelocity)
+{
+	RefreshHealth();
+}
+
+void UHealthBarWidget::OnAttackStatsChanged()
+{
+	RefreshAttackStats();
+}
+
+void UHealthBarWidget::RefreshHealth()
+{
+	if (Fighter == NULL) return;
+
+	float health = Fighter->GetHealthPoints();
+	if (health != ShownHealth) {
+		ShownHealth = health;
+		if (HealthBar != NULL) {
+			HealthBar->SetPercent(health);
+			HealthBar->SetFillColorAndOpacity(FLinearColor::LerpUsingHSV(NoHealthColor, FullHealthColor, FMath::Clamp(health, 0.0f, 1.0f)));
+		}
+	}
+
+	for (int32 part = 0; part < NumBodyParts; part++) {
+		if (BodyPartImages[part] == NULL) continue;
+
+		// Damage potential goes from 1 to 3
+		float potential = Fighter->GetBodyPartDamagePotential((EBodyPart)part);
+		if (potential == ShownPotential[part]) continue;
+
+		ShownPotential[part] = potential;
+		BodyPartImages[part]->SetColorAndOpacity(FLinearColor::LerpUsingHSV(LowPotentialColor, HighPotentialColor,
+			FMath::Clamp((potential - 1.0f) * 0.5f, 0.0f, 1.0f)));
+	}
+}
+
+void UHealthBarWidget::RefreshAttackStats()
+{
+	if (Fighter == NULL) return;
+
+	// Texts are only formatted when the stats change
+	if (Fighter->LastAttackImpactVel != ShownImpactVel) {
+		ShownImpactVel = Fighter->LastAttackImpactVel;
+		if (VelocityText != NULL) VelocityText->SetText(FText::Format(NSLOCTEXT("HealthBar", "Velocity", "Velocity: {0}"), FText::AsNumber(FMath::RoundToInt(ShownImpactVel))));
+	}
+
+	if (Fighter->LastAttackPoints != ShownPoints) {
+		ShownPoints = Fighter->LastAttackPoints;
+		if (PointsText != NULL) PointsText->SetText(FText::Format(NSLOCTEXT("HealthBar", "Points", "Points: {0}"), FText::AsNumber(ShownPoints)));
+	}
+}
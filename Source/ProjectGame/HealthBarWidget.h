@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "FightingCharacter.h"
+#include "HealthBarWidget.generated.h"
+
+class UProgressBar;
+class UTextBlock;
+class UImage;
+
+/**
+ * Health bar of a FightingCharacter: its health, the damage potential of each body part and the stats of its last attack.
+ * Nothing is computed while painting: colors and texts are cached and only recomputed when the fighter broadcasts
+ * OnFighterDamaged or OnAttackStatsChanged, and the widgets are only touched when a cached value changes. The bar sits in an invalidation box,
+ * so Slate reuses its cached geometry in every frame without a hit.
+ * A Blueprint subclass can lay the bar out itself by naming its widgets like the BindWidgetOptional properties below.
+ * Otherwise a compact default layout is built.
+ */
+UCLASS()
+class PROJECTGAME_API UHealthBarWidget : public UUserWidget
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Sets the fighter shown by the bar and refreshes it
+	 *
+	 * @param InFighter		fighter to show, or NULL to clear the bar
+	 */
+	UFUNCTION(BlueprintCallable, Category = "UI HUD")
+	void SetFighter(AFightingCharacter* InFighter);
+
+	/** Returns the fighter shown by the bar */
+	FORCEINLINE AFightingCharacter* GetFighter() const { return Fighter; }
+
+	/** Recomputes the cached values from the fighter and updates the widgets whose value changed */
+	UFUNCTION(BlueprintCallable, Category = "UI HUD")
+	void Refresh();
+
+	//~ Begin UUserWidget Interface
+	virtual bool Initialize() override;
+	virtual void NativeDestruct() override;
+	//~ End UUserWidget Interface
+
+	/** Color of the health bar with full and with no health points */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Appearance)
+	FLinearColor FullHealthColor = FLinearColor(0.1f, 0.8f, 0.1f);
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Appearance)
+	FLinearColor NoHealthColor = FLinearColor(0.8f, 0.1f, 0.1f);
+
+	/** Color of a body part with the lowest (1) and the highest (3) damage potential */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Appearance)
+	FLinearColor LowPotentialColor = FLinearColor(0.9f, 0.9f, 0.9f);
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Appearance)
+	FLinearColor HighPotentialColor = FLinearColor(0.9f, 0.1f, 0.1f);
+
+protected:
+	/** Called when the shown fighter takes damage */
+	UFUNCTION()
+	void OnFighterDamaged(EBodyPart BodyPart, float Damage, float NewHealth, float ImpactVelocity);
+
+	/** Called when the stats of the last attack of the shown fighter change */
+	UFUNCTION()
+	void OnAttackStatsChanged();
+
+	/** Updates the health bar and the body parts if their values changed */
+	void RefreshHealth();
+
+	/** Updates the texts of the last attack if its stats changed */
+	void RefreshAttackStats();
+
+	/** Unbinds from the shown fighter */
+	void UnbindAll();
+
+	/** Builds the default layout, used if no Blueprint laid the bar out. Called in Initialize() */
+	void BuildDefaultWidgetTree();
+
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UTextBlock* NameText;
+
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UProgressBar* HealthBar;
+
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UImage* HeadImage;
+
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UImage* TorsoImage;
+
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UImage* ArmRImage;
+
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UImage* ArmLImage;
+
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UImage* LegRImage;
+
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UImage* LegLImage;
+
+	/** Impact velocity and points of the last attack of the shown fighter */
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UTextBlock* VelocityText;
+
+	UPROPERTY(BlueprintReadOnly, meta = (BindWidgetOptional))
+	UTextBlock* PointsText;
+
+	UPROPERTY(Transient)
+	AFightingCharacter* Fighter;
+
+	/** Image of each body part table entry. Chest shares the Torso entry and has none */
+	UImage* BodyPartImages[NumBodyParts];
+
+	/** Values shown by the widgets. Negative until first shown */
+	float ShownHealth = -1.0f;
+	float ShownPotential[NumBodyParts];
+	float ShownImpactVel = -1.0f;
+	int32 ShownPoints = -1;
+};
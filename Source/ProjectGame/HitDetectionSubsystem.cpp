@@ -0,0 +1,263 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitDetectionSubsystem.h"
+#include "FightingStats.h"
+#include "FightingCharacter.h"
+#include "HAL/IConsoleManager.h"
+#include "Components/BoxComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+
+static TAutoConsoleVariable<int32> CVarHitDetectionUseSubsystem(
+	TEXT("Fighting.HitDetection.UseSubsystem"),
+	1,
+	TEXT("1: FightingCharacters detect hits with the hit detection subsystem. 0: with the overlap events of their weapon boxes.\n")
+	TEXT("Read when a FightingCharacter begins play."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarHitDetectionLogStats(
+	TEXT("Fighting.HitDetection.LogStats"),
+	0,
+	TEXT("If 1, logs the number of tests run by the hit detection subsystem every frame with active weapon boxes."),
+	ECVF_Default);
+
+bool UHitDetectionSubsystem::IsEnabled()
+{
+	return CVarHitDetectionUseSubsystem.GetValueOnGameThread() != 0;
+}
+
+void UHitDetectionSubsystem::Deinitialize()
+{
+	Fighters.Empty();
+	ActiveFighters.Empty();
+	PreviousContacts.Empty();
+	CurrentContacts.Empty();
+	HitRecords.Empty();
+
+	Super::Deinitialize();
+}
+
+int32 UHitDetectionSubsystem::FindFighter(const AFightingCharacter* Fighter) const
+{
+	for (int32 i = 0; i < Fighters.Num(); i++) {
+		if (Fighters[i].Fighter == Fighter) return i;
+	}
+	return INDEX_NONE;
+}
+
+void UHitDetectionSubsystem::RegisterFighter(AFightingCharacter* Fighter)
+{
+	if (Fighter == NULL || FindFighter(Fighter) != INDEX_NONE) return;
+
+	int32 slot = FindFighter(NULL);
+	if (slot == INDEX_NONE) slot = Fighters.AddDefaulted();
+
+	FFighterEntry& entry = Fighters[slot];
+	entry = FFighterEntry();
+	entry.Fighter = Fighter;
+	for (UBoxComponent* box : Fighter->GetWeaponCollisionBoxes()) entry.WeaponBoxes.Add(box);
+	check(entry.WeaponBoxes.Num() <= 8);
+	for (UBoxComponent* box : Fighter->GetDamageCollisionBoxes()) {
+		entry.DamageBoxes.Add(box);
+		int32 weaponIndex = entry.WeaponBoxes.IndexOfByKey(box);
+		entry.DamageBoxWeaponBits.Add(weaponIndex != INDEX_NONE ? (uint8)(1 << weaponIndex) : 0);
+	}
+}
+
+void UHitDetectionSubsystem::UnregisterFighter(AFightingCharacter* Fighter)
+{
+	int32 slot = FindFighter(Fighter);
+	if (slot == INDEX_NONE) return;
+
+	Fighters[slot] = FFighterEntry();
+	ActiveFighters.Remove(slot);
+
+	// Contacts of a fighter that left are dropped without an end record
+	PreviousContacts.RemoveAll([slot](uint64 Key) {
+		return (int32)(Key >> 40) == slot || (int32)((Key >> 8) & 0xFFFF) == slot;
+	});
+}
+
+void UHitDetectionSubsystem::SetWeaponBoxesActive(AFightingCharacter* Fighter, uint8 WeaponMask, bool bActive)
+{
+	int32 slot = FindFighter(Fighter);
+	if (slot == INDEX_NONE) return;
+
+	FFighterEntry& entry = Fighters[slot];
+	if (bActive) entry.ActiveWeaponMask |= WeaponMask;
+	else entry.ActiveWeaponMask &= ~WeaponMask;
+
+	if (entry.ActiveWeaponMask != 0) {
+		if (!ActiveFighters.Contains(slot)) {
+			ActiveFighters.Add(slot);
+			ActiveFighters.Sort();
+		}
+	}
+	else ActiveFighters.Remove(slot);
+}
+
+const TArray<FOrientedBox>& UHitDetectionSubsystem::GetDamageOrientedBoxes(FFighterEntry& Entry)
+{
+	if (Entry.DamageOrientedBoxesPass != DetectionPass || Entry.DamageOrientedBoxes.Num() != Entry.DamageBoxes.Num()) {
+		Entry.DamageOrientedBoxes.SetNumUninitialized(Entry.DamageBoxes.Num(), false);
+		for (int32 i = 0; i < Entry.DamageBoxes.Num(); i++) {
+			Entry.DamageOrientedBoxes[i] = Entry.Fighter->GetDamageOrientedBox(i);
+		}
+		Entry.DamageOrientedBoxesPass = DetectionPass;
+	}
+	return Entry.DamageOrientedBoxes;
+}
+
+void UHitDetectionSubsystem::FindContacts()
+{
+	for (int32 attacker : ActiveFighters) {
+		FFighterEntry& attackerEntry = Fighters[attacker];
+
+		for (int32 weaponIndex = 0; weaponIndex < attackerEntry.WeaponBoxes.Num(); weaponIndex++) {
+			if ((attackerEntry.ActiveWeaponMask & (1 << weaponIndex)) == 0) continue;
+
+			FrameStats.ActiveWeaponBoxes++;
+			const FOrientedBox weapon = attackerEntry.Fighter->GetWeaponOrientedBox(weaponIndex);
+			const float weaponRadius = weapon.Extent.Size();
+
+			for (int32 victim = 0; victim < Fighters.Num(); victim++) {
+				FFighterEntry& victimEntry = Fighters[victim];
+				if (victim == attacker || victimEntry.Fighter == NULL) continue;
+
+				// Gated damage boxes are only kept up to date while an attacker is in reach
+				if (!victimEntry.Fighter->AreDamageBoxesActive()) continue;
+
+				// Broad phase: bounds of the victim's mesh, which contain all its damage boxes
+				FrameStats.BroadPhaseTests++;
+				const FBoxSphereBounds& bounds = victimEntry.Fighter->GetMesh()->Bounds;
+				float reach = weaponRadius + bounds.SphereRadius;
+				if (FVector::DistSquared(weapon.Center, bounds.Origin) > reach * reach) continue;
+
+				const TArray<FOrientedBox>& damageBoxes = GetDamageOrientedBoxes(victimEntry);
+				for (int32 damageIndex = 0; damageIndex < damageBoxes.Num(); damageIndex++) {
+					// Legs that are kicking are weapons, which weapons do not hit
+					if ((victimEntry.DamageBoxWeaponBits[damageIndex] & victimEntry.ActiveWeaponMask) != 0) continue;
+
+					const FOrientedBox& damage = damageBoxes[damageIndex];
+
+					FrameStats.NarrowPhaseTests++;
+					float boxReach = weaponRadius + damage.Extent.Size();
+					if (FVector::DistSquared(weapon.Center, damage.Center) > boxReach * boxReach) continue;
+
+					FrameStats.BoxTests++;
+					FBoxContact contact;
+					if (ComputeBoxContact(weapon, damage, contact)) {
+						FContact& current = CurrentContacts.AddDefaulted_GetRef();
+						current.Key = MakeContactKey(attacker, weaponIndex, victim, damageIndex);
+						current.ImpactPoint = contact.ImpactPoint;
+					}
+				}
+			}
+		}
+	}
+}
+
+void UHitDetectionSubsystem::BuildHitRecords()
+{
+	// Both lists are sorted, so contacts that began or ended are found by merging them
+	int32 previous = 0, current = 0;
+	while (previous < PreviousContacts.Num() || current < CurrentContacts.Num()) {
+		uint64 previousKey = previous < PreviousContacts.Num() ? PreviousContacts[previous] : MAX_uint64;
+		uint64 currentKey = current < CurrentContacts.Num() ? CurrentContacts[current].Key : MAX_uint64;
+		if (previousKey == currentKey) {
+			previous++;
+			current++;
+			continue;
+		}
+
+		bool bBegin = currentKey < previousKey;
+		uint64 key = bBegin ? currentKey : previousKey;
+
+		FHitRecord& record = HitRecords.AddDefaulted_GetRef();
+		record.Attacker = (uint16)(key >> 40);
+		record.WeaponBox = (uint8)((key >> 32) & 0xFF);
+		record.Victim = (uint16)((key >> 8) & 0xFFFF);
+		record.DamageBox = (uint8)(key & 0xFF);
+		record.bBegin = bBegin;
+
+		if (bBegin) {
+			record.ImpactPoint = CurrentContacts[current++].ImpactPoint;
+			FrameStats.BeginContacts++;
+			FIGHTING_INC_COUNTER(FightingOverlaps);
+		}
+		else {
+			record.ImpactPoint = FVector::ZeroVector;
+			previous++;
+			FrameStats.EndContacts++;
+		}
+	}
+
+	PreviousContacts.Reset();
+	for (const FContact& contact : CurrentContacts) PreviousContacts.Add(contact.Key);
+}
+
+void UHitDetectionSubsystem::DispatchHitRecords()
+{
+	for (const FHitRecord& record : HitRecords) {
+		AFightingCharacter* attacker = Fighters[record.Attacker].Fighter;
+		AFightingCharacter* victim = Fighters[record.Victim].Fighter;
+		// A fighter may unregister while the records are dispatched
+		if (attacker == NULL || victim == NULL) continue;
+
+		victim->IsDamageBoxOverlapping[record.DamageBox] = record.bBegin;
+		if (record.bBegin) {
+			attacker->RegisterAttackHit(Fighters[record.Attacker].WeaponBoxes[record.WeaponBox], victim,
+				Fighters[record.Victim].DamageBoxes[record.DamageBox], record.ImpactPoint);
+		}
+	}
+}
+
+void UHitDetectionSubsystem::Tick(float DeltaTime)
+{
+	// Boxes do not move while the world is paused, and contacts must not be dispatched
+	UWorld* World = GetWorld();
+	if (World == NULL || World->IsPaused()) return;
+
+	DetectHits();
+}
+
+void UHitDetectionSubsystem::DetectHits()
+{
+	// Resimulated frames are detected within one engine frame, each with the boxes moved by its step
+	DetectionPass++;
+
+	FrameStats = FHitDetectionFrameStats();
+	CurrentContacts.Reset();
+	HitRecords.Reset();
+
+	FindContacts();
+	BuildHitRecords();
+	DispatchHitRecords();
+
+	if (CVarHitDetectionLogStats.GetValueOnGameThread() != 0 && FrameStats.ActiveWeaponBoxes > 0) {
+		UE_LOG(LogTemp, Display, TEXT("HitDetection: %d active weapon boxes, %d broad phase, %d narrow phase, %d box tests, %d began, %d ended"),
+			FrameStats.ActiveWeaponBoxes, FrameStats.BroadPhaseTests, FrameStats.NarrowPhaseTests, FrameStats.BoxTests,
+			FrameStats.BeginContacts, FrameStats.EndContacts);
+	}
+}
+
+ETickableTickType UHitDetectionSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UHitDetectionSubsystem::IsTickable() const
+{
+	// Contacts of the previous frame still have to end after the last attack window closes
+	return ActiveFighters.Num() > 0 || PreviousContacts.Num() > 0;
+}
+
+UWorld* UHitDetectionSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UHitDetectionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHitDetectionSubsystem, STATGROUP_Fighting);
+}
@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "BoxContact.h"
+#include "HitDetectionSubsystem.generated.h"
+
+class AFightingCharacter;
+class UBoxComponent;
+
+/**
+ * Compact record of a contact between a Weapon Collision Box and a Damage Collision Box that began or ended this frame.
+ * Fighters and boxes are referenced by their index in the subsystem and in the fighter's collision box vectors.
+ */
+struct FHitRecord
+{
+	/** Slot of the attacking fighter */
+	uint16 Attacker;
+
+	/** Slot of the fighter being hit */
+	uint16 Victim;
+
+	/** Index of the weapon box in the attacker's WeaponCollisionBoxes */
+	uint8 WeaponBox;
+
+	/** Index of the damage box in the victim's DamageCollisionBoxes */
+	uint8 DamageBox;
+
+	/** True if the contact began this frame, false if it ended */
+	bool bBegin;
+
+	/** Point of impact. Only set if bBegin is true */
+	FVector ImpactPoint;
+};
+
+/** Number of tests run by the hit detection in one frame */
+struct FHitDetectionFrameStats
+{
+	/** Weapon boxes inside an attack window */
+	int32 ActiveWeaponBoxes = 0;
+
+	/** Weapon box against fighter bounds tests */
+	int32 BroadPhaseTests = 0;
+
+	/** Weapon box against damage box tests (bounding spheres) */
+	int32 NarrowPhaseTests = 0;
+
+	/** Weapon box against damage box Separating Axis Theorem tests */
+	int32 BoxTests = 0;
+
+	/** Contacts that began and ended this frame */
+	int32 BeginContacts = 0;
+	int32 EndContacts = 0;
+};
+
+/**
+ * Detects the hits between the Weapon Collision Boxes and the Damage Collision Boxes of all the FightingCharacters of a world,
+ * replacing the overlap events of the physics engine.
+ * Fighters register their collision boxes in BeginPlay() and tell the subsystem when an attack window opens or closes.
+ * Once per frame, after all actors have ticked, the subsystem tests only the weapon boxes inside an attack window:
+ * a broad phase against the bounds of the other fighters, then bounding spheres and ComputeBoxContact() against their damage boxes.
+ * Contacts are compared with those of the previous frame and dispatched as FHitRecords, so the cost grows with
+ * the number of active attacks instead of the number of collision boxes.
+ * Enabled with the console variable Fighting.HitDetection.UseSubsystem (read when a fighter begins play).
+ */
+UCLASS()
+class PROJECTGAME_API UHitDetectionSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns true if fighters should use the subsystem instead of overlap events */
+	static bool IsEnabled();
+
+	/**
+	 * Registers a fighter and its collision boxes. Called in AFightingCharacter::BeginPlay()
+	 *
+	 * @param Fighter	fighter to register. Its Weapon and Damage Collision Boxes must already be created
+	 */
+	void RegisterFighter(AFightingCharacter* Fighter);
+
+	/** Unregisters a fighter, dropping its contacts. Called in AFightingCharacter::EndPlay() */
+	void UnregisterFighter(AFightingCharacter* Fighter);
+
+	/**
+	 * Opens or closes the attack window of some of the fighter's Weapon Collision Boxes.
+	 *
+	 * @param Fighter		registered fighter
+	 * @param WeaponMask	bit i set for the box i of the fighter's WeaponCollisionBoxes
+	 * @param bActive		true to open the attack window, false to close it
+	 */
+	void SetWeaponBoxesActive(AFightingCharacter* Fighter, uint8 WeaponMask, bool bActive);
+
+	/**
+	 * Finds the contacts of this frame and dispatches the hits. Called every frame by Tick(), and by the rollback and replay
+	 * subsystems for each frame they resimulate, which may happen while the world is paused
+	 */
+	void DetectHits();
+
+	/** Returns the number of tests run in the last frame */
+	const FHitDetectionFrameStats& GetFrameStats() const { return FrameStats; }
+
+	//~ Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	//~ Begin FTickableGameObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject Interface
+
+protected:
+	/** Registered fighter and its collision boxes */
+	struct FFighterEntry
+	{
+		AFightingCharacter* Fighter = NULL;
+		TArray<UBoxComponent*> WeaponBoxes;
+		TArray<UBoxComponent*> DamageBoxes;
+
+		/** Bits of the weapon boxes inside an attack window */
+		uint8 ActiveWeaponMask = 0;
+
+		/**
+		 * Bit of the weapon box each damage box also is (the legs during a kick), or 0. A damage box is not hit while its weapon box
+		 * is inside an attack window, as the Weapon collision profile ignores the Weapon channel
+		 */
+		TArray<uint8> DamageBoxWeaponBits;
+
+		/** Oriented damage boxes, computed at most once per DetectHits() and only if a weapon gets close to the fighter */
+		TArray<FOrientedBox> DamageOrientedBoxes;
+		uint32 DamageOrientedBoxesPass = 0;
+	};
+
+	/** A contact of the current frame */
+	struct FContact
+	{
+		uint64 Key;
+		FVector ImpactPoint;
+	};
+
+	/** Packs a weapon box / damage box pair into a key that sorts by attacker, weapon box, victim and damage box */
+	static FORCEINLINE uint64 MakeContactKey(int32 Attacker, int32 WeaponBox, int32 Victim, int32 DamageBox)
+	{
+		return ((uint64)Attacker << 40) | ((uint64)WeaponBox << 32) | ((uint64)Victim << 8) | (uint64)DamageBox;
+	}
+
+	/** Returns the slot of a registered fighter, or INDEX_NONE */
+	int32 FindFighter(const AFightingCharacter* Fighter) const;
+
+	/** Returns the oriented damage boxes of a fighter, updating them if they are from a previous call to DetectHits() */
+	const TArray<FOrientedBox>& GetDamageOrientedBoxes(FFighterEntry& Entry);
+
+	/** Finds the contacts of all active weapon boxes and appends them to CurrentContacts, sorted by key */
+	void FindContacts();
+
+	/** Compares CurrentContacts with PreviousContacts and fills HitRecords */
+	void BuildHitRecords();
+
+	/** Applies the hit records to the fighters */
+	void DispatchHitRecords();
+
+	/** Registered fighters. Slots of unregistered fighters have a NULL Fighter and are reused */
+	TArray<FFighterEntry> Fighters;
+
+	/** Slots of the fighters with at least one weapon box inside an attack window, sorted */
+	TArray<int32> ActiveFighters;
+
+	/** Keys of the contacts of the previous frame, sorted */
+	TArray<uint64> PreviousContacts;
+
+	/** Contacts of the current frame, sorted by key */
+	TArray<FContact> CurrentContacts;
+
+	/** Contacts that began or ended this frame */
+	TArray<FHitRecord> HitRecords;
+
+	/** Number of calls to DetectHits(), which invalidates the oriented damage boxes of the previous call */
+	uint32 DetectionPass = 0;
+
+	/** Number of tests run in the last frame */
+	FHitDetectionFrameStats FrameStats;
+};
@@ -0,0 +1,194 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FightingTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FightingCharacter.h"
+#include "HitDetectionSubsystem.h"
+#include "BoxContact.h"
+#include "HAL/IConsoleManager.h"
+#include "Components/SkeletalMeshComponent.h"
+
+#include <algorithm>
+
+/** Fighter Blueprint with the game meshes, so the collision boxes follow the sockets of a skeleton */
+static const TCHAR* TestFighterClassPath = TEXT("/Game/FightingCharacter_BP.FightingCharacter_BP_C");
+
+/** Disables the proximity gating of the damage boxes while it exists, so the fighters spawned meanwhile keep their boxes active */
+class FScopedDamageBoxGatingDisabled
+{
+public:
+	FScopedDamageBoxGatingDisabled()
+	{
+		CVar = IConsoleManager::Get().FindConsoleVariable(TEXT("Fighting.HitDetection.GateDamageBoxes"));
+		PreviousValue = CVar != NULL ? CVar->GetInt() : 0;
+		if (CVar != NULL) CVar->Set(0, ECVF_SetByCode);
+	}
+
+	~FScopedDamageBoxGatingDisabled()
+	{
+		if (CVar != NULL) CVar->Set(PreviousValue, ECVF_SetByCode);
+	}
+
+private:
+	IConsoleVariable* CVar;
+	int32 PreviousValue;
+};
+
+/** Returns true if one of the weapon boxes in WeaponMask touches one of the damage boxes of the victim */
+static bool HasContact(AFightingCharacter* Attacker, uint8 WeaponMask, AFightingCharacter* Victim)
+{
+	for (int32 i = 0; i < NumWeaponBoxes; i++) {
+		if ((WeaponMask & (1 << i)) == 0) continue;
+
+		const FOrientedBox weapon = Attacker->GetWeaponOrientedBox(i);
+		for (int32 j = 0; j < NumDamageBoxes; j++) {
+			FBoxContact contact;
+			if (ComputeBoxContact(weapon, Victim->GetDamageOrientedBox(j), contact)) return true;
+		}
+	}
+	return false;
+}
+
+/** Returns true if one of the weapon boxes in WeaponMask passes the broad phase of the hit detection against the victim */
+static bool IsInBroadPhase(AFightingCharacter* Attacker, uint8 WeaponMask, AFightingCharacter* Victim)
+{
+	const FBoxSphereBounds& bounds = Victim->GetMesh()->Bounds;
+	for (int32 i = 0; i < NumWeaponBoxes; i++) {
+		if ((WeaponMask & (1 << i)) == 0) continue;
+
+		const FOrientedBox weapon = Attacker->GetWeaponOrientedBox(i);
+		float reach = weapon.Extent.Size() + bounds.SphereRadius;
+		if (FVector::DistSquared(weapon.Center, bounds.Origin) <= reach * reach) return true;
+	}
+	return false;
+}
+
+/** Returns true if one of the damage boxes of a fighter is overlapped by a weapon box */
+static bool IsAnyDamageBoxOverlapping(const AFightingCharacter* Fighter)
+{
+	for (int32 i = 0; i < NumDamageBoxes; i++) {
+		if (Fighter->IsDamageBoxOverlapping[i]) return true;
+	}
+	return false;
+}
+
+/** Moves a fighter outside of the world tick, as a rollback or a replay seek does, and updates its collision boxes */
+static void MoveFighter(AFightingCharacter* Fighter, const FVector& Location)
+{
+	Fighter->SetActorLocation(Location);
+	Fighter->ResimulateStep(0.0f);
+}
+
+/**
+ * Detects the hits of several frames within one engine frame, as a rollback or a replay seek does, with the victim moving
+ * between them. Each frame must test the damage boxes where they are in that frame.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHitDetectionResimulatedFramesTest, "ProjectGame.Fighting.HitDetection.ResimulatedFramesInOneTick",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHitDetectionResimulatedFramesTest::RunTest(const FString& Parameters)
+{
+	if (!UHitDetectionSubsystem::IsEnabled()) {
+		AddWarning(TEXT("Fighting.HitDetection.UseSubsystem is 0"));
+		return true;
+	}
+
+	UClass* fighterClass = LoadClass<AFightingCharacter>(NULL, TestFighterClassPath);
+	if (!TestNotNull(TEXT("Fighter class"), fighterClass)) return false;
+
+	FScopedDamageBoxGatingDisabled gatingDisabled;
+	FFightingTestWorld testWorld;
+	AFightingCharacter* attacker = testWorld.SpawnFighter(FVector::ZeroVector, 0.0f, fighterClass);
+	AFightingCharacter* victim = testWorld.SpawnFighter(FVector(1000.0f, 0.0f, 0.0f), 180.0f, fighterClass);
+	UHitDetectionSubsystem* hitDetection = testWorld.GetWorld()->GetSubsystem<UHitDetectionSubsystem>();
+	if (!TestNotNull(TEXT("Attacker"), attacker) || !TestNotNull(TEXT("Victim"), victim) || !TestNotNull(TEXT("Hit detection"), hitDetection)) return false;
+
+	// The fists are the first two weapon boxes
+	const uint8 fistsMask = 0x03;
+	attacker->PunchAttackStart();
+
+	// Hit: the first damage box of the victim is centered on the right fist
+	const FVector weaponCenter = attacker->GetWeaponOrientedBox(0).Center;
+	MoveFighter(victim, victim->GetActorLocation() + weaponCenter - victim->GetDamageOrientedBox(0).Center);
+	const FVector hitLocation = victim->GetActorLocation();
+
+	// Miss: moved back until no box touches, while still close enough for the damage boxes to be computed
+	const FVector away = (hitLocation - attacker->GetActorLocation()).GetSafeNormal2D();
+	FVector missLocation = hitLocation;
+	bool bFoundMiss = false;
+	for (float distance = 5.0f; distance <= 300.0f && !bFoundMiss; distance += 5.0f) {
+		missLocation = hitLocation + away * distance;
+		MoveFighter(victim, missLocation);
+		bFoundMiss = !HasContact(attacker, fistsMask, victim) && IsInBroadPhase(attacker, fistsMask, victim);
+	}
+	if (!TestTrue(TEXT("Found a victim location next to the fists that they do not touch"), bFoundMiss)) return false;
+
+	// First frame: missed, which computes the victim's damage boxes at the miss location
+	hitDetection->DetectHits();
+	TestFalse(TEXT("No contact in the first frame"), IsAnyDamageBoxOverlapping(victim));
+
+	// Second frame, same engine frame: the victim moved onto the fist
+	MoveFighter(victim, hitLocation);
+	TestTrue(TEXT("The fist touches the victim where it is"), HasContact(attacker, fistsMask, victim));
+	hitDetection->DetectHits();
+	TestTrue(TEXT("Contact detected in the second frame"), IsAnyDamageBoxOverlapping(victim));
+
+	// Third frame, same engine frame: the victim moved away again
+	MoveFighter(victim, missLocation);
+	hitDetection->DetectHits();
+	TestFalse(TEXT("Contact ended in the third frame"), IsAnyDamageBoxOverlapping(victim));
+	return true;
+}
+
+/**
+ * A leg of a fighter that is kicking is a weapon box, and the Weapon collision profile ignores the Weapon channel, so the leg
+ * is only hit once the kick is over.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHitDetectionKickingLegTest, "ProjectGame.Fighting.HitDetection.KickingLegIsNotHit",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FHitDetectionKickingLegTest::RunTest(const FString& Parameters)
+{
+	if (!UHitDetectionSubsystem::IsEnabled()) {
+		AddWarning(TEXT("Fighting.HitDetection.UseSubsystem is 0"));
+		return true;
+	}
+
+	UClass* fighterClass = LoadClass<AFightingCharacter>(NULL, TestFighterClassPath);
+	if (!TestNotNull(TEXT("Fighter class"), fighterClass)) return false;
+
+	FScopedDamageBoxGatingDisabled gatingDisabled;
+	FFightingTestWorld testWorld;
+	AFightingCharacter* attacker = testWorld.SpawnFighter(FVector::ZeroVector, 0.0f, fighterClass);
+	AFightingCharacter* victim = testWorld.SpawnFighter(FVector(1000.0f, 0.0f, 0.0f), 180.0f, fighterClass);
+	UHitDetectionSubsystem* hitDetection = testWorld.GetWorld()->GetSubsystem<UHitDetectionSubsystem>();
+	if (!TestNotNull(TEXT("Attacker"), attacker) || !TestNotNull(TEXT("Victim"), victim) || !TestNotNull(TEXT("Hit detection"), hitDetection)) return false;
+
+	// The right leg is both a weapon box and a damage box
+	const std::vector<UBoxComponent*>& damageBoxes = victim->GetDamageCollisionBoxes();
+	const std::vector<UBoxComponent*>& weaponBoxes = victim->GetWeaponCollisionBoxes();
+	int32 legIndex = INDEX_NONE;
+	for (int32 i = 0; i < (int32)damageBoxes.size() && legIndex == INDEX_NONE; i++) {
+		if (std::find(weaponBoxes.begin(), weaponBoxes.end(), damageBoxes[i]) != weaponBoxes.end()) legIndex = i;
+	}
+	if (!TestTrue(TEXT("A damage box of the victim is also a weapon box"), legIndex != INDEX_NONE)) return false;
+
+	// The leg of the victim is centered on the right fist of the attacker
+	attacker->PunchAttackStart();
+	victim->KickAttackStart();
+	const FVector weaponCenter = attacker->GetWeaponOrientedBox(0).Center;
+	MoveFighter(victim, victim->GetActorLocation() + weaponCenter - victim->GetDamageOrientedBox(legIndex).Center);
+
+	hitDetection->DetectHits();
+	TestFalse(TEXT("The kicking leg is not hit"), victim->IsDamageBoxOverlapping[legIndex]);
+
+	victim->KickAttackEnd();
+	hitDetection->DetectHits();
+	TestTrue(TEXT("The leg is hit once the kick is over"), victim->IsDamageBoxOverlapping[legIndex]);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
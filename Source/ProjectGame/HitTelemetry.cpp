@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitTelemetry.h"
+#include "CombatClock.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+
+static TAutoConsoleVariable<int32> CVarHitTelemetry(
+	TEXT("Fighting.Telemetry.Hits"),
+	0,
+	TEXT("1: every hit is recorded into Saved/Telemetry/Hits-<time>.bin. 0: hits are not recorded.\n")
+	TEXT("Read when the game instance starts."),
+	ECVF_Default);
+
+/** Drains the ring of hits into the telemetry file on its own thread */
+class FHitTelemetryWriter : public FRunnable
+{
+public:
+	/** Number of hits the ring can hold. A fight produces a few hits per second, so the writer has seconds to catch up */
+	static const uint32 Capacity = 4096;
+
+	/** How often the ring is drained, in seconds */
+	static constexpr float DrainInterval = 0.1f;
+
+	FHitTelemetryWriter(FArchive* InFile)
+		: Queue(Capacity)
+		, File(InFile)
+	{
+		WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		Thread = FRunnableThread::Create(this, TEXT("HitTelemetryWriter"), 0, TPri_BelowNormal);
+	}
+
+	virtual ~FHitTelemetryWriter()
+	{
+		bStopping = true;
+		WakeEvent->Trigger();
+		if (Thread != NULL) {
+			Thread->WaitForCompletion();
+			delete Thread;
+		}
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+
+		// Hits pushed after the thread stopped
+		Drain();
+		delete File;
+	}
+
+	/** Pushes a hit. Only called by the game thread */
+	FORCEINLINE bool Push(const FHitTelemetryRecord& Record) { return Queue.Enqueue(Record); }
+
+	//~ Begin FRunnable Interface
+	virtual uint32 Run() override
+	{
+		while (!bStopping) {
+			Drain();
+			WakeEvent->Wait(FTimespan::FromSeconds(DrainInterval));
+		}
+		return 0;
+	}
+	//~ End FRunnable Interface
+
+protected:
+	/** Writes all the hits in the ring to the file */
+	void Drain()
+	{
+		bool bWritten = false;
+		FHitTelemetryRecord Record;
+		while (Queue.Dequeue(Record)) {
+			File->Serialize(&Record, sizeof(Record));
+			bWritten = true;
+		}
+		if (bWritten) File->Flush();
+	}
+
+	TCircularQueue<FHitTelemetryRecord> Queue;
+	FArchive* File;
+	FEvent* WakeEvent = NULL;
+	FRunnableThread* Thread = NULL;
+	TAtomic<bool> bStopping { false };
+};
+
+UHitTelemetrySubsystem* UHitTelemetrySubsystem::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	UGameInstance* GameInstance = World != NULL ? World->GetGameInstance() : NULL;
+	UHitTelemetrySubsystem* Telemetry = GameInstance != NULL ? GameInstance->GetSubsystem<UHitTelemetrySubsystem>() : NULL;
+	return Telemetry != NULL && Telemetry->Writer != NULL ? Telemetry : NULL;
+}
+
+void UHitTelemetrySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (CVarHitTelemetry.GetValueOnGameThread() == 0 || !FPlatformProcess::SupportsMultithreading()) return;
+
+	const FDateTime Now = FDateTime::UtcNow();
+	const FString Path = FPaths::ProjectSavedDir() / TEXT("Telemetry") / FString::Printf(TEXT("Hits-%s.bin"), *Now.ToString());
+	FArchive* File = IFileManager::Get().CreateFileWriter(*Path);
+	if (File == NULL) {
+		UE_LOG(LogTemp, Warning, TEXT("Hit telemetry: could not create %s"), *Path);
+		return;
+	}
+
+	FHitTelemetryFileHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = FHitTelemetryFileHeader::FileMagic;
+	Header.Version = FHitTelemetryFileHeader::CurrentVersion;
+	Header.RecordSize = sizeof(FHitTelemetryRecord);
+	Header.TickRate = UCombatClock::TickRate;
+	Header.StartTicks = Now.GetTicks();
+	File->Serialize(&Header, sizeof(Header));
+
+	Writer = new FHitTelemetryWriter(File);
+}
+
+void UHitTelemetrySubsystem::Deinitialize()
+{
+	if (Writer != NULL) {
+		delete Writer;
+		Writer = NULL;
+		if (NumDropped > 0) UE_LOG(LogTemp, Warning, TEXT("Hit telemetry: %d hits dropped"), NumDropped);
+	}
+	Super::Deinitialize();
+}
+
+void UHitTelemetrySubsystem::RecordHit(const FHitTelemetryRecord& Record)
+{
+	if (Writer != NULL && !Writer->Push(Record)) NumDropped++;
+}
@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "HitTelemetry.generated.h"
+
+class FHitTelemetryWriter;
+
+/** One hit, as written to the hit telemetry file. Plain data written as is, so its layout is part of the file format */
+struct FHitTelemetryRecord
+{
+	/** Bits of Flags */
+	enum EFlag : uint8
+	{
+		/** The hit did no damage (blocked, or the body part was in its damage cooldown) */
+		NoDamage = 1 << 0,
+		/** The victim was defeated by the hit */
+		Defeated = 1 << 1
+	};
+
+	/** Combat frame of the hit. @see UCombatClock */
+	int32 Frame;
+
+	/** Unique ids (UObject::GetUniqueID()) of the attacking and of the hit fighters */
+	uint32 AttackerId;
+	uint32 VictimId;
+
+	/** Id of the attack in the attacker's AttackCatalog, or INDEX_NONE */
+	int16 AttackId;
+
+	/** EBodyPart hit */
+	uint8 BodyPart;
+
+	/** EFlag bits */
+	uint8 Flags;
+
+	float ImpactVel;
+	float Damage;
+
+	/** DamagePotential of the body part and health of the victim after the hit */
+	float PotentialAfter;
+	float HealthAfter;
+};
+
+static_assert(sizeof(FHitTelemetryRecord) == 32, "FHitTelemetryRecord is part of the hit telemetry file format");
+
+/** Header at the start of a hit telemetry file, followed by FHitTelemetryRecords up to the end of the file */
+struct FHitTelemetryFileHeader
+{
+	/** 'FHIT' */
+	static const uint32 FileMagic = 0x54494846;
+
+	/** Incremented whenever FHitTelemetryRecord changes */
+	static const uint16 CurrentVersion = 1;
+
+	uint32 Magic;
+	uint16 Version;
+
+	/** sizeof(FHitTelemetryRecord) when the file was written */
+	uint16 RecordSize;
+
+	/** Combat frames per second when the file was written */
+	int32 TickRate;
+	int32 Padding;
+
+	/** UTC time the file was created, in FDateTime ticks */
+	int64 StartTicks;
+};
+
+static_assert(sizeof(FHitTelemetryFileHeader) == 24, "FHitTelemetryFileHeader is part of the hit telemetry file format");
+
+/**
+ * Records every hit into Saved/Telemetry/Hits-<time>.bin.
+ * The game thread pushes each hit into a lock-free single producer single consumer ring, which costs a copy of 32 bytes,
+ * and a background thread drains the ring into the file. If the ring is full the hit is dropped and counted.
+ * The file can be converted to CSV with the HitTelemetryToCsv commandlet.
+ * Enabled with the console variable Fighting.Telemetry.Hits (read when the game instance starts). Hits of the frames
+ * resimulated by a rollback are not recorded again.
+ */
+UCLASS()
+class PROJECTGAME_API UHitTelemetrySubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns the hit telemetry of the game instance of an object, or NULL if it is disabled */
+	static UHitTelemetrySubsystem* Get(const UObject* WorldContextObject);
+
+	/** Records a hit. Called on the game thread */
+	void RecordHit(const FHitTelemetryRecord& Record);
+
+	/** Returns the number of hits dropped because the ring was full */
+	int32 GetNumDropped() const { return NumDropped; }
+
+	//~ Begin USubsystem Interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+protected:
+	/** Background writer. NULL if telemetry is disabled or the file could not be created */
+	FHitTelemetryWriter* Writer = NULL;
+
+	int32 NumDropped = 0;
+};
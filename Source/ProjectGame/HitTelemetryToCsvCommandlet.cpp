@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitTelemetryToCsvCommandlet.h"
+#include "HitTelemetry.h"
+#include "FightingCharacter.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+
+UHitTelemetryToCsvCommandlet::UHitTelemetryToCsvCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UHitTelemetryToCsvCommandlet::Main(const FString& Params)
+{
+	FString InPath, OutPath;
+	if (!FParse::Value(*Params, TEXT("In="), InPath)) {
+		UE_LOG(LogTemp, Error, TEXT("Usage: -run=HitTelemetryToCsv -In=<Hits.bin> [-Out=<Hits.csv>]"));
+		return 1;
+	}
+	if (!FParse::Value(*Params, TEXT("Out="), OutPath)) OutPath = FPaths::ChangeExtension(InPath, TEXT("csv"));
+
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *InPath)) {
+		UE_LOG(LogTemp, Error, TEXT("Could not read %s"), *InPath);
+		return 1;
+	}
+
+	FHitTelemetryFileHeader Header;
+	if (Data.Num() < (int32)sizeof(Header)) {
+		UE_LOG(LogTemp, Error, TEXT("%s is not a hit telemetry file"), *InPath);
+		return 1;
+	}
+	FMemory::Memcpy(&Header, Data.GetData(), sizeof(Header));
+	if (Header.Magic != FHitTelemetryFileHeader::FileMagic) {
+		UE_LOG(LogTemp, Error, TEXT("%s is not a hit telemetry file"), *InPath);
+		return 1;
+	}
+	if (Header.Version != FHitTelemetryFileHeader::CurrentVersion || Header.RecordSize != sizeof(FHitTelemetryRecord)) {
+		UE_LOG(LogTemp, Error, TEXT("%s has version %d (record size %d), this reader supports version %d (record size %d)"),
+			*InPath, Header.Version, Header.RecordSize, FHitTelemetryFileHeader::CurrentVersion, (int32)sizeof(FHitTelemetryRecord));
+		return 1;
+	}
+
+	static const TCHAR* BodyPartNames[] = { TEXT("Head"), TEXT("Chest"), TEXT("Torso"), TEXT("RightArm"), TEXT("LeftArm"), TEXT("RightLeg"), TEXT("LeftLeg") };
+	static_assert(ARRAY_COUNT(BodyPartNames) == NumBodyParts, "One name per EBodyPart");
+
+	const int32 NumRecords = (Data.Num() - sizeof(Header)) / sizeof(FHitTelemetryRecord);
+	const float StepTime = 1.0f / FMath::Max(Header.TickRate, 1);
+
+	FString Csv = TEXT("Frame,Seconds,AttackerId,VictimId,AttackId,BodyPart,ImpactVel,Damage,PotentialAfter,HealthAfter,NoDamage,Defeated") LINE_TERMINATOR;
+	for (int32 i = 0; i < NumRecords; i++) {
+		FHitTelemetryRecord Record;
+		FMemory::Memcpy(&Record, Data.GetData() + sizeof(Header) + i * sizeof(FHitTelemetryRecord), sizeof(Record));
+
+		Csv += FString::Printf(TEXT("%d,%.4f,%u,%u,%d,%s,%.2f,%.6f,%.4f,%.6f,%d,%d") LINE_TERMINATOR,
+			Record.Frame, Record.Frame * StepTime, Record.AttackerId, Record.VictimId, Record.AttackId,
+			Record.BodyPart < NumBodyParts ? BodyPartNames[Record.BodyPart] : TEXT("None"),
+			Record.ImpactVel, Record.Damage, Record.PotentialAfter, Record.HealthAfter,
+			(Record.Flags & FHitTelemetryRecord::NoDamage) ? 1 : 0, (Record.Flags & FHitTelemetryRecord::Defeated) ? 1 : 0);
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *OutPath)) {
+		UE_LOG(LogTemp, Error, TEXT("Could not write %s"), *OutPath);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("%d hits recorded on %s written to %s"), NumRecords, *FDateTime(Header.StartTicks).ToString(), *OutPath);
+	return 0;
+}
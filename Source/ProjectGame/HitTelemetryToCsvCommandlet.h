@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "HitTelemetryToCsvCommandlet.generated.h"
+
+/**
+ * Converts a hit telemetry file written by UHitTelemetrySubsystem to CSV.
+ * Usage: UE4Editor-Cmd ProjectGame -run=HitTelemetryToCsv -In=<Hits.bin> [-Out=<Hits.csv>]
+ * If -Out is not given, the CSV is written next to the input file.
+ */
+UCLASS()
+class UHitTelemetryToCsvCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UHitTelemetryToCsvCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
@@ -0,0 +1,219 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitboxComponent.h"
+#include "FightingStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/SkeletalMeshSocket.h"
+#include "PrimitiveSceneProxy.h"
+#include "SceneManagement.h"
+
+static TAutoConsoleVariable<int32> CVarHitboxUseComponent(
+	TEXT("Fighting.Hitbox.UseComponent"),
+	1,
+	TEXT("1: FightingCharacters update their collision boxes with a single hitbox component, and unregister their box components.\n")
+	TEXT("0: with one box component attached to the mesh per box. Only used with Fighting.HitDetection.UseSubsystem.\n")
+	TEXT("Read when a FightingCharacter begins play."),
+	ECVF_Default);
+
+/** Draws the boxes of a hitbox component as wireframes */
+class FHitboxSceneProxy final : public FPrimitiveSceneProxy
+{
+public:
+	FHitboxSceneProxy(const UHitboxComponent* InComponent)
+		: FPrimitiveSceneProxy(InComponent)
+		, Color(InComponent->BoxColor)
+	{
+		bWillEverBeLit = false;
+	}
+
+	virtual SIZE_T GetTypeHash() const override
+	{
+		static size_t UniquePointer;
+		return reinterpret_cast<size_t>(&UniquePointer);
+	}
+
+	/** Sets the world space boxes to draw */
+	void SetBoxes_RenderThread(TArray<FOrientedBox>&& InBoxes)
+	{
+		Boxes = MoveTemp(InBoxes);
+	}
+
+	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+	{
+		for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++) {
+			if ((VisibilityMap & (1 << ViewIndex)) == 0) continue;
+
+			FPrimitiveDrawInterface* PDI = Collector.GetPDI(ViewIndex);
+			for (const FOrientedBox& Box : Boxes) {
+				DrawOrientedWireBox(PDI, Box.Center, Box.Axes[0], Box.Axes[1], Box.Axes[2], Box.Extent, Color, SDPG_World);
+			}
+		}
+	}
+
+	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+	{
+		FPrimitiveViewRelevance Result;
+		Result.bDrawRelevance = IsShown(View);
+		Result.bDynamicRelevance = true;
+		Result.bShadowRelevance = false;
+		Result.bEditorPrimitiveRelevance = UseEditorCompositing(View);
+		return Result;
+	}
+
+	virtual uint32 GetMemoryFootprint() const override { return sizeof(*this) + GetAllocatedSize(); }
+
+	uint32 GetAllocatedSize() const { return FPrimitiveSceneProxy::GetAllocatedSize() + Boxes.GetAllocatedSize(); }
+
+private:
+	TArray<FOrientedBox> Boxes;
+	const FLinearColor Color;
+};
+
+UHitboxComponent::UHitboxComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	SetCollisionProfileName(TEXT("NoCollision"));
+	SetGenerateOverlapEvents(false);
+	CanCharacterStepUpOn = ECB_No;
+	CastShadow = false;
+	bUseAttachParentBound = false;
+
+	BoxesBounds = FBox(ForceInit);
+	BoundMesh = NULL;
+}
+
+bool UHitboxComponent::IsEnabled()
+{
+	return CVarHitboxUseComponent.GetValueOnGameThread() != 0;
+}
+
+int32 UHitboxComponent::AddBox(FName SocketName, const FVector& Extent, const FVector& Scale)
+{
+	FHitbox& box = Boxes.AddDefaulted_GetRef();
+	box.SocketName = SocketName;
+	box.Extent = Extent;
+	box.Scale = Scale;
+
+	BoxTransforms.Add(FTransform::Identity);
+	OrientedBoxes.Add(FOrientedBox(FTransform::Identity, Extent * Scale));
+	return Boxes.Num() - 1;
+}
+
+void UHitboxComponent::ClearBoxes()
+{
+	Boxes.Empty();
+	BoxTransforms.Empty();
+	OrientedBoxes.Empty();
+	BoxesBounds = FBox(ForceInit);
+}
+
+bool UHitboxComponent::BindToMesh(USkeletalMeshComponent* Mesh)
+{
+	if (BoundMesh != NULL) RemoveTickPrerequisiteComponent(BoundMesh);
+	BoundMesh = NULL;
+	SetComponentTickEnabled(false);
+
+	if (Mesh == NULL || Mesh->SkeletalMesh == NULL) return false;
+
+	bool bFoundAll = true;
+	for (FHitbox& box : Boxes) {
+		// A box is bound to a socket, or directly to a bone if there is no socket of that name
+		FName boneName = box.SocketName;
+		box.SocketTransform = FTransform::Identity;
+		if (const USkeletalMeshSocket* socket = Mesh->SkeletalMesh->FindSocket(box.SocketName)) {
+			boneName = socket->BoneName;
+			box.SocketTransform = socket->GetSocketLocalTransform();
+		}
+
+		box.BoneIndex = Mesh->GetBoneIndex(boneName);
+		if (box.BoneIndex == INDEX_NONE) {
+			UE_LOG(LogTemp, Warning, TEXT("%s: socket or bone %s not found in %s"), *GetName(), *box.SocketName.ToString(), *Mesh->SkeletalMesh->GetName());
+			bFoundAll = false;
+		}
+	}
+
+	// The boxes follow the bone transforms of the mesh once it is done animating
+	BoundMesh = Mesh;
+	AddTickPrerequisiteComponent(Mesh);
+	SetComponentTickEnabled(true);
+	UpdateBoxes();
+
+	return bFoundAll;
+}
+
+void UHitboxComponent::UpdateBoxes()
+{
+	if (BoundMesh == NULL) return;
+
+	FIGHTING_SCOPE_CYCLE_COUNTER(HitboxUpdate);
+
+	const TArray<FTransform>& boneTransforms = BoundMesh->GetComponentSpaceTransforms();
+	if (boneTransforms.Num() == 0) return;
+
+	const FTransform& meshTransform = BoundMesh->GetComponentTransform();
+	BoxesBounds = FBox(ForceInit);
+
+	for (int32 i = 0; i < Boxes.Num(); i++) {
+		const FHitbox& box = Boxes[i];
+		if (!box.bActive || !boneTransforms.IsValidIndex(box.BoneIndex)) continue;
+
+		// Same transform as a component attached to the socket, keeping its world scale
+		FTransform transform = box.SocketTransform * boneTransforms[box.BoneIndex] * meshTransform;
+		transform.SetScale3D(box.Scale);
+		BoxTransforms[i] = transform;
+
+		const FOrientedBox& oriented = OrientedBoxes[i] = FOrientedBox(transform, box.Extent);
+		const FVector reach = oriented.Axes[0].GetAbs() * oriented.Extent.X + oriented.Axes[1].GetAbs() * oriented.Extent.Y
+			+ oriented.Axes[2].GetAbs() * oriented.Extent.Z;
+		BoxesBounds += oriented.Center + reach;
+		BoxesBounds += oriented.Center - reach;
+	}
+
+	if (IsRegistered()) {
+		UpdateBounds();
+		MarkRenderTransformDirty();
+		MarkRenderDynamicDataDirty();
+	}
+}
+
+void UHitboxComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	UpdateBoxes();
+}
+
+void UHitboxComponent::SendRenderDynamicData_Concurrent()
+{
+	Super::SendRenderDynamicData_Concurrent();
+
+	if (SceneProxy != NULL) {
+		FHitboxSceneProxy* proxy = static_cast<FHitboxSceneProxy*>(SceneProxy);
+		TArray<FOrientedBox> boxes = OrientedBoxes;
+		ENQUEUE_RENDER_COMMAND(UpdateHitboxes)(
+			[proxy, boxes = MoveTemp(boxes)](FRHICommandListImmediate& RHICmdList) mutable
+		{
+			proxy->SetBoxes_RenderThread(MoveTemp(boxes));
+		});
+	}
+}
+
+FPrimitiveSceneProxy* UHitboxComponent::CreateSceneProxy()
+{
+	FHitboxSceneProxy* proxy = new FHitboxSceneProxy(this);
+	TArray<FOrientedBox> boxes = OrientedBoxes;
+	proxy->SetBoxes_RenderThread(MoveTemp(boxes));
+	return proxy;
+}
+
+FBoxSphereBounds UHitboxComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	// The boxes are in world space already
+	if (BoxesBounds.IsValid) return FBoxSphereBounds(BoxesBounds);
+	return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0f);
+}
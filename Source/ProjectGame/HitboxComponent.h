@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+#include "BoxContact.h"
+#include "HitboxComponent.generated.h"
+
+class USkeletalMeshComponent;
+
+/**
+ * Set of oriented boxes bound to sockets of a skeletal mesh, updated together in one pass from the component space bone
+ * transforms of the mesh. Has no physics body and generates no overlaps: the boxes are queried directly, e.g. by
+ * UHitDetectionSubsystem. Replaces one attached UBoxComponent per box, each with its own transform propagation,
+ * physics body and overlap registration.
+ * The boxes are updated after the mesh finished its animation every frame, and can be updated on demand with UpdateBoxes().
+ * Enabled for FightingCharacters with the console variable Fighting.Hitbox.UseComponent (read when a fighter begins play).
+ */
+UCLASS(ClassGroup = Collision, meta = (BlueprintSpawnableComponent))
+class PROJECTGAME_API UHitboxComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+public:
+	UHitboxComponent();
+
+	/** Returns true if fighters should use a hitbox component instead of their box components */
+	static bool IsEnabled();
+
+	/**
+	 * Adds a box. The boxes must be added before BindToMesh().
+	 *
+	 * @param SocketName	socket or bone the box is centered and oriented on
+	 * @param Extent		unscaled half size of the box
+	 * @param Scale			world scale of the box
+	 * @return index of the box
+	 */
+	int32 AddBox(FName SocketName, const FVector& Extent, const FVector& Scale);
+
+	/** Removes all boxes */
+	void ClearBoxes();
+
+	/**
+	 * Resolves the bones and socket offsets of the boxes in a mesh, and starts updating the boxes after the mesh ticks.
+	 * Returns false if a socket or bone is not found in the mesh.
+	 */
+	bool BindToMesh(USkeletalMeshComponent* Mesh);
+
+	/** Returns true if the boxes are bound to a mesh */
+	FORCEINLINE bool IsBound() const { return BoundMesh != NULL; }
+
+	/** Updates the world transform of the active boxes from the current bone transforms of the mesh */
+	void UpdateBoxes();
+
+	/**
+	 * Activates or deactivates a box. Inactive boxes are skipped by UpdateBoxes() and keep their last transform.
+	 * A box that gets activated is updated on the next call to UpdateBoxes().
+	 */
+	FORCEINLINE void SetBoxActive(int32 Index, bool bActive) { Boxes[Index].bActive = bActive; }
+
+	/** Returns true if a box is updated by UpdateBoxes() */
+	FORCEINLINE bool IsBoxActive(int32 Index) const { return Boxes[Index].bActive; }
+
+	FORCEINLINE int32 GetNumBoxes() const { return Boxes.Num(); }
+
+	/** Returns the world transform of a box, as of the last update */
+	FORCEINLINE const FTransform& GetBoxTransform(int32 Index) const { return BoxTransforms[Index]; }
+
+	/** Returns the unscaled half size of a box */
+	FORCEINLINE const FVector& GetBoxExtent(int32 Index) const { return Boxes[Index].Extent; }
+
+	/** Returns a box in world space, as of the last update */
+	FORCEINLINE const FOrientedBox& GetOrientedBox(int32 Index) const { return OrientedBoxes[Index]; }
+
+	/** Returns the world bounding box of all boxes, as of the last update */
+	FORCEINLINE const FBox& GetBoxesBounds() const { return BoxesBounds; }
+
+	//~ Begin UActorComponent Interface
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void SendRenderDynamicData_Concurrent() override;
+	//~ End UActorComponent Interface
+
+	//~ Begin UPrimitiveComponent Interface
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	//~ End UPrimitiveComponent Interface
+
+	//~ Begin USceneComponent Interface
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	//~ End USceneComponent Interface
+
+	/** Color the boxes are drawn with when the component is visible */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Shape)
+	FColor BoxColor = FColor(255, 0, 0);
+
+protected:
+	/** A box and the bone it follows */
+	struct FHitbox
+	{
+		FName SocketName;
+		FVector Extent;
+		FVector Scale;
+
+		/** Index of the bone in the mesh, and transform of the socket relative to the bone */
+		int32 BoneIndex = INDEX_NONE;
+		FTransform SocketTransform;
+
+		/** Whether the box is updated with the mesh */
+		bool bActive = true;
+	};
+
+	TArray<FHitbox> Boxes;
+
+	/** World transform and oriented box of each box, and their bounds */
+	TArray<FTransform> BoxTransforms;
+	TArray<FOrientedBox> OrientedBoxes;
+	FBox BoxesBounds;
+
+	UPROPERTY()
+	USkeletalMeshComponent* BoundMesh;
+};
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LimbVelocitySampler.h"
+
+FLimbVelocitySampler::FLimbVelocitySampler()
+{
+	Reset(0.0f, FVector::ZeroVector);
+}
+
+void FLimbVelocitySampler::Reset(float Time, const FVector& Position)
+{
+	Head = Capacity - 1;
+	NumSamples = 0;
+	PushSample(Time, Position);
+
+	LastPoseTime = Time;
+	LastPosePosition = Position;
+	NextSampleTime = Time + 1.0f / SampleRate;
+	PeakVelocity = 0.0f;
+}
+
+void FLimbVelocitySampler::PushSample(float Time, const FVector& Position)
+{
+	Head = (Head + 1) % Capacity;
+	SampleTimes[Head] = Time;
+	SamplePositions[Head] = Position;
+	if (NumSamples < Capacity) NumSamples++;
+}
+
+void FLimbVelocitySampler::AddPose(float Time, const FVector& Position)
+{
+	if (Time <= LastPoseTime) return;
+
+	// After a long hitch only the last Capacity samples would be kept anyway
+	const float SampleInterval = 1.0f / SampleRate;
+	if (Time - NextSampleTime > Capacity * SampleInterval) {
+		NextSampleTime = Time - (Capacity - 1) * SampleInterval;
+	}
+
+	// Resample the movement since the last pose at the fixed sample rate
+	while (NextSampleTime <= Time) {
+		float Alpha = (NextSampleTime - LastPoseTime) / (Time - LastPoseTime);
+		PushSample(NextSampleTime, FMath::Lerp(LastPosePosition, Position, FMath::Max(Alpha, 0.0f)));
+		NextSampleTime += SampleInterval;
+
+		LastPoseTime = SampleTimes[Head];
+		LastPosePosition = SamplePositions[Head];
+		PeakVelocity = FMath::Max(PeakVelocity, GetVelocity(LastPoseTime));
+	}
+
+	LastPoseTime = Time;
+	LastPosePosition = Position;
+}
+
+FVector FLimbVelocitySampler::GetPosition(float Time) const
+{
+	// Between the newest sample and the last pose
+	if (Time >= SampleTimes[Head]) {
+		if (Time >= LastPoseTime || LastPoseTime <= SampleTimes[Head]) return LastPosePosition;
+		float Alpha = (Time - SampleTimes[Head]) / (LastPoseTime - SampleTimes[Head]);
+		return FMath::Lerp(SamplePositions[Head], LastPosePosition, Alpha);
+	}
+
+	// Search the samples from the newest to the oldest
+	int32 Newer = Head;
+	for (int32 i = 1; i < NumSamples; i++) {
+		int32 Older = (Head - i + Capacity) % Capacity;
+		if (SampleTimes[Older] <= Time) {
+			float Alpha = (Time - SampleTimes[Older]) / (SampleTimes[Newer] - SampleTimes[Older]);
+			return FMath::Lerp(SamplePositions[Older], SamplePositions[Newer], Alpha);
+		}
+		Newer = Older;
+	}
+
+	// Older than the oldest sample
+	return SamplePositions[Newer];
+}
+
+float FLimbVelocitySampler::GetVelocity(float Time) const
+{
+	float End = FMath::Min(Time, LastPoseTime);
+	float OldestTime = SampleTimes[(Head - NumSamples + 1 + Capacity) % Capacity];
+	float Start = FMath::Max(End - SmoothingWindow, OldestTime);
+
+	float Duration = End - Start;
+	if (Duration <= KINDA_SMALL_NUMBER) return 0.0f;
+
+	return FVector::Dist(GetPosition(End), GetPosition(Start)) / Duration;
+}
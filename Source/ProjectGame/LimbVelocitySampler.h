@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** ELimb is an Enum that enumerates the limbs whose velocity is tracked while attacking */
+enum class ELimb : uint8
+{
+	RightFist, LeftFist, RightFoot, LeftFoot,
+	None
+};
+
+/** Number of limbs whose velocity is tracked */
+static const int32 NumLimbs = (int32)ELimb::None;
+
+/**
+ * Tracks the velocity of a limb independently of the frame rate.
+ * The limb position of each frame is resampled at a fixed rate (SampleRate) into a small ring buffer of
+ * timestamped positions, and velocities are measured over a fixed time window (SmoothingWindow)
+ * instead of over the last frame, so the same movement gives the same velocity at 30, 60 or 144 fps.
+ * Between two frames the limb is assumed to move in a straight line.
+ */
+class PROJECTGAME_API FLimbVelocitySampler
+{
+public:
+	/** Number of samples taken per second */
+	static constexpr float SampleRate = 120.0f;
+
+	/** Time window over which velocities are measured. It should be longer than the frame time of the slowest frame rate supported */
+	static constexpr float SmoothingWindow = 1.0f / 30.0f;
+
+	/** Number of samples kept in the ring buffer */
+	static const int32 Capacity = 16;
+
+	FLimbVelocitySampler();
+
+	/**
+	 * Clears the history and starts tracking the limb from the specified position.
+	 * Called when an attack starts.
+	 */
+	void Reset(float Time, const FVector& Position);
+
+	/**
+	 * Adds the limb position of the current frame, adding all fixed rate samples up to Time.
+	 *
+	 * @param Time		current time in seconds
+	 * @param Position	current world location of the limb
+	 */
+	void AddPose(float Time, const FVector& Position);
+
+	/** Returns the velocity of the limb at the specified time, measured over SmoothingWindow */
+	float GetVelocity(float Time) const;
+
+	/** Returns the maximum velocity reached since Reset() */
+	FORCEINLINE float GetPeakVelocity() const { return PeakVelocity; }
+
+	/** Overrides the maximum velocity reached. Used when a saved fighter state is loaded */
+	FORCEINLINE void SetPeakVelocity(float Velocity) { PeakVelocity = Velocity; }
+
+protected:
+	/** Returns the position of the limb at the specified time, interpolated from the samples (clamped to the samples available) */
+	FVector GetPosition(float Time) const;
+
+	/** Adds a sample to the ring buffer */
+	void PushSample(float Time, const FVector& Position);
+
+	/** Timestamp and position of each sample. The newest sample is at Head */
+	float SampleTimes[Capacity];
+	FVector SamplePositions[Capacity];
+
+	/** Index of the newest sample */
+	int32 Head;
+
+	/** Number of valid samples */
+	int32 NumSamples;
+
+	/** Time and position of the last pose added */
+	float LastPoseTime;
+	FVector LastPosePosition;
+
+	/** Time of the next fixed rate sample */
+	float NextSampleTime;
+
+	/** Maximum velocity reached since Reset() */
+	float PeakVelocity;
+};
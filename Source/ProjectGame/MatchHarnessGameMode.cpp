@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchHarnessGameMode.h"
+#include "CombatClock.h"
+#include "ReplaySubsystem.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+
+#include "Engine.h"
+
+/** Returns the value at a percentile (0..100) of sorted values */
+static float GetPercentile(const TArray<float>& SortedValues, float Percentile)
+{
+	if (SortedValues.Num() == 0) return 0.0f;
+	int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile / 100.0f * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1);
+	return SortedValues[Index];
+}
+
+AMatchHarnessGameMode::AMatchHarnessGameMode()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	// The harness only runs AI fighters
+	bArenaMode = true;
+	bArenaAIOnly = true;
+	ArenaFighterCount = 2;
+
+	// Thousands of matches are played in a row: they are only recorded one by one, with bRecordMatches
+	bRecordReplay = false;
+}
+
+void AMatchHarnessGameMode::ParseHarnessCommandLine()
+{
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	FParse::Value(CommandLine, TEXT("Matches="), MatchCount);
+	FParse::Value(CommandLine, TEXT("MatchTimeout="), MatchTimeout);
+	FParse::Value(CommandLine, TEXT("BaseDamageScale="), BaseDamageScale);
+	FParse::Value(CommandLine, TEXT("PotentialIncrement="), PotentialIncrement);
+	FParse::Value(CommandLine, TEXT("HarnessSeed="), Seed);
+	if (FParse::Param(CommandLine, TEXT("RecordMatches"))) bRecordMatches = true;
+
+	MatchCount = FMath::Max(MatchCount, 1);
+	MatchTimeout = FMath::Max(MatchTimeout, 1.0f);
+}
+
+void AMatchHarnessGameMode::BeginPlay()
+{
+	ParseHarnessCommandLine();
+
+	// No HUD, and one combat step per frame as fast as the CPU allows
+	bShowHUD = false;
+	FApp::SetBenchmarking(true);
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(UCombatClock::GetStepTime());
+
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+
+	Super::BeginPlay();
+
+	bArenaAIOnly = true;
+}
+
+void AMatchHarnessGameMode::StartHarness()
+{
+	StartStates.SetNum(Fighters.Num());
+	for (int32 i = 0; i < Fighters.Num(); i++) {
+		// Meshes that are not rendered do not refresh their bones by default, which would freeze the collision boxes
+		Fighters[i]->GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+		Fighters[i]->OnFighterDamaged.AddDynamic(this, &AMatchHarnessGameMode::OnFighterDamaged);
+
+		Fighters[i]->SetDamageTuning(BaseDamageScale, PotentialIncrement);
+		Fighters[i]->SaveState(StartStates[i]);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Match harness: %d matches of %d fighters, timeout %.0f s, base damage scale %.3f"),
+		MatchCount, Fighters.Num(), MatchTimeout, BaseDamageScale);
+
+	if (bRecordMatches) {
+		ReplayDirectory = FPaths::ProjectSavedDir() / TEXT("MatchHarness") / FString::Printf(TEXT("Replays-%s"), *FDateTime::Now().ToString());
+	}
+
+	Results.Reset(MatchCount);
+	FrameTimes.Reset(FrameTimeWindow);
+	FrameCount = 0;
+	MaxFrameTime = 0.0f;
+	HarnessStartTime = LastFrameTime = FPlatformTime::Seconds();
+	bStarted = true;
+
+	StartMatch();
+}
+
+void AMatchHarnessGameMode::StartMatch()
+{
+	for (int32 i = 0; i < Fighters.Num(); i++) {
+		FFighterState State = StartStates[i];
+		State.ComboRandomSeed = Seed + Results.Num() * Fighters.Num() + i;
+		Fighters[i]->LoadState(State);
+	}
+	UpdateArenaTargets();
+
+	UCombatClock* CombatClock = UCombatClock::Get(this);
+	MatchStartFrame = CombatClock != NULL ? CombatClock->GetFrame() : 0;
+	MatchHits = 0;
+
+	// Recorded from the start state, so the replay does not see the reset
+	UReplaySubsystem* Replay = GetWorld()->GetSubsystem<UReplaySubsystem>();
+	if (bRecordMatches && Replay != NULL) Replay->StartRecording(ReplayDirectory / FString::Printf(TEXT("Match-%04d.replay"), Results.Num()));
+}
+
+void AMatchHarnessGameMode::OnFighterDamaged(EBodyPart BodyPart, float Damage, float NewHealth, float ImpactVelocity)
+{
+	// Health restored by LoadState() is broadcast without a body part
+	if (BodyPart != EBodyPart::None) MatchHits++;
+}
+
+void AMatchHarnessGameMode::EndMatch(int32 Winner)
+{
+	UCombatClock* CombatClock = UCombatClock::Get(this);
+
+	UReplaySubsystem* Replay = GetWorld()->GetSubsystem<UReplaySubsystem>();
+	if (Replay != NULL) Replay->StopRecording();
+
+	FMatchResult& Result = Results.AddDefaulted_GetRef();
+	Result.Winner = Winner;
+	Result.Frames = (CombatClock != NULL ? CombatClock->GetFrame() : 0) - MatchStartFrame;
+	for (AFightingCharacter* Fighter : Fighters) Result.Health.Add(Fighter->GetHealthPoints());
+	Result.Hits = MatchHits;
+
+	if (Results.Num() % 100 == 0) UE_LOG(LogTemp, Display, TEXT("Match harness: %d/%d matches"), Results.Num(), MatchCount);
+
+	if (Results.Num() >= MatchCount) FinishHarness();
+	else StartMatch();
+}
+
+void AMatchHarnessGameMode::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (bFinished) return;
+
+	// Fighters are spawned in BeginPlay and possessed by their AI controllers afterwards
+	if (!bStarted) {
+		if (Fighters.Num() >= 2) StartHarness();
+		return;
+	}
+
+	double Now = FPlatformTime::Seconds();
+	const float FrameTime = (float)(Now - LastFrameTime);
+	if (FrameTimes.Num() < FrameTimeWindow) FrameTimes.Add(FrameTime);
+	else FrameTimes[(int32)(FrameCount % FrameTimeWindow)] = FrameTime;
+	FrameCount++;
+	MaxFrameTime = FMath::Max(MaxFrameTime, FrameTime);
+	LastFrameTime = Now;
+
+	int32 Standing = 0;
+	int32 LastStanding = INDEX_NONE;
+	for (int32 i = 0; i < Fighters.Num(); i++) {
+		if (Fighters[i]->GetHealthPoints() > 0.0f) {
+			Standing++;
+			LastStanding = i;
+		}
+	}
+
+	UCombatClock* CombatClock = UCombatClock::Get(this);
+	int32 MatchFrames = (CombatClock != NULL ? CombatClock->GetFrame() : 0) - MatchStartFrame;
+
+	if (Standing <= 1) EndMatch(Standing == 1 ? LastStanding : INDEX_NONE);
+	else if (MatchFrames >= UCombatClock::SecondsToFrames(MatchTimeout)) EndMatch(INDEX_NONE);
+}
+
+void AMatchHarnessGameMode::FinishHarness()
+{
+	bFinished = true;
+
+	const double Elapsed = FPlatformTime::Seconds() - HarnessStartTime;
+	const FString Timestamp = FDateTime::Now().ToString();
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("MatchHarness");
+
+	// Results of each match
+	FString MatchesCsv = TEXT("Match,Winner,Seconds,Hits");
+	for (int32 i = 0; i < Fighters.Num(); i++) MatchesCsv += FString::Printf(TEXT(",Health%d"), i);
+	MatchesCsv += LINE_TERMINATOR;
+
+	TArray<int32> Wins;
+	Wins.SetNumZeroed(Fighters.Num());
+	int32 Draws = 0;
+	double TotalSeconds = 0.0;
+	double TotalWinnerHealth = 0.0;
+	int32 TotalHits = 0;
+
+	for (int32 m = 0; m < Results.Num(); m++) {
+		const FMatchResult& Result = Results[m];
+		float Seconds = Result.Frames * UCombatClock::GetStepTime();
+
+		MatchesCsv += FString::Printf(TEXT("%d,%d,%.3f,%d"), m, Result.Winner, Seconds, Result.Hits);
+		for (float Health : Result.Health) MatchesCsv += FString::Printf(TEXT(",%.4f"), Health);
+		MatchesCsv += LINE_TERMINATOR;
+
+		TotalSeconds += Seconds;
+		TotalHits += Result.Hits;
+		if (Result.Winner == INDEX_NONE) Draws++;
+		else {
+			Wins[Result.Winner]++;
+			TotalWinnerHealth += Result.Health[Result.Winner];
+		}
+	}
+
+	// Summary of the run. Appended, so runs with different tunings can be compared. Percentiles are of the last frames only
+	TArray<float> SortedFrameTimes = FrameTimes;
+	SortedFrameTimes.Sort();
+
+	const int32 Decided = Results.Num() - Draws;
+	FString SummaryRow = FString::Printf(TEXT("%s,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.4f,%.4f,%d,%.3f,%.4f"),
+		*Timestamp,
+		Results.Num(),
+		Elapsed,
+		Elapsed > 0.0 ? Results.Num() / Elapsed : 0.0,
+		GetPercentile(SortedFrameTimes, 50.0f) * 1000.0f,
+		GetPercentile(SortedFrameTimes, 90.0f) * 1000.0f,
+		GetPercentile(SortedFrameTimes, 99.0f) * 1000.0f,
+		MaxFrameTime * 1000.0f,
+		Elapsed > 0.0 ? FrameCount / Elapsed : 0.0,
+		BaseDamageScale,
+		PotentialIncrement,
+		Draws,
+		Results.Num() > 0 ? TotalSeconds / Results.Num() : 0.0,
+		Decided > 0 ? TotalWinnerHealth / Decided : 0.0);
+	for (int32 Win : Wins) SummaryRow += FString::Printf(TEXT(",%d"), Win);
+	SummaryRow += LINE_TERMINATOR;
+
+	const FString MatchesPath = Directory / FString::Printf(TEXT("Matches-%s.csv"), *Timestamp);
+	const FString SummaryPath = Directory / TEXT("Summary.csv");
+
+	FFileHelper::SaveStringToFile(MatchesCsv, *MatchesPath);
+	if (!FPaths::FileExists(SummaryPath)) {
+		FString Header = TEXT("Timestamp,Matches,Seconds,MatchesPerSec,FrameMsP50,FrameMsP90,FrameMsP99,FrameMsMax,FramesPerSec,BaseDamageScale,PotentialIncrement,Draws,MeanMatchSeconds,MeanWinnerHealth");
+		for (int32 i = 0; i < Fighters.Num(); i++) Header += FString::Printf(TEXT(",Wins%d"), i);
+		FFileHelper::SaveStringToFile(Header + LINE_TERMINATOR, *SummaryPath);
+	}
+	FFileHelper::SaveStringToFile(SummaryRow, *SummaryPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	UE_LOG(LogTemp, Display, TEXT("Match harness: %d matches in %.1f s (%.2f matches/s), %d draws, %d hits. Results written to %s"),
+		Results.Num(), Elapsed, Elapsed > 0.0 ? Results.Num() / Elapsed : 0.0, Draws, TotalHits, *Directory);
+
+	// Matches without a single hit measure nothing: the collision boxes are not moving, or the fighters never reach each other
+	if (TotalHits == 0) {
+		UE_LOG(LogTemp, Error, TEXT("Match harness: no hit landed in %d matches. Check that the fighter meshes animate without rendering"), Results.Num());
+	}
+
+	// In the editor only the harness stops
+	UWorld* World = GetWorld();
+	if (World != NULL && World->WorldType != EWorldType::PIE) FPlatformMisc::RequestExit(false);
+}
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MyGameMode.h"
+#include "FighterState.h"
+#include "MatchHarnessGameMode.generated.h"
+
+/**
+ * Game mode that runs back-to-back AI-vs-AI matches as fast as the CPU allows, to balance the damage and catch regressions.
+ * The engine runs at a fixed timestep of one combat step per frame without waiting for real time, and the fighters are reset
+ * to their saved start state between matches. When all matches are played, the per-match results and a summary
+ * (matches/sec, frame time percentiles of the last frames, outcome statistics) are written to CSV files in Saved/MatchHarness, and the game exits.
+ * Nothing is rendered, so the meshes of the fighters are forced to refresh their bones every frame: the collision boxes follow
+ * the bones, and hits could not land otherwise. An error is logged if no hit landed in any match.
+ * Runs without a GPU, e.g.:
+ * UE4Editor ProjectGame Map?game=/Script/ProjectGame.MatchHarnessGameMode -game -nullrhi -unattended -nosound
+ *   -Matches=1000 -MatchTimeout=90 -BaseDamageScale=1.0 -PotentialIncrement=0.05 -HarnessSeed=1
+ * With -RecordMatches, each match is also recorded into its own replay file in Saved/MatchHarness/Replays-<time>, so a
+ * regression found by the harness can be played back with Fighting.Replay.Play.
+ */
+UCLASS()
+class PROJECTGAME_API AMatchHarnessGameMode : public AMyGameMode
+{
+	GENERATED_BODY()
+
+public:
+	AMatchHarnessGameMode();
+
+	/** Number of matches to play */
+	UPROPERTY(EditAnywhere, Category = Harness, meta = (ClampMin = "1"))
+	int32 MatchCount = 100;
+
+	/** Maximum duration of a match in seconds of game time. A match that lasts longer is a draw */
+	UPROPERTY(EditAnywhere, Category = Harness, meta = (ClampMin = "1.0"))
+	float MatchTimeout = 90.0f;
+
+	/** Factor applied to the BaseDamage of every body part of the fighters */
+	UPROPERTY(EditAnywhere, Category = Harness, meta = (ClampMin = "0.0"))
+	float BaseDamageScale = 1.0f;
+
+	/** PotentialIncrement of the fighters. If negative, the fighters keep their own */
+	UPROPERTY(EditAnywhere, Category = Harness)
+	float PotentialIncrement = -1.0f;
+
+	/** Seed of the random streams of the fighters and of the AI */
+	UPROPERTY(EditAnywhere, Category = Harness)
+	int32 Seed = 1;
+
+	/** If true, each match is recorded into its own replay file. Fighting.Replay.AutoRecord does not apply to the harness */
+	UPROPERTY(EditAnywhere, Category = Harness)
+	bool bRecordMatches = false;
+
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaTime) override;
+
+protected:
+	/** Result of a match */
+	struct FMatchResult
+	{
+		/** Index in Fighters of the winner, or INDEX_NONE for a draw */
+		int32 Winner;
+
+		/** Duration in combat frames */
+		int32 Frames;
+
+		/** Health of each fighter at the end of the match */
+		TArray<float> Health;
+
+		/** Hits landed by all the fighters */
+		int32 Hits;
+	};
+
+	/** Counts the hits of the current match. Bound to OnFighterDamaged of every fighter */
+	UFUNCTION()
+	void OnFighterDamaged(EBodyPart BodyPart, float Damage, float NewHealth, float ImpactVelocity);
+
+	/** Reads the harness settings from the command line, overriding the ones set in the Blueprint */
+	void ParseHarnessCommandLine();
+
+	/** Saves the start state of the fighters, applies the damage tuning and starts the first match */
+	void StartHarness();
+
+	/** Resets the fighters to their start state and starts the next match */
+	void StartMatch();
+
+	/** Records the result of the current match */
+	void EndMatch(int32 Winner);
+
+	/** Writes the CSV files and exits */
+	void FinishHarness();
+
+	/** Start state of each fighter, saved before the first match */
+	TArray<FFighterState> StartStates;
+
+	/** Results of the matches played */
+	TArray<FMatchResult> Results;
+
+	/** Number of frames whose wall time is kept for the frame time percentiles: the last ones, about 18 minutes at 60 fps */
+	static const int32 FrameTimeWindow = 65536;
+
+	/** Wall time of the last FrameTimeWindow frames, in seconds. Ring buffer indexed by FrameCount % FrameTimeWindow */
+	TArray<float> FrameTimes;
+
+	/** Number of frames played, and wall time of the longest one in seconds */
+	int64 FrameCount = 0;
+	float MaxFrameTime = 0.0f;
+
+	/** Directory of the replays of the matches, if bRecordMatches is set */
+	FString ReplayDirectory;
+
+	/** Combat frame in which the current match started */
+	int32 MatchStartFrame = 0;
+
+	/** Hits landed in the current match */
+	int32 MatchHits = 0;
+
+	/** Wall time of the start of the harness and of the last frame */
+	double HarnessStartTime = 0.0;
+	double LastFrameTime = 0.0;
+
+	bool bStarted = false;
+	bool bFinished = false;
+};
@@ -2,6 +2,9 @@
 
 
 #include "MyGameMode.h"
+#include "ReplaySubsystem.h"
+#include "FightingPlayerController.h"
+#include "FightingHUDWidget.h"
 #include "GameFramework/Actor.h"
 #include "UObject/ConstructorHelpers.h"
 #include "Kismet/GameplayStatics.h"
@@ -11,6 +14,9 @@
 AMyGameMode::AMyGameMode() {
 	
 	PrimaryActorTick.bCanEverTick = true;
+
+	// Frames the fight with AFightingCameraManager
+	PlayerControllerClass = AFightingPlayerController::StaticClass();
 }
 
 void AMyGameMode::BeginPlay()
@@ -21,12 +27,34 @@ void AMyGameMode::BeginPlay()
 
 	if (World != NULL) {
 		Player = Cast<AFightingCharacter>(UGameplayStatics::GetPlayerPawn(World, 0));
-		SpawnEnemy();
+
+		ParseArenaCommandLine();
+		if (bArenaMode) SpawnArenaFighters();
+		else SpawnEnemy();
+
+		UReplaySubsystem* Replay = World->GetSubsystem<UReplaySubsystem>();
+		if (bRecordReplay && Replay != NULL) Replay->StartAutoRecording();
 	}
 	
-	if (HealthBar_Widget_Class != nullptr) {
-		HealthBar_Widget = CreateWidget(World, HealthBar_Widget_Class);
+	// The arena shows a native bar for each fighter. A HealthBar_Widget_Class derived from UFightingHUDWidget does so in any mode
+	TSubclassOf<UUserWidget> WidgetClass = bShowHUD ? HealthBar_Widget_Class : NULL;
+	if (bShowHUD && bArenaMode && (WidgetClass == nullptr || !WidgetClass->IsChildOf(UFightingHUDWidget::StaticClass()))) {
+		WidgetClass = UFightingHUDWidget::StaticClass();
+	}
+
+	if (WidgetClass != nullptr) {
+		HealthBar_Widget = CreateWidget(World, WidgetClass);
 		HealthBar_Widget->AddToViewport();
+
+		if (UFightingHUDWidget* HUDWidget = Cast<UFightingHUDWidget>(HealthBar_Widget)) {
+			TArray<AFightingCharacter*> HUDFighters;
+			if (bArenaMode) HUDFighters = Fighters;
+			else {
+				HUDFighters.Add(Player);
+				HUDFighters.Add(Enemy);
+			}
+			HUDWidget->SetFighters(HUDFighters);
+		}
 	}
 }
 
@@ -47,4 +75,90 @@ void AMyGameMode::SpawnEnemy()
 			Player->SetTargetEnemy(Enemy);
 		}
 	}
-}
\ No newline at end of file
+}
+
+void AMyGameMode::ParseArenaCommandLine()
+{
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	if (FParse::Param(CommandLine, TEXT("Arena"))) bArenaMode = true;
+	if (FParse::Param(CommandLine, TEXT("ArenaAIOnly"))) bArenaMode = bArenaAIOnly = true;
+	if (FParse::Value(CommandLine, TEXT("Fighters="), ArenaFighterCount)) bArenaMode = true;
+	FParse::Value(CommandLine, TEXT("ArenaRadius="), ArenaRadius);
+
+	ArenaFighterCount = FMath::Clamp(ArenaFighterCount, 2, 256);
+}
+
+void AMyGameMode::SpawnArenaFighters()
+{
+	UWorld* World = GetWorld();
+	TSubclassOf<APawn> FighterClass = ArenaFighterClass != NULL ? TSubclassOf<APawn>(ArenaFighterClass) : EnemyClass;
+	if (World == NULL || FighterClass == NULL) return;
+
+	Fighters.Reset();
+
+	if (bArenaAIOnly) {
+		// The player controller only watches the fight
+		if (Player != NULL) {
+			if (AController* PlayerController = Player->GetController()) PlayerController->UnPossess();
+			Player->Destroy();
+			Player = NULL;
+		}
+	}
+	else if (Player != NULL) Fighters.Add(Player);
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	// Fighters are evenly spaced on a circle, the player character taking the first place
+	for (int32 i = 0; i < ArenaFighterCount; i++) {
+		float Angle = 2.0f * PI * i / ArenaFighterCount;
+		FVector Location = ArenaCenter + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f) * ArenaRadius;
+		FRotator Rotation = (ArenaCenter - Location).Rotation();
+		Rotation.Pitch = 0.0f;
+
+		if (i == 0 && Player != NULL) {
+			Player->SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+			continue;
+		}
+
+		AFightingCharacter* Fighter = Cast<AFightingCharacter>(World->SpawnActor(FighterClass, &Location, &Rotation, SpawnParameters));
+		if (Fighter != NULL) Fighters.Add(Fighter);
+	}
+
+	// The HUD shows the first two fighters. Without a player character, the first fighter takes its place
+	if (Player == NULL && Fighters.Num() > 0) Player = Fighters[0];
+	Enemy = Fighters.IsValidIndex(1) ? Fighters[1] : NULL;
+
+	if (bArenaAIOnly && Player != NULL) {
+		if (APlayerController* PlayerController = UGameplayStatics::GetPlayerController(World, 0)) PlayerController->SetViewTarget(Player);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Arena: spawned %d fighters%s"), Fighters.Num(), bArenaAIOnly ? TEXT(" (AI only)") : TEXT(""));
+
+	UpdateArenaTargets();
+	World->GetTimerManager().SetTimer(ArenaTargetsTimer, this, &AMyGameMode::UpdateArenaTargets, TargetUpdateInterval, true);
+}
+
+void AMyGameMode::UpdateArenaTargets()
+{
+	for (AFightingCharacter* Fighter : Fighters) {
+		if (Fighter == NULL || Fighter->IsPendingKill() || Fighter->GetHealthPoints() <= 0.0f) continue;
+
+		AFightingCharacter* Closest = NULL;
+		float ClosestDistance = MAX_flt;
+		FVector Location = Fighter->GetActorLocation();
+
+		for (AFightingCharacter* Other : Fighters) {
+			if (Other == Fighter || Other == NULL || Other->IsPendingKill() || Other->GetHealthPoints() <= 0.0f) continue;
+
+			float Distance = FVector::DistSquared(Location, Other->GetActorLocation());
+			if (Distance < ClosestDistance) {
+				ClosestDistance = Distance;
+				Closest = Other;
+			}
+		}
+
+		if (Closest != NULL && Closest != Fighter->GetTargetEnemy()) Fighter->SetTargetEnemy(Closest);
+	}
+}
@@ -9,6 +9,9 @@
 
 /**
  * Personalised game mode that spawns an enemy and sets the player character and the enemy as each other's target.
+ * In arena mode it spawns ArenaFighterCount fighters in a circle instead, and periodically sets the target of each fighter
+ * to the closest fighter still standing. Arena mode can also be enabled from the command line:
+ * -Arena -Fighters=N -ArenaRadius=R -ArenaAIOnly
  */
 UCLASS()
 class PROJECTGAME_API AMyGameMode : public AGameMode
@@ -45,10 +48,17 @@ public:
 	UPROPERTY(BlueprintReadOnly)
 	AFightingCharacter* Enemy;
 
-	/** Class of the UI widget. Can be set in the Blueprint */
+	/**
+	 * Class of the UI widget. Can be set in the Blueprint.
+	 * If it derives from UFightingHUDWidget it is given the fighters to show. In arena mode UFightingHUDWidget is used if it does not
+	 */
 	UPROPERTY(EditAnywhere, Category = "UI HUD")
 	TSubclassOf<UUserWidget> HealthBar_Widget_Class;
 
+	/** If false, no UI widget is created, not even the arena's UFightingHUDWidget */
+	UPROPERTY(EditAnywhere, Category = "UI HUD")
+	bool bShowHUD = true;
+
 	/** Pointer to the UI widget object */
 	UPROPERTY(BlueprintReadOnly, Category = "UI HUD")
 	UUserWidget* HealthBar_Widget;
@@ -58,6 +68,57 @@ public:
 	 * If EnemyClass is AFightingCharacter, then sets the player character and the enemy as each other's target.
 	 */
 	void SpawnEnemy();
+
+	//~ Begin Arena
+	/** If true, spawns ArenaFighterCount fighters instead of a single enemy */
+	UPROPERTY(EditAnywhere, Category = Arena)
+	bool bArenaMode = false;
+
+	/** Number of fighters in the arena, including the player character unless bArenaAIOnly is true */
+	UPROPERTY(EditAnywhere, Category = Arena, meta = (ClampMin = "2", ClampMax = "256"))
+	int32 ArenaFighterCount = 8;
+
+	/** Class of the fighters spawned in the arena. If not set, EnemyClass is used */
+	UPROPERTY(EditAnywhere, Category = Arena)
+	TSubclassOf<AFightingCharacter> ArenaFighterClass;
+
+	/** Center of the circle the fighters are spawned on. Fighters spawn facing the center */
+	UPROPERTY(EditAnywhere, Category = Arena)
+	FVector ArenaCenter = FVector(0.0f, 0.0f, 100.0f);
+
+	/** Radius of the circle the fighters are spawned on */
+	UPROPERTY(EditAnywhere, Category = Arena, meta = (ClampMin = "0"))
+	float ArenaRadius = 800.0f;
+
+	/** If true, the player character is removed and all fighters are controlled by the AI. The camera follows the first fighter */
+	UPROPERTY(EditAnywhere, Category = Arena)
+	bool bArenaAIOnly = false;
+
+	/** Time in seconds between two updates of the fighters' targets */
+	UPROPERTY(EditAnywhere, Category = Arena, meta = (ClampMin = "0.05"))
+	float TargetUpdateInterval = 0.5f;
+
+	/** All the fighters in the arena, including the player character */
+	UPROPERTY(BlueprintReadOnly, Category = Arena)
+	TArray<AFightingCharacter*> Fighters;
+
+	/** Spawns the fighters of the arena on a circle around ArenaCenter and assigns their first targets */
+	void SpawnArenaFighters();
+
+	/** Sets the target of each fighter still standing to the closest other fighter still standing */
+	void UpdateArenaTargets();
+	//~ End Arena
+
+	/** If true, the match is recorded into Saved/Replays when Fighting.Replay.AutoRecord is set. @see UReplaySubsystem */
+	UPROPERTY(EditAnywhere, Category = Replay)
+	bool bRecordReplay = true;
+
+protected:
+	/** Reads the arena settings from the command line, overriding the ones set in the Blueprint */
+	void ParseArenaCommandLine();
+
+	/** Timer that calls UpdateArenaTargets() */
+	FTimerHandle ArenaTargetsTimer;
 	
 	
 };
@@ -0,0 +1,482 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ReplayFile.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/DateTime.h"
+
+/** Appends an unsigned LEB128 varint */
+static FORCEINLINE void WriteVarint(TArray<uint8>& Out, uint32 Value)
+{
+	while (Value >= 0x80) {
+		Out.Add((uint8)(Value | 0x80));
+		Value >>= 7;
+	}
+	Out.Add((uint8)Value);
+}
+
+/** Reads an unsigned LEB128 varint. Returns false if it runs past End */
+static FORCEINLINE bool ReadVarint(const uint8*& Ptr, const uint8* End, uint32& OutValue)
+{
+	OutValue = 0;
+	for (int32 shift = 0; shift < 35; shift += 7) {
+		if (Ptr >= End) return false;
+		uint8 byte = *Ptr++;
+		OutValue |= (uint32)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+/** Maps signed values to unsigned ones so small magnitudes give short varints: 0, -1, 1, -2... -> 0, 1, 2, 3... */
+static FORCEINLINE uint32 ZigZagEncode(int32 Value) { return ((uint32)Value << 1) ^ (uint32)(Value >> 31); }
+static FORCEINLINE int32 ZigZagDecode(uint32 Value) { return (int32)(Value >> 1) ^ -(int32)(Value & 1); }
+
+/** Returns the maximum size of the input data of a chunk: a varint of frames and a terminator per frame, and 4 varints per fighter */
+static FORCEINLINE int32 GetMaxInputSize(int32 NumFighters)
+{
+	return FReplayRecorder::KeyframeInterval * (5 + 1 + NumFighters * (3 + 3 + 2 + 2));
+}
+
+/** Returns the maximum size of an encoded keyframe: at worst every other byte is zero, each pair costing 2 varint bytes */
+static FORCEINLINE int32 GetMaxKeyframeSize(int32 NumFighters)
+{
+	return NumFighters * sizeof(FFighterState) * 2 + 16;
+}
+
+/** Writes the chunks of a replay to its file on its own thread */
+class FReplayChunkWriter : public FRunnable
+{
+public:
+	FReplayChunkWriter(FArchive* InFile)
+		: File(InFile)
+	{
+		WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		DoneEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		if (FPlatformProcess::SupportsMultithreading()) {
+			Thread = FRunnableThread::Create(this, TEXT("ReplayWriter"), 0, TPri_BelowNormal);
+		}
+	}
+
+	/** Writes the pending chunk, the index and the footer, and closes the file */
+	virtual ~FReplayChunkWriter()
+	{
+		bStopping = true;
+		WorkEvent->Trigger();
+		if (Thread != NULL) {
+			Thread->WaitForCompletion();
+			delete Thread;
+		}
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		FPlatformProcess::ReturnSynchEventToPool(DoneEvent);
+
+		FReplayFileFooter Footer;
+		FMemory::Memzero(Footer);
+		Footer.IndexOffset = File->Tell();
+		Footer.NumChunks = Index.Num();
+		Footer.Magic = FReplayFileHeader::FileMagic;
+		File->Serialize(Index.GetData(), Index.Num() * sizeof(FReplayIndexEntry));
+		File->Serialize(&Footer, sizeof(Footer));
+		delete File;
+	}
+
+	/**
+	 * Hands a chunk to the writer thread. Waits for the previous chunk to be written first, which only happens
+	 * if the disk is more than a chunk (2 seconds) behind. Called by the game thread.
+	 */
+	void Submit(const FReplayChunk* Chunk)
+	{
+		if (Thread == NULL) {
+			WriteChunk(*Chunk);
+			return;
+		}
+
+		while (bPending) DoneEvent->Wait();
+		Pending = Chunk;
+		bPending = true;
+		WorkEvent->Trigger();
+	}
+
+	FORCEINLINE int64 GetNumBytesWritten() const { return NumBytesWritten; }
+
+	//~ Begin FRunnable Interface
+	virtual uint32 Run() override
+	{
+		while (true) {
+			WorkEvent->Wait();
+			if (bPending) {
+				WriteChunk(*Pending);
+				bPending = false;
+				DoneEvent->Trigger();
+			}
+			if (bStopping) break;
+		}
+		return 0;
+	}
+	//~ End FRunnable Interface
+
+protected:
+	void WriteChunk(const FReplayChunk& Chunk)
+	{
+		FReplayIndexEntry& Entry = Index.AddDefaulted_GetRef();
+		Entry.Offset = File->Tell();
+		Entry.FirstFrame = Chunk.Header.FirstFrame;
+		Entry.NumFrames = Chunk.Header.NumFrames;
+
+		File->Serialize(const_cast<FReplayChunkHeader*>(&Chunk.Header), sizeof(FReplayChunkHeader));
+		File->Serialize(const_cast<uint8*>(Chunk.Keyframe.GetData()), Chunk.Keyframe.Num());
+		File->Serialize(const_cast<uint8*>(Chunk.Inputs.GetData()), Chunk.Inputs.Num());
+		File->Flush();
+
+		NumBytesWritten = File->Tell();
+	}
+
+	FArchive* File;
+	FEvent* WorkEvent = NULL;
+	FEvent* DoneEvent = NULL;
+	FRunnableThread* Thread = NULL;
+
+	/** Chunk to write. Only read by the writer thread while bPending is true */
+	const FReplayChunk* Pending = NULL;
+	TAtomic<bool> bPending { false };
+	TAtomic<bool> bStopping { false };
+	TAtomic<int64> NumBytesWritten { 0 };
+
+	/** Index entry of every chunk written. Only accessed by the writer thread until it stops */
+	TArray<FReplayIndexEntry> Index;
+};
+
+FReplayRecorder::FReplayRecorder()
+{
+}
+
+FReplayRecorder::~FReplayRecorder()
+{
+	Stop();
+}
+
+bool FReplayRecorder::Start(const FString& Path, int32 InNumFighters)
+{
+	Stop();
+
+	FArchive* File = IFileManager::Get().CreateFileWriter(*Path);
+	if (File == NULL) return false;
+
+	FReplayFileHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = FReplayFileHeader::FileMagic;
+	Header.Version = FReplayFileHeader::CurrentVersion;
+	Header.NumFighters = (uint16)InNumFighters;
+	Header.TickRate = UCombatClock::TickRate;
+	Header.KeyframeInterval = KeyframeInterval;
+	Header.StateSize = sizeof(FFighterState);
+	Header.StartTicks = FDateTime::UtcNow().GetTicks();
+	File->Serialize(&Header, sizeof(Header));
+
+	NumFighters = InNumFighters;
+	NumFrames = 0;
+	FrameInChunk = 0;
+	UnchangedFrames = 0;
+	CurrentChunk = 0;
+
+	// All the memory needed while recording is allocated here
+	for (FReplayChunk& Chunk : Chunks) {
+		Chunk.Keyframe.Empty(GetMaxKeyframeSize(NumFighters));
+		Chunk.Inputs.Empty(GetMaxInputSize(NumFighters));
+	}
+	BaseStates.SetNumZeroed(NumFighters);
+	LastInputs.SetNumZeroed(NumFighters);
+
+	Writer = new FReplayChunkWriter(File);
+	return true;
+}
+
+void FReplayRecorder::Stop()
+{
+	if (Writer == NULL) return;
+
+	if (FrameInChunk > 0) SubmitChunk();
+	delete Writer;
+	Writer = NULL;
+}
+
+int64 FReplayRecorder::GetNumBytesWritten() const
+{
+	return Writer != NULL ? Writer->GetNumBytesWritten() : 0;
+}
+
+void FReplayRecorder::RecordFrame(const FFighterInput* Inputs, const FFighterState* States)
+{
+	if (Writer == NULL) return;
+
+	FReplayChunk& Chunk = Chunks[CurrentChunk];
+
+	if (FrameInChunk == 0) {
+		Chunk.Header.FirstFrame = NumFrames;
+		Chunk.Keyframe.Reset();
+		Chunk.Inputs.Reset();
+
+		// The keyframe is XORed with the first keyframe (zero for the first chunk), so the bytes that did not change
+		// since the start of the recording, such as the frames of body parts never hit, become runs of zeros
+		const uint8* Current = (const uint8*)States;
+		const uint8* Base = (const uint8*)BaseStates.GetData();
+		const int32 Size = NumFighters * sizeof(FFighterState);
+
+		int32 pos = 0;
+		while (pos < Size) {
+			int32 zeros = 0;
+			while (pos + zeros < Size && Current[pos + zeros] == Base[pos + zeros]) zeros++;
+
+			// Literals run up to the next run of 3 zeros, shorter runs costing more as separate pairs
+			int32 literals = 0;
+			int32 literalZeros = 0;
+			while (pos + zeros + literals < Size && literalZeros < 3) {
+				literalZeros = Current[pos + zeros + literals] == Base[pos + zeros + literals] ? literalZeros + 1 : 0;
+				literals++;
+			}
+			if (literalZeros == 3) literals -= 3;
+
+			WriteVarint(Chunk.Keyframe, zeros);
+			WriteVarint(Chunk.Keyframe, literals);
+			for (int32 i = pos + zeros; i < pos + zeros + literals; i++) Chunk.Keyframe.Add(Current[i] ^ Base[i]);
+			pos += zeros + literals;
+		}
+
+		if (NumFrames == 0) FMemory::Memcpy(BaseStates.GetData(), States, Size);
+
+		// Inputs are encoded from zero at the start of each chunk, so the chunk can be decoded on its own
+		FMemory::Memzero(LastInputs.GetData(), NumFighters * sizeof(FFighterInput));
+		UnchangedFrames = 0;
+	}
+
+	EncodeInputs(Inputs);
+
+	NumFrames++;
+	FrameInChunk++;
+	if (FrameInChunk == KeyframeInterval) SubmitChunk();
+}
+
+void FReplayRecorder::EncodeInputs(const FFighterInput* Inputs)
+{
+	bool bChanged = false;
+	for (int32 i = 0; i < NumFighters && !bChanged; i++) bChanged = Inputs[i] != LastInputs[i];
+
+	if (!bChanged) {
+		UnchangedFrames++;
+		return;
+	}
+
+	TArray<uint8>& Out = Chunks[CurrentChunk].Inputs;
+	WriteVarint(Out, UnchangedFrames);
+	for (int32 i = 0; i < NumFighters; i++) {
+		if (Inputs[i] == LastInputs[i]) continue;
+
+		WriteVarint(Out, i + 1);
+		WriteVarint(Out, Inputs[i].Buttons ^ LastInputs[i].Buttons);
+		WriteVarint(Out, ZigZagEncode(Inputs[i].MoveX - LastInputs[i].MoveX));
+		WriteVarint(Out, ZigZagEncode(Inputs[i].MoveY - LastInputs[i].MoveY));
+		LastInputs[i] = Inputs[i];
+	}
+	Out.Add(0);
+	UnchangedFrames = 0;
+}
+
+void FReplayRecorder::SubmitChunk()
+{
+	FReplayChunk& Chunk = Chunks[CurrentChunk];
+	Chunk.Header.NumFrames = FrameInChunk;
+	Chunk.Header.KeyframeSize = Chunk.Keyframe.Num();
+	Chunk.Header.InputSize = Chunk.Inputs.Num();
+
+	// Submit() waits for the previous chunk to be written, so the other buffer is free to record the next chunk
+	Writer->Submit(&Chunk);
+	CurrentChunk = 1 - CurrentChunk;
+	FrameInChunk = 0;
+}
+
+FReplayReader::FReplayReader()
+{
+	FMemory::Memzero(Header);
+}
+
+FReplayReader::~FReplayReader()
+{
+	Close();
+}
+
+void FReplayReader::Close()
+{
+	delete MappedRegion;
+	MappedRegion = NULL;
+	delete MappedFile;
+	MappedFile = NULL;
+	FileData.Empty();
+
+	Data = NULL;
+	DataSize = 0;
+	Index = NULL;
+	NumChunks = 0;
+	NumFrames = 0;
+	FMemory::Memzero(Header);
+}
+
+bool FReplayReader::Open(const FString& Path)
+{
+	Close();
+
+	MappedFile = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path);
+	if (MappedFile != NULL) {
+		MappedRegion = MappedFile->MapRegion();
+		if (MappedRegion != NULL) {
+			Data = MappedRegion->GetMappedPtr();
+			DataSize = MappedRegion->GetMappedSize();
+		}
+	}
+	else if (FFileHelper::LoadFileToArray(FileData, *Path)) {
+		// Platforms that cannot map files
+		Data = FileData.GetData();
+		DataSize = FileData.Num();
+	}
+
+	if (Data == NULL || DataSize < (int64)(sizeof(FReplayFileHeader) + sizeof(FReplayFileFooter))) {
+		Close();
+		return false;
+	}
+
+	FReplayFileFooter Footer;
+	FMemory::Memcpy(&Header, Data, sizeof(Header));
+	FMemory::Memcpy(&Footer, Data + DataSize - sizeof(Footer), sizeof(Footer));
+
+	const bool bValid = Header.Magic == FReplayFileHeader::FileMagic
+		&& Header.Version == FReplayFileHeader::CurrentVersion
+		&& Header.StateSize == sizeof(FFighterState)
+		&& Header.NumFighters > 0
+		&& Header.KeyframeInterval > 0
+		&& Footer.Magic == FReplayFileHeader::FileMagic
+		&& Footer.NumChunks > 0
+		&& Footer.IndexOffset >= sizeof(FReplayFileHeader)
+		&& Footer.IndexOffset + (uint64)Footer.NumChunks * sizeof(FReplayIndexEntry) + sizeof(Footer) == (uint64)DataSize;
+	if (!bValid) {
+		Close();
+		return false;
+	}
+
+	Index = Data + Footer.IndexOffset;
+	NumChunks = Footer.NumChunks;
+
+	FReplayIndexEntry LastEntry;
+	FMemory::Memcpy(&LastEntry, Index + (NumChunks - 1) * sizeof(FReplayIndexEntry), sizeof(LastEntry));
+	NumFrames = LastEntry.FirstFrame + LastEntry.NumFrames;
+
+	// The first keyframe is the base of all the others
+	BaseStates.SetNumZeroed(Header.NumFighters);
+	FReplayChunkHeader ChunkHeader;
+	const uint8* Keyframe;
+	const uint8* Inputs;
+	if (!GetChunkData(0, ChunkHeader, Keyframe, Inputs) || !DecodeKeyframe(Keyframe, ChunkHeader.KeyframeSize, BaseStates.GetData())) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool FReplayReader::GetChunkData(int32 Chunk, FReplayChunkHeader& OutHeader, const uint8*& OutKeyframe, const uint8*& OutInputs) const
+{
+	if (Chunk < 0 || Chunk >= NumChunks) return false;
+
+	FReplayIndexEntry Entry;
+	FMemory::Memcpy(&Entry, Index + Chunk * sizeof(FReplayIndexEntry), sizeof(Entry));
+	if (Entry.Offset + sizeof(FReplayChunkHeader) > (uint64)(Index - Data)) return false;
+
+	FMemory::Memcpy(&OutHeader, Data + Entry.Offset, sizeof(OutHeader));
+	if (Entry.Offset + sizeof(FReplayChunkHeader) + OutHeader.KeyframeSize + OutHeader.InputSize > (uint64)(Index - Data)) return false;
+	if (OutHeader.FirstFrame != GetChunkFirstFrame(Chunk) || OutHeader.NumFrames <= 0 || OutHeader.NumFrames > Header.KeyframeInterval) return false;
+
+	OutKeyframe = Data + Entry.Offset + sizeof(FReplayChunkHeader);
+	OutInputs = OutKeyframe + OutHeader.KeyframeSize;
+	return true;
+}
+
+bool FReplayReader::DecodeKeyframe(const uint8* Encoded, uint32 EncodedSize, FFighterState* OutStates) const
+{
+	uint8* Out = (uint8*)OutStates;
+	const uint8* End = Encoded + EncodedSize;
+	const uint32 Size = Header.NumFighters * sizeof(FFighterState);
+
+	uint32 pos = 0;
+	while (pos < Size) {
+		uint32 zeros, literals;
+		if (!ReadVarint(Encoded, End, zeros) || !ReadVarint(Encoded, End, literals)) return false;
+		if (zeros > Size - pos || literals > Size - pos - zeros || literals > (uint32)(End - Encoded)) return false;
+
+		pos += zeros;
+		for (uint32 i = 0; i < literals; i++) Out[pos + i] ^= Encoded[i];
+		Encoded += literals;
+		pos += literals;
+	}
+	return Encoded == End;
+}
+
+bool FReplayReader::ReadKeyframe(int32 Chunk, FFighterState* OutStates) const
+{
+	FMemory::Memcpy(OutStates, BaseStates.GetData(), Header.NumFighters * sizeof(FFighterState));
+	if (Chunk == 0) return NumChunks > 0;
+
+	FReplayChunkHeader ChunkHeader;
+	const uint8* Keyframe;
+	const uint8* Inputs;
+	return GetChunkData(Chunk, ChunkHeader, Keyframe, Inputs) && DecodeKeyframe(Keyframe, ChunkHeader.KeyframeSize, OutStates);
+}
+
+bool FReplayReader::ReadInputs(int32 Chunk, TArray<FFighterInput>& OutInputs) const
+{
+	FReplayChunkHeader ChunkHeader;
+	const uint8* Keyframe;
+	const uint8* Encoded;
+	if (!GetChunkData(Chunk, ChunkHeader, Keyframe, Encoded)) return false;
+
+	const int32 NumFighters = Header.NumFighters;
+	const uint8* End = Encoded + ChunkHeader.InputSize;
+
+	// Reuses the allocation of the previous chunk
+	OutInputs.SetNumUninitialized(ChunkHeader.NumFrames * NumFighters, false);
+	FMemory::Memzero(OutInputs.GetData(), OutInputs.Num() * sizeof(FFighterInput));
+
+	// Each frame starts as a copy of the previous one (zero for the first frame), and the changes written for it are applied on top
+	auto CopyPreviousFrame = [&](int32 Frame) {
+		if (Frame > 0) FMemory::Memcpy(&OutInputs[Frame * NumFighters], &OutInputs[(Frame - 1) * NumFighters], NumFighters * sizeof(FFighterInput));
+	};
+
+	int32 frame = 0;
+	while (Encoded < End) {
+		uint32 unchanged;
+		if (!ReadVarint(Encoded, End, unchanged) || frame + (int32)unchanged >= ChunkHeader.NumFrames) return false;
+
+		for (uint32 i = 0; i < unchanged; i++) CopyPreviousFrame(frame++);
+		CopyPreviousFrame(frame);
+
+		uint32 fighter;
+		while (ReadVarint(Encoded, End, fighter) && fighter != 0) {
+			uint32 buttons, moveX, moveY;
+			if (fighter > (uint32)NumFighters || !ReadVarint(Encoded, End, buttons) || !ReadVarint(Encoded, End, moveX) || !ReadVarint(Encoded, End, moveY)) return false;
+
+			FFighterInput& Input = OutInputs[frame * NumFighters + fighter - 1];
+			Input.Buttons ^= (uint16)buttons;
+			Input.MoveX = (int8)(Input.MoveX + ZigZagDecode(moveX));
+			Input.MoveY = (int8)(Input.MoveY + ZigZagDecode(moveY));
+		}
+		if (fighter != 0) return false;
+		frame++;
+	}
+
+	// Frames after the last change repeat it
+	for (; frame < ChunkHeader.NumFrames; frame++) CopyPreviousFrame(frame);
+	return true;
+}
@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FighterState.h"
+#include "CombatClock.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class FReplayChunkWriter;
+
+/**
+ * Replay file format. All structs are written as is (little endian):
+ *  - FReplayFileHeader
+ *  - Chunks of KeyframeInterval combat frames, each one:
+ *     - FReplayChunkHeader
+ *     - Keyframe: the FFighterState of every fighter at the first frame of the chunk, XORed with the keyframe of the first chunk
+ *       (zero for the first chunk) and zero-run encoded: pairs of varints (zero bytes, literal bytes) followed by the literal bytes.
+ *     - Inputs: the FFighterInput of every fighter in every frame of the chunk, as changes from the previous frame (zero at the
+ *       start of the chunk): varint frames without changes, then for each fighter that changed, varint (fighter + 1),
+ *       varint buttons XOR, zigzag varint MoveX and MoveY deltas, and a 0 terminator. Frames after the last change repeat it.
+ *  - Index: one FReplayIndexEntry per chunk
+ *  - FReplayFileFooter
+ * Every chunk only depends on itself and on the first keyframe, so any frame can be reached by decoding a single chunk.
+ */
+struct FReplayFileHeader
+{
+	/** 'FRPL' */
+	static const uint32 FileMagic = 0x4C505246;
+
+	/** Incremented whenever the format or FFighterState change */
+	static const uint16 CurrentVersion = 2;
+
+	uint32 Magic;
+	uint16 Version;
+	uint16 NumFighters;
+	int32 TickRate;
+	int32 KeyframeInterval;
+	int32 StateSize;
+	int32 Padding;
+
+	/** UTC time the recording started, in FDateTime ticks */
+	int64 StartTicks;
+};
+
+struct FReplayChunkHeader
+{
+	/** Replay frame of the first frame of the chunk (frames are counted from the start of the recording) */
+	int32 FirstFrame;
+
+	/** Number of frames in the chunk */
+	int32 NumFrames;
+
+	uint32 KeyframeSize;
+	uint32 InputSize;
+};
+
+struct FReplayIndexEntry
+{
+	/** Offset of the FReplayChunkHeader in the file */
+	uint64 Offset;
+
+	int32 FirstFrame;
+	int32 NumFrames;
+};
+
+struct FReplayFileFooter
+{
+	uint64 IndexOffset;
+	uint32 NumChunks;
+	uint32 Magic;
+};
+
+static_assert(sizeof(FReplayFileHeader) == 32, "FReplayFileHeader is part of the replay file format");
+static_assert(sizeof(FReplayChunkHeader) == 16, "FReplayChunkHeader is part of the replay file format");
+static_assert(sizeof(FReplayIndexEntry) == 16, "FReplayIndexEntry is part of the replay file format");
+static_assert(sizeof(FReplayFileFooter) == 16, "FReplayFileFooter is part of the replay file format");
+
+/** Encoded data of one chunk, filled by the game thread and written by the writer thread */
+struct FReplayChunk
+{
+	FReplayChunkHeader Header;
+	TArray<uint8> Keyframe;
+	TArray<uint8> Inputs;
+};
+
+/**
+ * Records the inputs of a set of fighters every combat frame and their state every KeyframeInterval frames.
+ * Recording does not allocate: the buffers of a chunk are allocated in Start(), and finished chunks are written to the file
+ * by a background thread.
+ */
+class PROJECTGAME_API FReplayRecorder : public FNoncopyable
+{
+public:
+	/** Number of frames between two keyframes (2 seconds) */
+	static const int32 KeyframeInterval = UCombatClock::TickRate * 2;
+
+	FReplayRecorder();
+	~FReplayRecorder();
+
+	/**
+	 * Creates the file and starts recording.
+	 *
+	 * @param Path			path of the replay file
+	 * @param NumFighters	number of fighters recorded every frame
+	 * @return true if the file was created
+	 */
+	bool Start(const FString& Path, int32 NumFighters);
+
+	/** Writes the last chunk, the index and the footer, and closes the file */
+	void Stop();
+
+	FORCEINLINE bool IsRecording() const { return Writer != NULL; }
+
+	/** Returns true if the next frame starts a chunk, and RecordFrame() needs the state of the fighters */
+	FORCEINLINE bool IsKeyframeDue() const { return FrameInChunk == 0; }
+
+	/**
+	 * Records one frame.
+	 *
+	 * @param Inputs	input of every fighter in this frame
+	 * @param States	state of every fighter at the start of this frame. Only read if IsKeyframeDue()
+	 */
+	void RecordFrame(const FFighterInput* Inputs, const FFighterState* States);
+
+	/** Returns the number of frames recorded */
+	FORCEINLINE int32 GetNumFrames() const { return NumFrames; }
+
+	/** Returns the number of bytes of chunks written to the file so far */
+	int64 GetNumBytesWritten() const;
+
+protected:
+	/** Hands the current chunk to the writer thread and starts the next one in the other buffer */
+	void SubmitChunk();
+
+	/** Writes the changes of the inputs of one frame to the current chunk */
+	void EncodeInputs(const FFighterInput* Inputs);
+
+	FReplayChunkWriter* Writer = NULL;
+	int32 NumFighters = 0;
+	int32 NumFrames = 0;
+	int32 FrameInChunk = 0;
+
+	/** Frames without changes since the last change written */
+	int32 UnchangedFrames = 0;
+
+	/** The chunk being recorded and the chunk being written. Both are allocated in Start() */
+	FReplayChunk Chunks[2];
+	int32 CurrentChunk = 0;
+
+	/** States of the first keyframe, which the other keyframes are XORed with */
+	TArray<FFighterState> BaseStates;
+
+	/** Inputs of the previous frame */
+	TArray<FFighterInput> LastInputs;
+};
+
+/**
+ * Reads a replay file through a memory mapping. Any frame can be reached in O(1): the chunk of a frame is found
+ * by division, its offset is read from the index, and it is decoded on its own.
+ */
+class PROJECTGAME_API FReplayReader : public FNoncopyable
+{
+public:
+	FReplayReader();
+	~FReplayReader();
+
+	/** Maps a replay file and validates it. Returns false if it is not a valid replay */
+	bool Open(const FString& Path);
+
+	void Close();
+
+	FORCEINLINE int32 GetNumFighters() const { return Header.NumFighters; }
+	FORCEINLINE int32 GetNumFrames() const { return NumFrames; }
+	FORCEINLINE int32 GetNumChunks() const { return NumChunks; }
+	FORCEINLINE int32 GetKeyframeInterval() const { return Header.KeyframeInterval; }
+
+	/** Returns the chunk containing a replay frame */
+	FORCEINLINE int32 GetChunkOfFrame(int32 Frame) const { return FMath::Clamp(Frame / Header.KeyframeInterval, 0, NumChunks - 1); }
+
+	/** Returns the replay frame of the first frame of a chunk */
+	FORCEINLINE int32 GetChunkFirstFrame(int32 Chunk) const { return Chunk * Header.KeyframeInterval; }
+
+	/**
+	 * Decodes the keyframe of a chunk.
+	 *
+	 * @param Chunk			chunk index
+	 * @param OutStates		receives GetNumFighters() states
+	 * @return false if the chunk is corrupt
+	 */
+	bool ReadKeyframe(int32 Chunk, FFighterState* OutStates) const;
+
+	/**
+	 * Decodes the inputs of every frame of a chunk.
+	 *
+	 * @param Chunk			chunk index
+	 * @param OutInputs		receives NumFrames * GetNumFighters() inputs, fighter inputs of each frame being consecutive
+	 * @return false if the chunk is corrupt
+	 */
+	bool ReadInputs(int32 Chunk, TArray<FFighterInput>& OutInputs) const;
+
+protected:
+	/** Returns the header of a chunk and pointers to its keyframe and input data, or false if it is out of the file */
+	bool GetChunkData(int32 Chunk, FReplayChunkHeader& OutHeader, const uint8*& OutKeyframe, const uint8*& OutInputs) const;
+
+	/** Decodes a zero-run encoded keyframe and XORs it into OutStates */
+	bool DecodeKeyframe(const uint8* Encoded, uint32 EncodedSize, FFighterState* OutStates) const;
+
+	IMappedFileHandle* MappedFile = NULL;
+	IMappedFileRegion* MappedRegion = NULL;
+
+	/** Contents of the file when the platform cannot map files */
+	TArray<uint8> FileData;
+
+	const uint8* Data = NULL;
+	int64 DataSize = 0;
+
+	FReplayFileHeader Header;
+	int32 NumChunks = 0;
+	int32 NumFrames = 0;
+	const uint8* Index = NULL;
+
+	/** States of the first keyframe */
+	TArray<FFighterState> BaseStates;
+};
@@ -0,0 +1,343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ReplaySubsystem.h"
+#include "FightingCharacter.h"
+#include "MyGameMode.h"
+#include "CombatClock.h"
+#include "HitDetectionSubsystem.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "Engine/World.h"
+
+static TAutoConsoleVariable<int32> CVarReplayAutoRecord(
+	TEXT("Fighting.Replay.AutoRecord"),
+	0,
+	TEXT("1: every match of MyGameMode is recorded into Saved/Replays/Replay-<time>.replay. 0: matches are only recorded with Fighting.Replay.Record.\n")
+	TEXT("Read when the match starts."),
+	ECVF_Default);
+
+bool UReplaySubsystem::GatherFighters()
+{
+	Fighters.Reset();
+
+	UWorld* World = GetWorld();
+	AMyGameMode* GameMode = World != NULL ? Cast<AMyGameMode>(World->GetAuthGameMode()) : NULL;
+	CombatClock = World != NULL ? World->GetSubsystem<UCombatClock>() : NULL;
+	if (GameMode == NULL || CombatClock == NULL) return false;
+
+	if (GameMode->bArenaMode) Fighters = GameMode->Fighters;
+	else if (GameMode->Player != NULL && GameMode->Enemy != NULL) {
+		Fighters.Add(GameMode->Player);
+		Fighters.Add(GameMode->Enemy);
+	}
+	return Fighters.Num() > 0 && AreFightersValid();
+}
+
+bool UReplaySubsystem::AreFightersValid() const
+{
+	for (AFightingCharacter* Fighter : Fighters) {
+		if (Fighter == NULL || Fighter->IsPendingKill()) return false;
+	}
+	return true;
+}
+
+void UReplaySubsystem::BindCombatStep()
+{
+	if (!CombatStepHandle.IsValid() && CombatClock != NULL) {
+		CombatStepHandle = CombatClock->OnCombatStep.AddUObject(this, &UReplaySubsystem::OnCombatStep);
+	}
+}
+
+void UReplaySubsystem::UnbindCombatStep()
+{
+	if (IsRecording() || bPlaying || !CombatStepHandle.IsValid()) return;
+
+	if (CombatClock != NULL) CombatClock->OnCombatStep.Remove(CombatStepHandle);
+	CombatStepHandle.Reset();
+}
+
+bool UReplaySubsystem::StartRecording(FString Path)
+{
+	StopRecording();
+	if (bPlaying || !GatherFighters()) return false;
+
+	if (Path.IsEmpty()) {
+		Path = FPaths::ProjectSavedDir() / TEXT("Replays") / FString::Printf(TEXT("Replay-%s.replay"), *FDateTime::Now().ToString());
+	}
+	if (!Recorder.Start(Path, Fighters.Num())) {
+		UE_LOG(LogTemp, Warning, TEXT("Replay: could not create %s"), *Path);
+		return false;
+	}
+
+	RecordingPath = Path;
+	RecordInputs.SetNumZeroed(Fighters.Num());
+	RecordStates.SetNumZeroed(Fighters.Num());
+	BindCombatStep();
+
+	UE_LOG(LogTemp, Display, TEXT("Replay: recording %d fighters into %s"), Fighters.Num(), *RecordingPath);
+	return true;
+}
+
+void UReplaySubsystem::StartAutoRecording()
+{
+	if (CVarReplayAutoRecord.GetValueOnGameThread() != 0) StartRecording();
+}
+
+void UReplaySubsystem::StopRecording()
+{
+	if (!IsRecording()) return;
+
+	const int32 NumFrames = Recorder.GetNumFrames();
+	Recorder.Stop();
+	UnbindCombatStep();
+
+	UE_LOG(LogTemp, Display, TEXT("Replay: recorded %.1f s (%d frames) into %s, %lld bytes"),
+		NumFrames * UCombatClock::GetStepTime(), NumFrames, *RecordingPath, IFileManager::Get().FileSize(*RecordingPath));
+}
+
+bool UReplaySubsystem::StartPlayback(const FString& Path, int32 Frame)
+{
+	StopPlayback();
+	StopRecording();
+	if (!GatherFighters()) return false;
+
+	if (!Reader.Open(Path)) {
+		UE_LOG(LogTemp, Warning, TEXT("Replay: %s is not a valid replay"), *Path);
+		return false;
+	}
+	if (Reader.GetNumFighters() != Fighters.Num()) {
+		UE_LOG(LogTemp, Warning, TEXT("Replay: %s has %d fighters, the game mode has %d"), *Path, Reader.GetNumFighters(), Fighters.Num());
+		Reader.Close();
+		return false;
+	}
+
+	// The fighters are only driven by the recorded inputs
+	PlaybackControllers.SetNum(Fighters.Num());
+	for (int32 i = 0; i < Fighters.Num(); i++) {
+		AController* Controller = Fighters[i]->GetController();
+		PlaybackControllers[i] = Controller;
+		if (Controller == NULL) continue;
+
+		if (APlayerController* PlayerController = Cast<APlayerController>(Controller)) Fighters[i]->DisableInput(PlayerController);
+		else Controller->UnPossess();
+	}
+	for (AFightingCharacter* Fighter : Fighters) Fighter->GetCharacterMovement()->bRunPhysicsWithNoController = true;
+
+	bPlaying = true;
+	LoadedChunk = INDEX_NONE;
+	LastInputs.SetNumZeroed(Fighters.Num());
+	RecordStates.SetNumZeroed(Fighters.Num());
+	BindCombatStep();
+
+	UE_LOG(LogTemp, Display, TEXT("Replay: playing %s, %.1f s (%d frames)"), *Path, Reader.GetNumFrames() * UCombatClock::GetStepTime(), Reader.GetNumFrames());
+	return SeekPlayback(Frame);
+}
+
+void UReplaySubsystem::StopPlayback()
+{
+	if (!bPlaying) return;
+
+	bPlaying = false;
+	Reader.Close();
+	UnbindCombatStep();
+
+	for (int32 i = 0; i < Fighters.Num() && i < PlaybackControllers.Num(); i++) {
+		AController* Controller = PlaybackControllers[i];
+		if (Fighters[i] == NULL || Fighters[i]->IsPendingKill() || Controller == NULL || Controller->IsPendingKill()) continue;
+
+		if (APlayerController* PlayerController = Cast<APlayerController>(Controller)) Fighters[i]->EnableInput(PlayerController);
+		else Controller->Possess(Fighters[i]);
+	}
+	PlaybackControllers.Reset();
+
+	UE_LOG(LogTemp, Display, TEXT("Replay: playback stopped at frame %d"), PlaybackFrame);
+}
+
+bool UReplaySubsystem::LoadChunkInputs(int32 Chunk)
+{
+	if (Chunk == LoadedChunk) return true;
+
+	LoadedChunk = INDEX_NONE;
+	if (!Reader.ReadInputs(Chunk, ChunkInputs)) return false;
+	LoadedChunk = Chunk;
+	return true;
+}
+
+bool UReplaySubsystem::LoadKeyframe(int32 Chunk)
+{
+	if (!Reader.ReadKeyframe(Chunk, RecordStates.GetData()) || !LoadChunkInputs(Chunk)) {
+		UE_LOG(LogTemp, Warning, TEXT("Replay: chunk %d is corrupt"), Chunk);
+		return false;
+	}
+
+	for (int32 i = 0; i < Fighters.Num(); i++) {
+		Fighters[i]->LoadState(RecordStates[i]);
+		LastInputs[i] = RecordStates[i].LastInput;
+	}
+	CombatClock->SetFrame(RecordStates[0].Frame);
+	return true;
+}
+
+void UReplaySubsystem::ApplyPlaybackInputs(int32 Frame)
+{
+	for (int32 i = 0; i < Fighters.Num(); i++) {
+		const FFighterInput& Input = GetPlaybackInput(Frame, i);
+		Fighters[i]->ApplyInput(Input, LastInputs[i]);
+		LastInputs[i] = Input;
+	}
+}
+
+bool UReplaySubsystem::SeekPlayback(int32 Frame)
+{
+	if (!bPlaying) return false;
+
+	Frame = FMath::Clamp(Frame, 0, Reader.GetNumFrames() - 1);
+
+	// The keyframe before the frame is found by division, and the frames after it are resimulated
+	const int32 Chunk = Reader.GetChunkOfFrame(Frame);
+	if (!LoadKeyframe(Chunk)) {
+		StopPlayback();
+		return false;
+	}
+
+	const float StepTime = UCombatClock::GetStepTime();
+	UHitDetectionSubsystem* HitDetection = GetWorld()->GetSubsystem<UHitDetectionSubsystem>();
+
+	for (int32 frame = Reader.GetChunkFirstFrame(Chunk); frame < Frame; frame++) {
+		ApplyPlaybackInputs(frame);
+		for (AFightingCharacter* Fighter : Fighters) {
+			Fighter->ConsumeMovementInputVector();
+			Fighter->ResimulateStep(StepTime);
+		}
+
+		bSeeking = true;
+		CombatClock->Step();
+		bSeeking = false;
+
+		if (HitDetection != NULL && UHitDetectionSubsystem::IsEnabled()) HitDetection->DetectHits();
+	}
+
+	// The frame is played in the next combat step
+	PlaybackFrame = Frame;
+	return true;
+}
+
+void UReplaySubsystem::OnCombatStep(int32 Frame)
+{
+	if (bSeeking) return;
+
+	if (!AreFightersValid()) {
+		StopRecording();
+		StopPlayback();
+		return;
+	}
+
+	if (IsRecording()) {
+		if (Recorder.IsKeyframeDue()) {
+			for (int32 i = 0; i < Fighters.Num(); i++) {
+				// Padding bytes are zeroed so they compress
+				FMemory::Memzero(RecordStates[i]);
+				Fighters[i]->SaveState(RecordStates[i]);
+				RecordStates[i].LastInput = RecordInputs[i];
+			}
+		}
+		for (int32 i = 0; i < Fighters.Num(); i++) RecordInputs[i] = Fighters[i]->GetCurrentInput();
+		Recorder.RecordFrame(RecordInputs.GetData(), RecordStates.GetData());
+	}
+
+	if (bPlaying) {
+		if (PlaybackFrame >= Reader.GetNumFrames()) {
+			StopPlayback();
+			return;
+		}
+
+		// Drift since the previous keyframe is corrected at the start of each chunk
+		const int32 Chunk = Reader.GetChunkOfFrame(PlaybackFrame);
+		if (PlaybackFrame == Reader.GetChunkFirstFrame(Chunk) && !LoadKeyframe(Chunk)) {
+			StopPlayback();
+			return;
+		}
+
+		ApplyPlaybackInputs(PlaybackFrame);
+		PlaybackFrame++;
+	}
+}
+
+void UReplaySubsystem::Deinitialize()
+{
+	StopRecording();
+	StopPlayback();
+	Super::Deinitialize();
+}
+
+static void StartReplayRecording(const TArray<FString>& Args, UWorld* World)
+{
+	UReplaySubsystem* Replay = World != NULL ? World->GetSubsystem<UReplaySubsystem>() : NULL;
+	if (Replay == NULL || !Replay->StartRecording(Args.Num() > 0 ? Args[0] : FString())) {
+		UE_LOG(LogTemp, Warning, TEXT("Fighting.Replay.Record: the game mode must be MyGameMode with its fighters spawned, and no replay must be playing"));
+	}
+}
+
+static void StopReplayRecording(UWorld* World)
+{
+	UReplaySubsystem* Replay = World != NULL ? World->GetSubsystem<UReplaySubsystem>() : NULL;
+	if (Replay != NULL) Replay->StopRecording();
+}
+
+static void PlayReplay(const TArray<FString>& Args, UWorld* World)
+{
+	if (World == NULL || Args.Num() < 1) {
+		UE_LOG(LogTemp, Warning, TEXT("Usage: Fighting.Replay.Play <Path> [Frame]"));
+		return;
+	}
+
+	UReplaySubsystem* Replay = World->GetSubsystem<UReplaySubsystem>();
+	if (Replay != NULL) Replay->StartPlayback(Args[0], Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 0);
+}
+
+static void SeekReplay(const TArray<FString>& Args, UWorld* World)
+{
+	UReplaySubsystem* Replay = World != NULL ? World->GetSubsystem<UReplaySubsystem>() : NULL;
+	if (Replay == NULL || Args.Num() < 1 || !Replay->SeekPlayback(FCString::Atoi(*Args[0]))) {
+		UE_LOG(LogTemp, Warning, TEXT("Usage: Fighting.Replay.Seek <Frame>, while a replay is playing"));
+	}
+}
+
+static void StopReplay(UWorld* World)
+{
+	UReplaySubsystem* Replay = World != NULL ? World->GetSubsystem<UReplaySubsystem>() : NULL;
+	if (Replay != NULL) Replay->StopPlayback();
+}
+
+static FAutoConsoleCommandWithWorldAndArgs StartReplayRecordingCommand(
+	TEXT("Fighting.Replay.Record"),
+	TEXT("Starts recording the fighters into a replay file.\n")
+	TEXT("Usage: Fighting.Replay.Record [Path]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartReplayRecording));
+
+static FAutoConsoleCommandWithWorld StopReplayRecordingCommand(
+	TEXT("Fighting.Replay.StopRecording"),
+	TEXT("Stops recording and closes the replay file."),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&StopReplayRecording));
+
+static FAutoConsoleCommandWithWorldAndArgs PlayReplayCommand(
+	TEXT("Fighting.Replay.Play"),
+	TEXT("Plays a replay file back with the fighters of the game mode.\n")
+	TEXT("Usage: Fighting.Replay.Play <Path> [Frame]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&PlayReplay));
+
+static FAutoConsoleCommandWithWorldAndArgs SeekReplayCommand(
+	TEXT("Fighting.Replay.Seek"),
+	TEXT("Moves the replay being played to a frame.\n")
+	TEXT("Usage: Fighting.Replay.Seek <Frame>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&SeekReplay));
+
+static FAutoConsoleCommandWithWorld StopReplayCommand(
+	TEXT("Fighting.Replay.Stop"),
+	TEXT("Stops the replay being played."),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&StopReplay));
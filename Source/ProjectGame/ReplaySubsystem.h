@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ReplayFile.h"
+#include "ReplaySubsystem.generated.h"
+
+class AFightingCharacter;
+class AController;
+class UCombatClock;
+
+/**
+ * Records the fighters of AMyGameMode into replay files and plays them back.
+ * While recording, the input of every fighter is captured every combat step, and the state of every fighter every
+ * FReplayRecorder::KeyframeInterval steps. Playback takes the fighters over like a rollback session: they are moved to the
+ * keyframe before the requested frame, resimulated up to it, and then driven by the recorded inputs every combat step.
+ * As animation and movement are not deterministic, playback drifts between keyframes and is corrected at each keyframe.
+ *
+ * Matches are recorded into Saved/Replays when Fighting.Replay.AutoRecord is set. Console commands:
+ * Fighting.Replay.Record [Path], Fighting.Replay.StopRecording, Fighting.Replay.Play <Path> [Frame],
+ * Fighting.Replay.Seek <Frame>, Fighting.Replay.Stop
+ */
+UCLASS()
+class PROJECTGAME_API UReplaySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Starts recording the fighters of the game mode.
+	 *
+	 * @param Path	path of the replay file. If empty, a new file is created in Saved/Replays
+	 * @return true if the recording started
+	 */
+	bool StartRecording(FString Path = FString());
+
+	/** Starts recording if Fighting.Replay.AutoRecord is set. Called by the game mode once the fighters are spawned */
+	void StartAutoRecording();
+
+	/** Stops recording and closes the file */
+	void StopRecording();
+
+	FORCEINLINE bool IsRecording() const { return Recorder.IsRecording(); }
+
+	/**
+	 * Plays a replay back with the fighters of the game mode, which must have as many fighters as the replay.
+	 *
+	 * @param Path		path of the replay file
+	 * @param Frame		replay frame to start from
+	 * @return true if the playback started
+	 */
+	bool StartPlayback(const FString& Path, int32 Frame = 0);
+
+	/** Moves the playback to a replay frame. Returns false if no replay is being played */
+	bool SeekPlayback(int32 Frame);
+
+	/** Stops the playback and gives the fighters back their controllers */
+	void StopPlayback();
+
+	FORCEINLINE bool IsPlaying() const { return bPlaying; }
+
+	/** Returns the replay frame being played */
+	FORCEINLINE int32 GetPlaybackFrame() const { return PlaybackFrame; }
+
+	//~ Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+protected:
+	/** Records or plays one frame. Bound to UCombatClock::OnCombatStep */
+	void OnCombatStep(int32 Frame);
+
+	/** Finds the fighters of the game mode. Returns false if there are none */
+	bool GatherFighters();
+
+	/** Binds OnCombatStep() if recording or playing */
+	void BindCombatStep();
+
+	/** Unbinds OnCombatStep() if neither recording nor playing */
+	void UnbindCombatStep();
+
+	/** Returns true if all the fighters are still valid */
+	bool AreFightersValid() const;
+
+	/** Decodes the inputs of a chunk, if they are not decoded already */
+	bool LoadChunkInputs(int32 Chunk);
+
+	/** Moves the fighters and the combat clock to the keyframe of a chunk, and decodes its inputs */
+	bool LoadKeyframe(int32 Chunk);
+
+	/** Returns the recorded input of a fighter in a replay frame */
+	FORCEINLINE const FFighterInput& GetPlaybackInput(int32 Frame, int32 Fighter) const
+	{
+		return ChunkInputs[(Frame - Reader.GetChunkFirstFrame(LoadedChunk)) * Fighters.Num() + Fighter];
+	}
+
+	/** Applies the recorded input of every fighter in a replay frame */
+	void ApplyPlaybackInputs(int32 Frame);
+
+	/** Fighters recorded or played, in the order of the replay */
+	UPROPERTY()
+	TArray<AFightingCharacter*> Fighters;
+
+	/** Controllers of the fighters when the playback started, given back their fighter when it stops */
+	UPROPERTY()
+	TArray<AController*> PlaybackControllers;
+
+	UPROPERTY()
+	UCombatClock* CombatClock;
+
+	FReplayRecorder Recorder;
+	FReplayReader Reader;
+
+	/** Path of the file being recorded */
+	FString RecordingPath;
+
+	/** Input and state of every fighter in the frame being recorded, or state of the keyframe being played */
+	TArray<FFighterInput> RecordInputs;
+	TArray<FFighterState> RecordStates;
+
+	/** Inputs of the chunk being played, and its index */
+	TArray<FFighterInput> ChunkInputs;
+	int32 LoadedChunk = INDEX_NONE;
+
+	/** Input applied to each fighter in the previous frame of the playback */
+	TArray<FFighterInput> LastInputs;
+
+	/** Next replay frame to play */
+	int32 PlaybackFrame = 0;
+
+	bool bPlaying = false;
+
+	/** True while the playback is fast-forwarded to a frame, so the combat steps of the fast-forward are not played */
+	bool bSeeking = false;
+
+	FDelegateHandle CombatStepHandle;
+};
@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RollbackSession.h"
+#include "Misc/ScopeLock.h"
+
+/** A packet in flight between two loopback transports */
+struct FLoopbackPacket
+{
+	double DeliveryTime;
+	TArray<uint8> Data;
+};
+
+/** Packets in flight of each port. Shared by all game instances of the process */
+static TMap<int32, TArray<FLoopbackPacket>> LoopbackMailboxes;
+static FCriticalSection LoopbackMailboxesLock;
+
+FLoopbackTransport::FLoopbackTransport(int32 InPort, int32 InPeerPort, float LatencyMs, float JitterMs, float LossPercent)
+	: Port(InPort)
+	, PeerPort(InPeerPort)
+	, Latency(LatencyMs * 0.001)
+	, Jitter(JitterMs * 0.001)
+	, LossFraction(LossPercent * 0.01f)
+	, Random(InPort)
+{
+	FScopeLock Lock(&LoopbackMailboxesLock);
+	LoopbackMailboxes.FindOrAdd(Port).Reset();
+}
+
+FLoopbackTransport::~FLoopbackTransport()
+{
+	FScopeLock Lock(&LoopbackMailboxesLock);
+	LoopbackMailboxes.Remove(Port);
+}
+
+void FLoopbackTransport::Send(const TArray<uint8>& Packet)
+{
+	if (Random.GetFraction() < LossFraction) return;
+
+	FLoopbackPacket InFlight;
+	InFlight.DeliveryTime = FPlatformTime::Seconds() + Latency + Jitter * Random.GetFraction();
+	InFlight.Data = Packet;
+
+	FScopeLock Lock(&LoopbackMailboxesLock);
+	LoopbackMailboxes.FindOrAdd(PeerPort).Add(MoveTemp(InFlight));
+}
+
+bool FLoopbackTransport::Receive(TArray<uint8>& OutPacket)
+{
+	FScopeLock Lock(&LoopbackMailboxesLock);
+	TArray<FLoopbackPacket>* Mailbox = LoopbackMailboxes.Find(Port);
+	if (Mailbox == NULL) return false;
+
+	// Deliver the packet that arrived first
+	double Now = FPlatformTime::Seconds();
+	int32 First = INDEX_NONE;
+	for (int32 i = 0; i < Mailbox->Num(); i++) {
+		if ((*Mailbox)[i].DeliveryTime <= Now && (First == INDEX_NONE || (*Mailbox)[i].DeliveryTime < (*Mailbox)[First].DeliveryTime)) First = i;
+	}
+	if (First == INDEX_NONE) return false;
+
+	OutPacket = MoveTemp((*Mailbox)[First].Data);
+	Mailbox->RemoveAt(First);
+	return true;
+}
+
+FRollbackSession::FRollbackSession(IRollbackSimulation* InSimulation, IRollbackTransport* InTransport, int32 InLocalPlayer)
+	: Simulation(InSimulation)
+	, Transport(InTransport)
+	, LocalPlayer(InLocalPlayer)
+	, RemotePlayer(1 - InLocalPlayer)
+{
+	check(LocalPlayer == 0 || LocalPlayer == 1);
+}
+
+FFighterInput FRollbackSession::GetRemoteInput(int32 Frame) const
+{
+	const FInputSlot& Slot = RemoteInputs[Frame % InputHistory];
+	if (Slot.Frame == Frame) return Slot.Input;
+
+	// Prediction: the remote player keeps pressing what they were pressing
+	if (RemoteConfirmedFrame != INDEX_NONE) return RemoteInputs[RemoteConfirmedFrame % InputHistory].Input;
+	return FFighterInput();
+}
+
+void FRollbackSession::ReceivePackets()
+{
+	while (Transport->Receive(PacketBuffer)) {
+		if (PacketBuffer.Num() < (int32)sizeof(FPacketHeader)) continue;
+
+		FPacketHeader Header;
+		FMemory::Memcpy(&Header, PacketBuffer.GetData(), sizeof(FPacketHeader));
+		if (Header.Magic != PacketMagic || PacketBuffer.Num() != (int32)(sizeof(FPacketHeader) + Header.NumInputs * sizeof(FFighterInput))) continue;
+
+		Stats.PacketsReceived++;
+		RemoteAckFrame = FMath::Max(RemoteAckFrame, Header.AckFrame);
+
+		const uint8* InputData = PacketBuffer.GetData() + sizeof(FPacketHeader);
+		for (int32 i = 0; i < Header.NumInputs; i++) {
+			int32 Frame = Header.FirstFrame + i;
+
+			// Inputs are confirmed in order. A gap is filled by a later packet, which resends everything not acknowledged
+			if (Frame <= RemoteConfirmedFrame) continue;
+			if (Frame != RemoteConfirmedFrame + 1) break;
+
+			FInputSlot& Slot = RemoteInputs[Frame % InputHistory];
+			Slot.Frame = Frame;
+			FMemory::Memcpy(&Slot.Input, InputData + i * sizeof(FFighterInput), sizeof(FFighterInput));
+			RemoteConfirmedFrame = Frame;
+
+			// The frame was already simulated with a predicted input
+			const FInputSlot& Simulated = SimulatedRemoteInputs[Frame % InputHistory];
+			if (Frame < CurrentFrame && Simulated.Frame == Frame && Simulated.Input != Slot.Input) {
+				if (FirstIncorrectFrame == INDEX_NONE || Frame < FirstIncorrectFrame) FirstIncorrectFrame = Frame;
+			}
+		}
+	}
+}
+
+void FRollbackSession::SendInputs()
+{
+	int32 FirstFrame = FMath::Max(RemoteAckFrame + 1, CurrentFrame - InputHistory + 1);
+	int32 NumInputs = FMath::Max(CurrentFrame - FirstFrame, 0);
+
+	FPacketHeader Header;
+	Header.Magic = PacketMagic;
+	Header.NumInputs = (uint16)NumInputs;
+	Header.FirstFrame = FirstFrame;
+	Header.AckFrame = RemoteConfirmedFrame;
+
+	PacketBuffer.SetNumUninitialized(sizeof(FPacketHeader) + NumInputs * sizeof(FFighterInput), false);
+	FMemory::Memcpy(PacketBuffer.GetData(), &Header, sizeof(FPacketHeader));
+	uint8* InputData = PacketBuffer.GetData() + sizeof(FPacketHeader);
+	for (int32 i = 0; i < NumInputs; i++) {
+		FMemory::Memcpy(InputData + i * sizeof(FFighterInput), &LocalInputs[(FirstFrame + i) % InputHistory].Input, sizeof(FFighterInput));
+	}
+
+	Transport->Send(PacketBuffer);
+	Stats.PacketsSent++;
+}
+
+void FRollbackSession::SimulateFrame(int32 Frame, bool bResimulating)
+{
+	FSavedFrame& Saved = SavedFrames[Frame % (MaxRollbackFrames + 1)];
+	Saved.Frame = Frame;
+	Simulation->SaveState(Saved.States);
+
+	FFighterInput Inputs[NumPlayers];
+	Inputs[LocalPlayer] = LocalInputs[Frame % InputHistory].Input;
+	Inputs[RemotePlayer] = GetRemoteInput(Frame);
+
+	FInputSlot& Simulated = SimulatedRemoteInputs[Frame % InputHistory];
+	Simulated.Frame = Frame;
+	Simulated.Input = Inputs[RemotePlayer];
+
+	Simulation->Step(Inputs, bResimulating);
+}
+
+bool FRollbackSession::AdvanceFrame(const FFighterInput& LocalInput)
+{
+	ReceivePackets();
+
+	// Roll back to the first mispredicted frame and simulate again up to the current frame
+	if (FirstIncorrectFrame != INDEX_NONE) {
+		const FSavedFrame& Saved = SavedFrames[FirstIncorrectFrame % (MaxRollbackFrames + 1)];
+		if (ensure(Saved.Frame == FirstIncorrectFrame)) {
+			Simulation->LoadState(Saved.States);
+			for (int32 Frame = FirstIncorrectFrame; Frame < CurrentFrame; Frame++) SimulateFrame(Frame, true);
+
+			Stats.Rollbacks++;
+			Stats.ResimulatedFrames += CurrentFrame - FirstIncorrectFrame;
+		}
+		FirstIncorrectFrame = INDEX_NONE;
+	}
+
+	// Too many frames ahead of the peer to be able to correct them later
+	if (CurrentFrame - RemoteConfirmedFrame > MaxRollbackFrames) {
+		Stats.StalledFrames++;
+		SendInputs();
+		return false;
+	}
+
+	FInputSlot& Local = LocalInputs[CurrentFrame % InputHistory];
+	Local.Frame = CurrentFrame;
+	Local.Input = LocalInput;
+
+	SimulateFrame(CurrentFrame, false);
+	CurrentFrame++;
+
+	SendInputs();
+	return true;
+}
@@ -0,0 +1,197 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FighterState.h"
+
+/** Sends and receives the packets of a rollback session. Packets may be delayed, reordered or lost */
+class PROJECTGAME_API IRollbackTransport
+{
+public:
+	virtual ~IRollbackTransport() {}
+
+	/** Sends a packet to the peer */
+	virtual void Send(const TArray<uint8>& Packet) = 0;
+
+	/** Receives the next packet that arrived, returning false if there is none */
+	virtual bool Receive(TArray<uint8>& OutPacket) = 0;
+};
+
+/**
+ * Stand-in for a UDP socket between two game instances running in the same process (e.g. two Play In Editor clients).
+ * Each transport owns a port, and packets are delivered to the peer's port after a simulated latency,
+ * with a simulated packet loss.
+ */
+class PROJECTGAME_API FLoopbackTransport : public IRollbackTransport
+{
+public:
+	/**
+	 * @param Port			port this transport receives on
+	 * @param PeerPort		port the packets are sent to
+	 * @param LatencyMs		one-way latency in milliseconds
+	 * @param JitterMs		maximum random latency added to each packet, which may reorder packets
+	 * @param LossPercent	percentage of packets dropped
+	 */
+	FLoopbackTransport(int32 Port, int32 PeerPort, float LatencyMs, float JitterMs, float LossPercent);
+	virtual ~FLoopbackTransport();
+
+	//~ Begin IRollbackTransport Interface
+	virtual void Send(const TArray<uint8>& Packet) override;
+	virtual bool Receive(TArray<uint8>& OutPacket) override;
+	//~ End IRollbackTransport Interface
+
+protected:
+	int32 Port;
+	int32 PeerPort;
+	double Latency;
+	double Jitter;
+	float LossFraction;
+	FRandomStream Random;
+};
+
+/** Saves, loads and advances the state of the fighters of a rollback session */
+class PROJECTGAME_API IRollbackSimulation
+{
+public:
+	virtual ~IRollbackSimulation() {}
+
+	/** Saves the state of every fighter, indexed by player */
+	virtual void SaveState(FFighterState* OutStates) = 0;
+
+	/** Restores the state of every fighter, indexed by player */
+	virtual void LoadState(const FFighterState* States) = 0;
+
+	/**
+	 * Advances the fighters by one frame with the specified inputs, indexed by player.
+	 *
+	 * @param Inputs			input of each player
+	 * @param bResimulating		true if the frame is being simulated again after a rollback, outside of the world tick
+	 */
+	virtual void Step(const FFighterInput* Inputs, bool bResimulating) = 0;
+};
+
+/**
+ * GGPO-style rollback session between two players.
+ * Every frame the local input is sent to the peer and the frame is simulated right away, predicting that the remote player
+ * keeps the last input received from them. The state of each frame is saved before simulating it. When the real remote input
+ * of a frame arrives and differs from the prediction, the state of that frame is loaded and the frames since then are
+ * simulated again with the right inputs. If the remote inputs are more than MaxRollbackFrames behind, the session stalls.
+ * Each packet carries all the local inputs not yet acknowledged by the peer, so lost packets are recovered by the next one.
+ */
+class PROJECTGAME_API FRollbackSession
+{
+public:
+	/** Maximum number of frames that can be simulated again */
+	static const int32 MaxRollbackFrames = 8;
+
+	/** Number of players */
+	static const int32 NumPlayers = 2;
+
+	/** Number of frames of input kept */
+	static const int32 InputHistory = 64;
+
+	/** Counters of the session */
+	struct FStats
+	{
+		int32 Rollbacks = 0;
+		int32 ResimulatedFrames = 0;
+		int32 StalledFrames = 0;
+		int32 PacketsSent = 0;
+		int32 PacketsReceived = 0;
+	};
+
+	/**
+	 * @param Simulation	fighters of the session. Must outlive the session
+	 * @param Transport		connection to the peer. Must outlive the session
+	 * @param LocalPlayer	index of the local player (0 or 1). The peer must use the other one
+	 */
+	FRollbackSession(IRollbackSimulation* Simulation, IRollbackTransport* Transport, int32 LocalPlayer);
+
+	/**
+	 * Advances the session by one frame: receives the remote inputs, rolls back if a prediction was wrong,
+	 * simulates the frame and sends the local input.
+	 *
+	 * @param LocalInput	input of the local player in this frame
+	 * @return false if the session stalled waiting for remote inputs, and the frame was not simulated
+	 */
+	bool AdvanceFrame(const FFighterInput& LocalInput);
+
+	/** Returns the number of the next frame to be simulated */
+	FORCEINLINE int32 GetFrame() const { return CurrentFrame; }
+
+	/** Returns the last frame whose remote input has been received */
+	FORCEINLINE int32 GetRemoteConfirmedFrame() const { return RemoteConfirmedFrame; }
+
+	FORCEINLINE const FStats& GetStats() const { return Stats; }
+
+protected:
+	/** Input of one frame in the input history */
+	struct FInputSlot
+	{
+		int32 Frame = INDEX_NONE;
+		FFighterInput Input;
+	};
+
+	/** Saved state of all fighters before simulating a frame */
+	struct FSavedFrame
+	{
+		int32 Frame = INDEX_NONE;
+		FFighterState States[NumPlayers];
+	};
+
+	/** Header of each packet, followed by NumInputs FFighterInputs for consecutive frames starting at FirstFrame */
+	struct FPacketHeader
+	{
+		uint16 Magic;
+		uint16 NumInputs;
+		int32 FirstFrame;
+		int32 AckFrame;
+	};
+
+	static const uint16 PacketMagic = 0xF16A;
+
+	/** Returns the remote input of a frame: the real one if it was received, otherwise the last one received */
+	FFighterInput GetRemoteInput(int32 Frame) const;
+
+	/** Reads all the packets received, storing the remote inputs and finding the first mispredicted frame */
+	void ReceivePackets();
+
+	/** Sends the local inputs not yet acknowledged by the peer */
+	void SendInputs();
+
+	/** Saves the state and simulates one frame */
+	void SimulateFrame(int32 Frame, bool bResimulating);
+
+	IRollbackSimulation* Simulation;
+	IRollbackTransport* Transport;
+	int32 LocalPlayer;
+	int32 RemotePlayer;
+
+	/** Next frame to be simulated */
+	int32 CurrentFrame = 0;
+
+	/** Last frame whose remote input was received. All frames before it were received too */
+	int32 RemoteConfirmedFrame = INDEX_NONE;
+
+	/** Last frame whose local input the peer acknowledged */
+	int32 RemoteAckFrame = INDEX_NONE;
+
+	/** First frame simulated with a wrong remote input, or INDEX_NONE */
+	int32 FirstIncorrectFrame = INDEX_NONE;
+
+	/** Input histories, indexed by Frame % InputHistory */
+	FInputSlot LocalInputs[InputHistory];
+	FInputSlot RemoteInputs[InputHistory];
+
+	/** Remote input each frame was simulated with, indexed by Frame % InputHistory */
+	FInputSlot SimulatedRemoteInputs[InputHistory];
+
+	/** Saved states, indexed by Frame % (MaxRollbackFrames + 1) */
+	FSavedFrame SavedFrames[MaxRollbackFrames + 1];
+
+	/** Buffer of the packets sent and received */
+	TArray<uint8> PacketBuffer;
+
+	FStats Stats;
+};
@@ -0,0 +1,275 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RollbackSubsystem.h"
+#include "FightingCharacter.h"
+#include "MyGameMode.h"
+#include "CombatClock.h"
+#include "HitDetectionSubsystem.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerInput.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+
+bool URollbackSubsystem::StartSession(int32 LocalPlayer, int32 Port, int32 PeerPort, float LatencyMs, float JitterMs, float LossPercent)
+{
+	StopSession();
+
+	UWorld* World = GetWorld();
+	AMyGameMode* GameMode = World != NULL ? Cast<AMyGameMode>(World->GetAuthGameMode()) : NULL;
+	if (GameMode == NULL || GameMode->Player == NULL || GameMode->Enemy == NULL || (LocalPlayer != 0 && LocalPlayer != 1)) return false;
+
+	CombatClock = World->GetSubsystem<UCombatClock>();
+	LocalController = Cast<APlayerController>(GameMode->Player->GetController());
+	if (CombatClock == NULL || LocalController == NULL) return false;
+
+	LocalPlayerIndex = LocalPlayer;
+	Fighters[LocalPlayer] = GameMode->Player;
+	Fighters[1 - LocalPlayer] = GameMode->Enemy;
+
+	// The local fighter is driven by the session instead of its input bindings
+	Fighters[LocalPlayer]->DisableInput(LocalController);
+
+	// The remote fighter is only driven by the peer's inputs
+	AFightingCharacter* Remote = Fighters[1 - LocalPlayer];
+	AController* RemoteController = Remote->GetController();
+	if (RemoteController != NULL && !RemoteController->IsPlayerController()) RemoteController->UnPossess();
+	Remote->GetCharacterMovement()->bRunPhysicsWithNoController = true;
+
+	SynchronizeStartState();
+
+	Transport = MakeUnique<FLoopbackTransport>(Port, PeerPort, LatencyMs, JitterMs, LossPercent);
+	Session = MakeUnique<FRollbackSession>(this, Transport.Get(), LocalPlayer);
+	CombatStepHandle = CombatClock->OnCombatStep.AddUObject(this, &URollbackSubsystem::OnCombatStep);
+
+	UE_LOG(LogTemp, Display, TEXT("Rollback session started as player %d, port %d, peer port %d"), LocalPlayer, Port, PeerPort);
+	return true;
+}
+
+void URollbackSubsystem::StopSession()
+{
+	if (!Session.IsValid()) return;
+
+	const FRollbackSession::FStats& Stats = Session->GetStats();
+	UE_LOG(LogTemp, Display, TEXT("Rollback session stopped at frame %d: %d rollbacks, %d resimulated frames, %d stalled frames, %d packets sent, %d received"),
+		Session->GetFrame(), Stats.Rollbacks, Stats.ResimulatedFrames, Stats.StalledFrames, Stats.PacketsSent, Stats.PacketsReceived);
+
+	if (CombatClock != NULL) CombatClock->OnCombatStep.Remove(CombatStepHandle);
+	for (int32 i = 0; i < FRollbackSession::NumPlayers; i++) {
+		if (Fighters[i] != NULL) Fighters[i]->CustomTimeDilation = 1.0f;
+	}
+	if (Fighters[LocalPlayerIndex] != NULL && LocalController != NULL) Fighters[LocalPlayerIndex]->EnableInput(LocalController);
+
+	Session.Reset();
+	Transport.Reset();
+}
+
+void URollbackSubsystem::Deinitialize()
+{
+	StopSession();
+	Super::Deinitialize();
+}
+
+void URollbackSubsystem::SynchronizeStartState()
+{
+	// Both instances spawned their player at the player start and their enemy at the enemy start.
+	// Player 0 is moved to the player start and player 1 to the enemy start in both of them
+	FTransform StartTransforms[FRollbackSession::NumPlayers] = {
+		Fighters[LocalPlayerIndex]->GetActorTransform(),
+		Fighters[1 - LocalPlayerIndex]->GetActorTransform()
+	};
+
+	const int32 ClockFrame = CombatClock->GetFrame();
+	for (int32 i = 0; i < FRollbackSession::NumPlayers; i++) {
+		FFighterState State;
+		Fighters[i]->SaveState(State);
+
+		// Combat frames are counted from the start of the session, as the clocks of both instances started at different times
+		State.Frame = 0;
+		for (int32 part = 0; part < NumBodyParts; part++) State.LastDamageTakenFrame[part] -= ClockFrame;
+		State.LastArmsOverlapFrame -= ClockFrame;
+
+		State.Location = StartTransforms[i].GetLocation();
+		State.Yaw = StartTransforms[i].Rotator().Yaw;
+		State.Velocity = FVector::ZeroVector;
+		State.ComboRandomSeed = i + 1;
+		Fighters[i]->LoadState(State);
+
+		LastInputs[i] = FFighterInput();
+	}
+	CombatClock->SetFrame(0);
+	ConfirmedCombatFrame = 0;
+}
+
+float URollbackSubsystem::GetAxisValue(FName AxisName) const
+{
+	float Value = 0.0f;
+	for (const FInputAxisKeyMapping& Mapping : LocalController->PlayerInput->GetKeysForAxis(AxisName)) {
+		float KeyValue = Mapping.Key.IsFloatAxis() ? LocalController->GetInputAnalogKeyState(Mapping.Key) : (LocalController->IsInputKeyDown(Mapping.Key) ? 1.0f : 0.0f);
+		Value += KeyValue * Mapping.Scale;
+	}
+	return Value;
+}
+
+bool URollbackSubsystem::IsActionPressed(FName ActionName) const
+{
+	for (const FInputActionKeyMapping& Mapping : LocalController->PlayerInput->GetKeysForAction(ActionName)) {
+		if (LocalController->IsInputKeyDown(Mapping.Key)) return true;
+	}
+	return false;
+}
+
+FFighterInput URollbackSubsystem::ReadLocalInput() const
+{
+	FFighterInput Input;
+	if (LocalController == NULL || LocalController->PlayerInput == NULL) return Input;
+
+	if (IsActionPressed("Attack1")) Input.Buttons |= FFighterInput::Attack1;
+	if (IsActionPressed("Attack2")) Input.Buttons |= FFighterInput::Attack2;
+	if (IsActionPressed("Block")) Input.Buttons |= FFighterInput::Block;
+	if (IsActionPressed("Duck")) Input.Buttons |= FFighterInput::Duck;
+	if (IsActionPressed("MoveMod")) Input.Buttons |= FFighterInput::MoveMod;
+	if (IsActionPressed("Taunt")) Input.Buttons |= FFighterInput::Taunt;
+	if (IsActionPressed("Run")) Input.Buttons |= FFighterInput::Run;
+	if (IsActionPressed("Jump")) Input.Buttons |= FFighterInput::Jump;
+
+	// Same directions as AFightingCharacter::MoveForward() and MoveRight(), quantized in world space
+	const FRotator YawRotation(0, LocalController->GetControlRotation().Yaw, 0);
+	const FRotationMatrix YawMatrix(YawRotation);
+	FVector Direction = YawMatrix.GetUnitAxis(EAxis::X) * GetAxisValue("MoveForward") + YawMatrix.GetUnitAxis(EAxis::Y) * GetAxisValue("MoveRight");
+	Direction = Direction.GetClampedToMaxSize(1.0f);
+	Input.MoveX = (int8)FMath::RoundToInt(Direction.X * 127.0f);
+	Input.MoveY = (int8)FMath::RoundToInt(Direction.Y * 127.0f);
+
+	return Input;
+}
+
+void URollbackSubsystem::SaveState(FFighterState* OutStates)
+{
+	for (int32 i = 0; i < FRollbackSession::NumPlayers; i++) {
+		Fighters[i]->SaveState(OutStates[i]);
+		OutStates[i].LastInput = LastInputs[i];
+	}
+}
+
+void URollbackSubsystem::LoadState(const FFighterState* States)
+{
+	if (!bResimulating) {
+		for (int32 i = 0; i < FRollbackSession::NumPlayers; i++) {
+			HealthBeforeRollback[i] = Fighters[i]->GetHealthPoints();
+			ImpactVelBeforeRollback[i] = Fighters[i]->LastAttackImpactVel;
+			PointsBeforeRollback[i] = Fighters[i]->LastAttackPoints;
+		}
+		bResimulating = true;
+	}
+
+	for (int32 i = 0; i < FRollbackSession::NumPlayers; i++) {
+		Fighters[i]->LoadState(States[i]);
+		LastInputs[i] = States[i].LastInput;
+	}
+	CombatClock->SetFrame(States[0].Frame);
+}
+
+void URollbackSubsystem::Step(const FFighterInput* Inputs, bool bResimulatingStep)
+{
+	if (!bResimulatingStep) EndResimulation();
+
+	for (int32 i = 0; i < FRollbackSession::NumPlayers; i++) {
+		Fighters[i]->ApplyInput(Inputs[i], LastInputs[i]);
+		LastInputs[i] = Inputs[i];
+	}
+
+	// Live frames are advanced by the world tick
+	if (!bResimulatingStep) return;
+
+	const float StepTime = UCombatClock::GetStepTime();
+	for (int32 i = 0; i < FRollbackSession::NumPlayers; i++) {
+		Fighters[i]->ConsumeMovementInputVector();
+		Fighters[i]->ResimulateStep(StepTime);
+	}
+
+	CombatClock->Step();
+
+	UHitDetectionSubsystem* HitDetection = GetWorld()->GetSubsystem<UHitDetectionSubsystem>();
+	if (HitDetection != NULL && UHitDetectionSubsystem::IsEnabled()) HitDetection->DetectHits();
+}
+
+void URollbackSubsystem::EndResimulation()
+{
+	if (!bResimulating) return;
+	bResimulating = false;
+
+	// Once, with the state the fighters ended up in, instead of for every resimulated hit
+	for (int32 i = 0; i < FRollbackSession::NumPlayers; i++) {
+		AFightingCharacter* Fighter = Fighters[i];
+		if (Fighter == NULL) continue;
+
+		const float Health = Fighter->GetHealthPoints();
+		if (Health != HealthBeforeRollback[i]) Fighter->OnFighterDamaged.Broadcast(EBodyPart::None, HealthBeforeRollback[i] - Health, Health, 0.0f);
+		if (Fighter->LastAttackImpactVel != ImpactVelBeforeRollback[i] || Fighter->LastAttackPoints != PointsBeforeRollback[i]) {
+			Fighter->OnAttackStatsChanged.Broadcast();
+		}
+	}
+}
+
+void URollbackSubsystem::OnCombatStep(int32 Frame)
+{
+	if (bResimulating || !Session.IsValid()) return;
+
+	for (int32 i = 0; i < FRollbackSession::NumPlayers; i++) {
+		if (Fighters[i] == NULL) {
+			StopSession();
+			return;
+		}
+	}
+
+	const bool bAdvanced = Session->AdvanceFrame(ReadLocalInput());
+
+	// A stalled frame is not simulated live, so the resimulation did not end in it
+	EndResimulation();
+
+	// While stalled, the fighters are frozen and the combat frame is not consumed
+	for (int32 i = 0; i < FRollbackSession::NumPlayers; i++) Fighters[i]->CustomTimeDilation = bAdvanced ? 1.0f : 0.0f;
+	if (!bAdvanced) CombatClock->SetFrame(CombatClock->GetFrame() - 1);
+
+	// Session frames advance with the combat frames: the last simulated one is in the current combat frame
+	const int32 UnconfirmedFrames = Session->GetFrame() - 1 - Session->GetRemoteConfirmedFrame();
+	ConfirmedCombatFrame = CombatClock->GetFrame() - FMath::Max(UnconfirmedFrames, 0);
+}
+
+static void StartRollbackSession(const TArray<FString>& Args, UWorld* World)
+{
+	if (World == NULL || Args.Num() < 3) {
+		UE_LOG(LogTemp, Warning, TEXT("Usage: Fighting.Rollback.Start <LocalPlayer> <Port> <PeerPort> [LatencyMs] [JitterMs] [LossPercent]"));
+		return;
+	}
+
+	URollbackSubsystem* Rollback = World->GetSubsystem<URollbackSubsystem>();
+	bool bStarted = Rollback != NULL && Rollback->StartSession(
+		FCString::Atoi(*Args[0]),
+		FCString::Atoi(*Args[1]),
+		FCString::Atoi(*Args[2]),
+		Args.Num() > 3 ? FCString::Atof(*Args[3]) : 0.0f,
+		Args.Num() > 4 ? FCString::Atof(*Args[4]) : 0.0f,
+		Args.Num() > 5 ? FCString::Atof(*Args[5]) : 0.0f);
+
+	if (!bStarted) UE_LOG(LogTemp, Warning, TEXT("Fighting.Rollback.Start: the game mode must be MyGameMode, with a player and an enemy"));
+}
+
+static void StopRollbackSession(UWorld* World)
+{
+	URollbackSubsystem* Rollback = World != NULL ? World->GetSubsystem<URollbackSubsystem>() : NULL;
+	if (Rollback != NULL) Rollback->StopSession();
+}
+
+static FAutoConsoleCommandWithWorldAndArgs StartRollbackSessionCommand(
+	TEXT("Fighting.Rollback.Start"),
+	TEXT("Starts a rollback session between the player and the enemy over a loopback transport, to be played against another game instance in the same process.\n")
+	TEXT("Usage: Fighting.Rollback.Start <LocalPlayer> <Port> <PeerPort> [LatencyMs] [JitterMs] [LossPercent]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartRollbackSession));
+
+static FAutoConsoleCommandWithWorld StopRollbackSessionCommand(
+	TEXT("Fighting.Rollback.Stop"),
+	TEXT("Stops the rollback session and logs its stats."),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&StopRollbackSession));
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RollbackSession.h"
+#include "RollbackSubsystem.generated.h"
+
+class AFightingCharacter;
+class APlayerController;
+class UCombatClock;
+
+/**
+ * Runs a rollback session between the player and the enemy of AMyGameMode, one session frame per combat step.
+ * The local player's input is read from the player controller's input mappings every combat step and fed to the session
+ * instead of the character's input bindings. The remote fighter is only driven by the inputs received from the peer.
+ * When the session rolls back, both fighters are restored from their saved states and advanced again with
+ * AFightingCharacter::ResimulateStep(), stepping the combat clock and the hit detection with them.
+ *
+ * Two game instances in the same process (e.g. two Play In Editor clients) can play each other over a loopback transport:
+ * Fighting.Rollback.Start <LocalPlayer> <Port> <PeerPort> [LatencyMs] [JitterMs] [LossPercent]
+ */
+UCLASS()
+class PROJECTGAME_API URollbackSubsystem : public UWorldSubsystem, public IRollbackSimulation
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Starts a session over a loopback transport. The peer must start its session with the other player index and swapped ports.
+	 *
+	 * @param LocalPlayer	index of the local player (0 or 1)
+	 * @param Port			port the inputs of the peer are received on
+	 * @param PeerPort		port the local inputs are sent to
+	 * @param LatencyMs		simulated one-way latency in milliseconds
+	 * @param JitterMs		simulated maximum extra latency in milliseconds
+	 * @param LossPercent	simulated packet loss percentage
+	 * @return true if the session started
+	 */
+	bool StartSession(int32 LocalPlayer, int32 Port, int32 PeerPort, float LatencyMs, float JitterMs, float LossPercent);
+
+	/** Stops the session, if any, and gives the fighters back their normal input */
+	void StopSession();
+
+	FORCEINLINE bool IsSessionRunning() const { return Session.IsValid(); }
+
+	/** Returns the session being run, or NULL */
+	FORCEINLINE const FRollbackSession* GetSession() const { return Session.Get(); }
+
+	/**
+	 * Returns true while the session restores and resimulates frames after a rollback. The fighters do not broadcast their events
+	 * nor record telemetry meanwhile, and listeners are told about the final state once the resimulation is over.
+	 */
+	FORCEINLINE bool IsResimulating() const { return bResimulating; }
+
+	/** Returns the last combat frame simulated with the real inputs of both players, which will not be rolled back */
+	FORCEINLINE int32 GetConfirmedCombatFrame() const { return ConfirmedCombatFrame; }
+
+	//~ Begin USubsystem Interface
+	virtual void Deinitialize() override;
+	//~ End USubsystem Interface
+
+	//~ Begin IRollbackSimulation Interface
+	virtual void SaveState(FFighterState* OutStates) override;
+	virtual void LoadState(const FFighterState* States) override;
+	virtual void Step(const FFighterInput* Inputs, bool bResimulatingStep) override;
+	//~ End IRollbackSimulation Interface
+
+protected:
+	/** Advances the session. Bound to UCombatClock::OnCombatStep */
+	void OnCombatStep(int32 Frame);
+
+	/** Reads the input of the local player from the player controller's input mappings */
+	FFighterInput ReadLocalInput() const;
+
+	/** Returns the value of an input axis from the player controller's input mappings */
+	float GetAxisValue(FName AxisName) const;
+
+	/** Returns true if one of the keys of an input action is down */
+	bool IsActionPressed(FName ActionName) const;
+
+	/** Moves both fighters to the same start state in both game instances */
+	void SynchronizeStartState();
+
+	/** Ends the resimulation, if any, and broadcasts what changed for the fighters during it */
+	void EndResimulation();
+
+	/** Fighters indexed by player */
+	UPROPERTY()
+	AFightingCharacter* Fighters[FRollbackSession::NumPlayers];
+
+	UPROPERTY()
+	APlayerController* LocalController;
+
+	UPROPERTY()
+	UCombatClock* CombatClock;
+
+	int32 LocalPlayerIndex;
+
+	/** Input each fighter was given in the last frame */
+	FFighterInput LastInputs[FRollbackSession::NumPlayers];
+
+	/**
+	 * True from the rollback to the next live frame. The combat steps of the resimulation do not advance the session, and the
+	 * fighters do not broadcast their events
+	 */
+	bool bResimulating = false;
+
+	/** Health of each fighter and stats of its last attack when the rollback started, as the listeners of its events last saw them */
+	float HealthBeforeRollback[FRollbackSession::NumPlayers];
+	float ImpactVelBeforeRollback[FRollbackSession::NumPlayers];
+	int32 PointsBeforeRollback[FRollbackSession::NumPlayers];
+
+	/** Combat frame in which the last session frame confirmed by the peer was simulated */
+	int32 ConfirmedCombatFrame = 0;
+
+	FDelegateHandle CombatStepHandle;
+
+	TUniquePtr<FLoopbackTransport> Transport;
+	TUniquePtr<FRollbackSession> Session;
+};